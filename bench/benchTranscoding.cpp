@@ -0,0 +1,543 @@
+/**
+ * Description: micro benchmarks of conversion, decoding, encoding and
+ *                  transcoding, on synthetic frames. results are written
+ *                  as json
+**/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "VideoDecoder.h"
+#include "VideoEncoder.h"
+#include "Transcoder.h"
+
+extern "C" {
+    #include <libavutil/imgutils.h>
+    #include <libavutil/time.h>
+}
+
+using namespace std;
+
+/**
+ * @brief: structure to define one benchmark result
+ */
+struct BenchResult
+{
+    // benchmark name
+    string name;
+
+    // frame size label and size
+    string size;
+    int width;
+    int height;
+
+    // codec and preset, empty if not encoding
+    string codec;
+    string preset;
+
+    // no of processed frames
+    int frames;
+
+    // wall clock time (seconds)
+    double seconds;
+
+    // result status, -1 = failure, 0 = success
+    int status;
+
+    /**
+     * @brief: constructor to initialize member data
+     */
+    BenchResult()
+    {
+        name = size = codec = preset = "";
+        width = height = frames = 0;
+        seconds = 0.0;
+        status = -1;
+    }
+};
+
+/**
+ * @brief: structure to define one frame size
+ */
+struct BenchSize
+{
+    // size label
+    const char *label;
+
+    // frame width and height
+    int width;
+    int height;
+};
+
+// frame sizes that can be benchmarked
+static const BenchSize allSizes[] = {
+    {"480p", 854, 480},
+    {"1080p", 1920, 1080},
+    {"4k", 3840, 2160},
+};
+
+// function to print help
+void printHelp();
+
+// function to split comma separated list
+vector<string> splitList(const string &list);
+
+// function to fill synthetic rgb24 frame
+void fillFrame(uint8_t *rgbData, int linesize, int width, int height, int index);
+
+// function to benchmark rgb24 <-> yuv420p conversion
+void benchConvert(const BenchSize &size, int frames, vector<BenchResult> &results);
+
+// function to benchmark encoding of synthetic frames into a file
+void benchEncode(const BenchSize &size, int frames, const string &codec, const string &preset,
+                 const string &videoFile, vector<BenchResult> &results);
+
+// function to benchmark decoding of a file
+void benchDecode(const BenchSize &size, const string &codec, const string &preset,
+                 const string &videoFile, vector<BenchResult> &results);
+
+// function to benchmark transcoding of a file
+void benchTranscode(const BenchSize &size, const string &codec, const string &preset,
+                    const string &videoFile, const string &tmpPath, int pipelineQueue,
+                    vector<BenchResult> &results);
+
+// function to write results as json
+int writeJson(const string &outputFile, int frames, const vector<BenchResult> &results);
+
+// main starts here
+int main(int argc, char **argv)
+{
+    // no of frames per benchmark
+    int frames = 50;
+
+    // frame sizes, codecs and x264 presets to run
+    string sizeList = "480p,1080p,4k";
+    string codecList = "MPEG-4,H264";
+    string presetList = "ultrafast,medium";
+
+    // json output file, "-" = stdout
+    string outputFile = "-";
+
+    // directory of temporary videos
+    string tmpPath = "/tmp";
+
+    // keep temporary videos
+    int keepFiles = 0;
+
+    // parse command line arguments
+    for (int i = 1; i < argc; i+=2)
+    {
+        if (strcmp(argv[i], "-h") == 0)
+        {
+            printHelp();
+            return 0;
+        }
+        else if (i + 1 >= argc)
+        {
+            cout << "Prameter: " << argv[i] << " needs a value(type " << argv[0] << " -h for help)." << endl;
+            return -1;
+        }
+        else if (strcmp(argv[i], "-n") == 0)
+            frames = atoi(argv[i+1]);
+        else if (strcmp(argv[i], "-s") == 0)
+            sizeList = argv[i+1];
+        else if (strcmp(argv[i], "-f") == 0)
+            codecList = argv[i+1];
+        else if (strcmp(argv[i], "-preset") == 0)
+            presetList = argv[i+1];
+        else if (strcmp(argv[i], "-o") == 0)
+            outputFile = argv[i+1];
+        else if (strcmp(argv[i], "-tmp") == 0)
+            tmpPath = argv[i+1];
+        else if (strcmp(argv[i], "-keep") == 0)
+            keepFiles = atoi(argv[i+1]);
+        else
+        {
+            cout << "Prameter: " << argv[i] << " not supported(type " << argv[0] << " -h for help)." << endl;
+            return -1;
+        }
+    }
+
+    if (frames <= 0)
+        frames = 50;
+
+    // register all the resources required from ffmpeg
+    if (Transcoder::initThreading() < 0)
+        return -1;
+
+    vector<string> sizes = splitList(sizeList);
+    vector<string> codecs = splitList(codecList);
+    vector<string> presets = splitList(presetList);
+
+    vector<BenchResult> results;
+    vector<string> tmpFiles;
+
+    // loop for all frame sizes
+    for (size_t s = 0; s < sizes.size(); s++)
+    {
+        const BenchSize *size = NULL;
+        for (size_t i = 0; i < sizeof(allSizes) / sizeof(allSizes[0]); i++)
+            if (sizes[s] == allSizes[i].label)
+                size = &allSizes[i];
+
+        if (!size)
+        {
+            cout << "Frame size: " << sizes[s] << " not supported(480p/1080p/4k)." << endl;
+            continue;
+        }
+
+        // conversion only
+        benchConvert(*size, frames, results);
+
+        // first encoded video is input of end to end transcoding
+        string transcodeFile = "";
+        string transcodeCodec = "";
+        string transcodePreset = "";
+
+        // loop for all codecs, presets apply to H264 only
+        for (size_t c = 0; c < codecs.size(); c++)
+        {
+            vector<string> codecPresets = presets;
+            if (codecs[c] != "H264" || codecPresets.empty())
+                codecPresets.assign(1, "");
+
+            for (size_t p = 0; p < codecPresets.size(); p++)
+            {
+                // temporary video, container fitting codec
+                string videoFile = tmpPath + "/bench_" + size->label + "_" + codecs[c] +
+                                   (codecPresets[p].empty() ? "" : "_" + codecPresets[p]) +
+                                   (codecs[c] == "H264" ? ".mp4" : ".avi");
+                tmpFiles.push_back(videoFile);
+
+                benchEncode(*size, frames, codecs[c], codecPresets[p], videoFile, results);
+                if (results.back().status != 0)
+                    continue;
+
+                benchDecode(*size, codecs[c], codecPresets[p], videoFile, results);
+
+                if (transcodeFile.empty())
+                {
+                    transcodeFile = videoFile;
+                    transcodeCodec = codecs[c];
+                    transcodePreset = codecPresets[p];
+                }
+            }
+        }
+
+        // end to end, serial and pipelined
+        if (!transcodeFile.empty())
+        {
+            benchTranscode(*size, transcodeCodec, transcodePreset, transcodeFile, tmpPath, 0,
+                                                                                    results);
+            benchTranscode(*size, transcodeCodec, transcodePreset, transcodeFile, tmpPath, 8,
+                                                                                    results);
+            tmpFiles.push_back(tmpPath + "/bench_" + size->label + "_transcode" +
+                               transcodeFile.substr(transcodeFile.find_last_of('.')));
+        }
+    }
+
+    // remove temporary videos
+    for (size_t i = 0; !keepFiles && i < tmpFiles.size(); i++)
+        unlink(tmpFiles[i].c_str());
+
+    if (writeJson(outputFile, frames, results) < 0)
+        return -1;
+
+    // count failed benchmarks
+    int failed = 0;
+    for (size_t i = 0; i < results.size(); i++)
+        if (results[i].status != 0)
+            failed++;
+
+    return failed ? -1 : 0;
+}
+
+// function to split comma separated list
+vector<string> splitList(const string &list)
+{
+    vector<string> items;
+
+    size_t start = 0;
+    while (start <= list.size())
+    {
+        size_t end = list.find(',', start);
+        if (end == string::npos)
+            end = list.size();
+
+        if (end > start)
+            items.push_back(list.substr(start, end - start));
+
+        start = end + 1;
+    }
+
+    return items;
+}
+
+// function to fill synthetic rgb24 frame, moving gradient with block texture
+// so encoders have motion and detail to work on
+void fillFrame(uint8_t *rgbData, int linesize, int width, int height, int index)
+{
+    for (int y = 0; y < height; y++)
+    {
+        uint8_t *row = rgbData + y * linesize;
+        for (int x = 0; x < width; x++)
+        {
+            // texture of 16x16 blocks, fixed per block
+            unsigned int block = (unsigned int)((x >> 4) * 2654435761u ^ (y >> 4) * 40503u);
+
+            row[3 * x + 0] = (uint8_t)(x + index * 2);
+            row[3 * x + 1] = (uint8_t)(y + index);
+            row[3 * x + 2] = (uint8_t)((block >> 8) & 0x3f) + (uint8_t)((x + y) >> 3);
+        }
+    }
+}
+
+// function to make one result
+static BenchResult makeResult(const char *name, const BenchSize &size, const string &codec,
+                              const string &preset)
+{
+    BenchResult result;
+    result.name = name;
+    result.size = size.label;
+    result.width = size.width;
+    result.height = size.height;
+    result.codec = codec;
+    result.preset = preset;
+    return result;
+}
+
+// function to benchmark rgb24 <-> yuv420p conversion, scale contexts are
+// created before timing
+void benchConvert(const BenchSize &size, int frames, vector<BenchResult> &results)
+{
+    BenchResult toYuv = makeResult("rgb24_to_yuv420p", size, "", "");
+    BenchResult toRgb = makeResult("yuv420p_to_rgb24", size, "", "");
+
+    uint8_t *rgbData[4] = {NULL};
+    int rgbLinesize[4] = {0};
+    uint8_t *yuvData[4] = {NULL};
+    int yuvLinesize[4] = {0};
+
+    if (av_image_alloc(rgbData, rgbLinesize, size.width, size.height, PIX_FMT_RGB24, 32) >= 0 &&
+        av_image_alloc(yuvData, yuvLinesize, size.width, size.height, PIX_FMT_YUV420P, 32) >= 0)
+    {
+        fillFrame(rgbData[0], rgbLinesize[0], size.width, size.height, 0);
+
+        FrameConverter frameConverter;
+
+        // warm up, creates scale contexts
+        int status = frameConverter.convert(rgbData, rgbLinesize, size.width, size.height,
+                        PIX_FMT_RGB24, yuvData, yuvLinesize, size.width, size.height,
+                        PIX_FMT_YUV420P);
+        if (status >= 0)
+            status = frameConverter.convert(yuvData, yuvLinesize, size.width, size.height,
+                        PIX_FMT_YUV420P, rgbData, rgbLinesize, size.width, size.height,
+                        PIX_FMT_RGB24);
+
+        // rgb24 to yuv420p
+        int64_t startTime = av_gettime_relative();
+        for (int i = 0; i < frames && status >= 0; i++)
+            status = frameConverter.convert(rgbData, rgbLinesize, size.width, size.height,
+                        PIX_FMT_RGB24, yuvData, yuvLinesize, size.width, size.height,
+                        PIX_FMT_YUV420P);
+
+        toYuv.seconds = (av_gettime_relative() - startTime) / 1000000.0;
+        toYuv.frames = frames;
+        toYuv.status = status < 0 ? -1 : 0;
+
+        // yuv420p to rgb24
+        startTime = av_gettime_relative();
+        for (int i = 0; i < frames && status >= 0; i++)
+            status = frameConverter.convert(yuvData, yuvLinesize, size.width, size.height,
+                        PIX_FMT_YUV420P, rgbData, rgbLinesize, size.width, size.height,
+                        PIX_FMT_RGB24);
+
+        toRgb.seconds = (av_gettime_relative() - startTime) / 1000000.0;
+        toRgb.frames = frames;
+        toRgb.status = status < 0 ? -1 : 0;
+    }
+
+    av_freep(&rgbData[0]);
+    av_freep(&yuvData[0]);
+
+    results.push_back(toYuv);
+    results.push_back(toRgb);
+}
+
+// function to benchmark encoding of synthetic frames into a file, frames are
+// generated before timing, so only conversion and encoding are timed
+void benchEncode(const BenchSize &size, int frames, const string &codec, const string &preset,
+                 const string &videoFile, vector<BenchResult> &results)
+{
+    BenchResult result = makeResult("encode", size, codec, preset);
+
+    // a few distinct frames, reused in turn
+    const int noOfFrames = 8;
+    int frameSize = size.width * size.height * 3;
+    vector<uint8_t> frameData((size_t)frameSize * noOfFrames);
+
+    for (int i = 0; i < noOfFrames; i++)
+        fillFrame(&frameData[(size_t)frameSize * i], size.width * 3, size.width, size.height, i);
+
+    VideoEncoderContext encoderContext;
+    encoderContext.outputVideoFile = videoFile;
+    encoderContext.codecStr = codec;
+    encoderContext.preset = preset;
+    encoderContext.width = size.width;
+    encoderContext.height = size.height;
+    encoderContext.frameRate = 25;
+    encoderContext.gopSize = 25;
+    encoderContext.bitRate = size.width * size.height * 2;
+
+    VideoEncoder videoEncoder(encoderContext);
+
+    int64_t startTime = av_gettime_relative();
+
+    // encode frames, delayed frames are written on stop
+    int status = videoEncoder.startVideoEncode();
+    for (int i = 0; i < frames && status >= 0; i++)
+        status = videoEncoder.addNewFrame(&frameData[(size_t)frameSize * (i % noOfFrames)]);
+
+    if (videoEncoder.stopVideoEncode() < 0)
+        status = -1;
+
+    result.seconds = (av_gettime_relative() - startTime) / 1000000.0;
+    result.frames = frames;
+    result.status = status < 0 ? -1 : 0;
+
+    results.push_back(result);
+}
+
+// function to benchmark decoding of a file, as decoder planes and as rgb24
+void benchDecode(const BenchSize &size, const string &codec, const string &preset,
+                 const string &videoFile, vector<BenchResult> &results)
+{
+    BenchResult planes = makeResult("decode", size, codec, preset);
+    BenchResult rgb = makeResult("decode_rgb24", size, codec, preset);
+
+    VideoDecoder videoDecoder;
+
+    // decoder planes, no conversion
+    AVFrame *avFrame = av_frame_alloc();
+    if (avFrame && videoDecoder.openVideo(videoFile) >= 0)
+    {
+        int64_t startTime = av_gettime_relative();
+        while (videoDecoder.getNewFrame(avFrame) > 0)
+        {
+            av_frame_unref(avFrame);
+            planes.frames++;
+        }
+
+        planes.seconds = (av_gettime_relative() - startTime) / 1000000.0;
+        planes.status = planes.frames > 0 ? 0 : -1;
+
+        videoDecoder.closeVideo();
+    }
+
+    av_frame_free(&avFrame);
+
+    // converted to rgb24
+    vector<uint8_t> frameData((size_t)size.width * size.height * 3);
+    if (videoDecoder.openVideo(videoFile) >= 0)
+    {
+        int64_t startTime = av_gettime_relative();
+        while (videoDecoder.getNewFrame(&frameData[0]) > 0)
+            rgb.frames++;
+
+        rgb.seconds = (av_gettime_relative() - startTime) / 1000000.0;
+        rgb.status = rgb.frames > 0 ? 0 : -1;
+
+        videoDecoder.closeVideo();
+    }
+
+    results.push_back(planes);
+    results.push_back(rgb);
+}
+
+// function to benchmark end to end transcoding of a file into same codec
+void benchTranscode(const BenchSize &size, const string &codec, const string &preset,
+                    const string &videoFile, const string &tmpPath, int pipelineQueue,
+                    vector<BenchResult> &results)
+{
+    BenchResult result = makeResult(pipelineQueue > 0 ? "transcode_pipeline" : "transcode",
+                                    size, codec, preset);
+
+    TranscodeJob job;
+    job.inputFile = videoFile;
+    job.outputFile = tmpPath + "/bench_" + size.label + "_transcode" +
+                     videoFile.substr(videoFile.find_last_of('.'));
+    job.encoderContext.codecStr = codec;
+    job.encoderContext.preset = preset;
+    job.encoderContext.gopSize = 25;
+    job.encoderContext.bitRate = size.width * size.height * 2;
+    job.pipelineQueue = pipelineQueue;
+
+    TranscodeResult transcodeResult;
+    Transcoder::transcode(job, transcodeResult);
+
+    result.frames = transcodeResult.frames;
+    result.seconds = transcodeResult.elapsedTime;
+    result.status = transcodeResult.status;
+
+    results.push_back(result);
+}
+
+// function to write results as json, with frames/sec and ns/pixel
+int writeJson(const string &outputFile, int frames, const vector<BenchResult> &results)
+{
+    FILE *jsonFp = outputFile == "-" ? stdout : fopen(outputFile.c_str(), "w");
+    if (!jsonFp)
+    {
+        cout << "Could not open file: " << outputFile << endl;
+        return -1;
+    }
+
+    fprintf(jsonFp, "{\n");
+    fprintf(jsonFp, "  \"frames\": %d,\n", frames);
+    fprintf(jsonFp, "  \"cpus\": %d,\n", (int)sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(jsonFp, "  \"results\": [\n");
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &result = results[i];
+
+        double pixels = (double)result.frames * result.width * result.height;
+        double fps = result.seconds > 0 ? result.frames / result.seconds : 0.0;
+        double nsPerPixel = pixels > 0 ? result.seconds * 1e9 / pixels : 0.0;
+
+        fprintf(jsonFp, "    {\"name\": \"%s\", \"size\": \"%s\", \"width\": %d, \"height\": %d, "
+                        "\"codec\": \"%s\", \"preset\": \"%s\", \"status\": \"%s\", "
+                        "\"frames\": %d, \"seconds\": %.6f, \"fps\": %.2f, \"ns_per_pixel\": %.4f}%s\n",
+                        result.name.c_str(), result.size.c_str(), result.width, result.height,
+                        result.codec.c_str(), result.preset.c_str(),
+                        result.status == 0 ? "ok" : "failed", result.frames, result.seconds,
+                        fps, nsPerPixel, i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(jsonFp, "  ]\n");
+    fprintf(jsonFp, "}\n");
+
+    if (jsonFp != stdout)
+        fclose(jsonFp);
+
+    return 0;
+}
+
+// Function to print command line options
+void printHelp()
+{
+    cout << "\nVideoTransoder Benchmarks:: Help Menu(-h)" << endl;
+    cout << "-n     : frames per benchmark          (default = 50)" << endl;
+    cout << "-s     : frame sizes                   (480p,1080p,4k, default = all)" << endl;
+    cout << "-f     : encoding formats              (default = MPEG-4,H264)" << endl;
+    cout << "-preset: H264 presets                  (default = ultrafast,medium)" << endl;
+    cout << "-o     : json output file              (- = stdout, default = -)" << endl;
+    cout << "-tmp   : directory of temporary videos (default = /tmp)" << endl;
+    cout << "-keep  : keep temporary videos         (default = 0)\n" << endl;
+}
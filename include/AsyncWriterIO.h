@@ -0,0 +1,123 @@
+#ifndef ASYNC_WRITER_IO_H
+#define ASYNC_WRITER_IO_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "StageStats.h"
+
+// ffmpeg header files.
+extern "C" {
+    #include <libavformat/avio.h>
+}
+
+/**
+ * @brief: AsyncWriterIO class
+ *          output AVIOContext handing muxed bytes to a writer thread
+ *          through a ring buffer, written to file in large blocks. a seek
+ *          waits till buffered bytes are written, then writing continues
+ *          at new position
+ */
+class AsyncWriterIO
+{
+    // output file descriptor, -1 if not open
+    int m_fd;
+
+    // ring buffer of muxed bytes
+    std::vector<uint8_t> m_buffer;
+
+    // file position of first buffered byte
+    int64_t m_flushPos;
+
+    // ring offset of first buffered byte
+    size_t m_flushOffset;
+
+    // no of buffered bytes
+    size_t m_filled;
+
+    // size of file written so far (bytes)
+    int64_t m_fileSize;
+
+    // bytes preallocated for output, 0 = none
+    int64_t m_preallocSize;
+
+    // write error (AVERROR), 0 = none
+    int m_error;
+
+    // flag to write buffered bytes without waiting for a full block
+    bool m_flush;
+
+    // flag to stop writer thread
+    bool m_stop;
+
+    // guards buffer state
+    std::mutex m_mutex;
+
+    // signals bytes were buffered, or bytes were written
+    std::condition_variable m_dataReady;
+    std::condition_variable m_spaceReady;
+
+    // writer thread
+    std::thread m_thread;
+
+    // avio context handed to muxer
+    AVIOContext *m_avioCtx;
+
+    // time muxer waited for buffer space on every write (micro seconds)
+    StageStats m_waitStats;
+
+    // no of bytes written to file, no of file writes, no of seeks
+    int64_t m_bytesWritten;
+    int m_writes;
+    int m_seeks;
+
+    // writer thread, writes buffered bytes to file
+    void writerThread();
+
+    // function to wait till all buffered bytes are written
+    void drain(std::unique_lock<std::mutex> &lock);
+
+    // avio callbacks
+    static int writePacket(void *opaque, uint8_t *buf, int bufSize);
+    static int64_t seek(void *opaque, int64_t offset, int whence);
+
+    // disable copy
+    AsyncWriterIO(const AsyncWriterIO &);
+    AsyncWriterIO& operator=(const AsyncWriterIO &);
+
+    public:
+        // constructor for asyncwriterio
+        AsyncWriterIO();
+
+        // destructor for asyncwriterio
+        ~AsyncWriterIO();
+
+        // function to create output file and start writer thread
+        int open(const std::string &outputFile, int bufferSize, int64_t preallocSize=0);
+
+        // function to write buffered bytes, stop writer and close output file
+        int close();
+
+        // function to check if output is open
+        bool isOpen();
+
+        // function to fetch avio context for muxer
+        AVIOContext* getAVIOContext();
+
+        // function to fetch time muxer waited for buffer space
+        const StageStats& getWaitStats();
+
+        // function to fetch no of bytes written to file
+        int64_t getBytesWritten();
+
+        // function to fetch no of file writes
+        int getWrites();
+
+        // function to fetch no of seeks
+        int getSeeks();
+};
+
+#endif // ASYNC_WRITER_IO_H
@@ -0,0 +1,63 @@
+#ifndef BATCH_TRANSCODER_H
+#define BATCH_TRANSCODER_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "Transcoder.h"
+
+/**
+ * @brief: BatchTranscoder class
+ *          transcodes many input videos, one output per input,
+ *          on a pool of worker threads
+ */
+class BatchTranscoder
+{
+    // jobs to run
+    std::vector<TranscodeJob> m_jobs;
+
+    // result of every job, same order as jobs
+    std::vector<TranscodeResult> m_results;
+
+    // index of next job to run
+    std::atomic<int> m_nextJob;
+
+    // no of concurrent jobs
+    int m_workers;
+
+    // wall clock time of last run (seconds)
+    double m_elapsedTime;
+
+    // worker thread, runs jobs until none is left
+    void runWorker();
+
+    public:
+        // constructor for batchtranscoder
+        BatchTranscoder(int workers=1);
+
+        // function to make output filename from template
+        static std::string makeOutputName(const std::string &nameTemplate,
+                                          const std::string &inputFile, int index);
+
+        // function to check that no two jobs write the same output
+        static int checkOutputNames(const std::vector<TranscodeJob> &jobs);
+
+        // function to add one job for each input, outputs named from template
+        void addJobs(const std::vector<std::string> &inputFiles,
+                     const std::string &nameTemplate, const TranscodeJob &jobTemplate);
+
+        // function to add one job
+        void addJob(const TranscodeJob &job);
+
+        // function to run all jobs
+        int run();
+
+        // function to fetch result of every job
+        const std::vector<TranscodeResult>& getResults();
+
+        // function to print per job and aggregate summary
+        void printSummary();
+};
+
+#endif // BATCH_TRANSCODER_H
@@ -0,0 +1,114 @@
+#ifndef FRAME_CONVERTER_H
+#define FRAME_CONVERTER_H
+
+#include <map>
+
+// ffmpeg header files.
+extern "C" {
+    #include <libswscale/swscale.h>
+}
+
+/**
+ * @brief: structure to identify one cached conversion context
+ */
+struct FrameConverterKey
+{
+    // source width, height and pixel format
+    int srcWidth;
+    int srcHeight;
+    int srcFormat;
+
+    // destination width, height and pixel format
+    int dstWidth;
+    int dstHeight;
+    int dstFormat;
+
+    // scaling filter flags
+    int flags;
+
+    /**
+     * @brief: ordering operator, required to use key in std::map
+     */
+    bool operator<(const FrameConverterKey &key) const
+    {
+        if (srcWidth != key.srcWidth) return srcWidth < key.srcWidth;
+        if (srcHeight != key.srcHeight) return srcHeight < key.srcHeight;
+        if (srcFormat != key.srcFormat) return srcFormat < key.srcFormat;
+        if (dstWidth != key.dstWidth) return dstWidth < key.dstWidth;
+        if (dstHeight != key.dstHeight) return dstHeight < key.dstHeight;
+        if (dstFormat != key.dstFormat) return dstFormat < key.dstFormat;
+        return flags < key.flags;
+    }
+
+    /**
+     * @brief: equality operator
+     */
+    bool operator==(const FrameConverterKey &key) const
+    {
+        return !(*this < key) && !(key < *this);
+    }
+};
+
+/**
+ * @brief: FrameConverter class
+ *          converts frames between pixel formats/sizes using
+ *          cached scale contexts
+ */
+class FrameConverter
+{
+    // cached scale contexts
+    std::map<FrameConverterKey, struct SwsContext*> m_swsContexts;
+
+    // key of last used scale context
+    FrameConverterKey m_lastKey;
+
+    // last used scale context
+    struct SwsContext *m_lastSwsContext;
+
+    // time taken by last conversion (micro seconds)
+    int64_t m_lastConvertTime;
+
+    // time taken by all conversions (micro seconds)
+    int64_t m_totalConvertTime;
+
+    // total no of converted frames
+    int m_convertCount;
+
+    // function to initialize private member data
+    void initLocals();
+
+    // function to fetch scale context for the given key
+    struct SwsContext* getContext(const FrameConverterKey &key);
+
+    // disable copy, scale contexts are owned by the converter
+    FrameConverter(const FrameConverter &);
+    FrameConverter& operator=(const FrameConverter &);
+
+    public:
+        // constructor for frameconverter
+        FrameConverter();
+
+        // destructor for frameconverter
+        ~FrameConverter();
+
+        // function to convert one frame
+        int convert(const uint8_t *const srcData[], const int srcLinesize[],
+                    int srcWidth, int srcHeight, PixelFormat srcFormat,
+                    uint8_t *const dstData[], const int dstLinesize[],
+                    int dstWidth, int dstHeight, PixelFormat dstFormat,
+                    int flags=SWS_BICUBIC);
+
+        // function to release all cached scale contexts
+        void clear();
+
+        // function to fetch time taken by last conversion (micro seconds)
+        int64_t getLastConvertTime();
+
+        // function to fetch average conversion time per frame (micro seconds)
+        double getAvgConvertTime();
+
+        // function to fetch total no of converted frames
+        int getConvertCount();
+};
+
+#endif // FRAME_CONVERTER_H
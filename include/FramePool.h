@@ -0,0 +1,138 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <memory>
+#include <vector>
+#include <mutex>
+
+// ffmpeg header files.
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+class FramePool;
+
+/**
+ * @brief: structure to hold lock shared by pool and its entries, lives
+ *          till pool and all its frames are gone
+ */
+struct FramePoolState
+{
+    // lock to guard entries and reference counts
+    std::mutex mutex;
+};
+
+/**
+ * @brief: structure to hold one pooled frame and its buffer
+ */
+struct FramePoolEntry
+{
+    // frame pointing into the pooled buffer
+    AVFrame *frame;
+
+    // aligned pixel buffer, NULL for shell frames
+    uint8_t *buffer;
+
+    // no of references held on frame
+    int refCount;
+
+    // pool owning this entry, NULL once detached, guarded by state lock
+    FramePool *pool;
+
+    // lock state of pool, set once when entry is allocated
+    std::shared_ptr<FramePoolState> state;
+};
+
+/**
+ * @brief: FramePool class
+ *          hands out aligned, reference counted frames and recycles them
+ */
+class FramePool
+{
+    // all entries allocated by pool
+    std::vector<FramePoolEntry*> m_entries;
+
+    // entries free for reuse
+    std::vector<FramePoolEntry*> m_freeEntries;
+
+    // lock to guard entries, frames are shared across threads and may
+    // outlive the pool, so the lock is shared with every entry
+    std::shared_ptr<FramePoolState> m_state;
+
+    // pixel format of pooled frames
+    PixelFormat m_pixFmt;
+
+    // width of pooled frames
+    int m_width;
+
+    // height of pooled frames
+    int m_height;
+
+    // line size alignment
+    int m_align;
+
+    // line sizes of pooled frames
+    int m_linesize[4];
+
+    // buffer size of one frame
+    int m_bufferSize;
+
+    // max no of frames, 0 = no limit
+    int m_maxFrames;
+
+    // flag set when pool hands out shell frames without buffer
+    bool m_shells;
+
+    // function to initialize private member data
+    void initLocals();
+
+    // function to allocate a new entry
+    FramePoolEntry* allocEntry();
+
+    // function to free all entries
+    void freeEntries();
+
+    // function to put entry back in free list
+    void recycleEntry(FramePoolEntry *entry);
+
+    // disable copy, entries are owned by the pool
+    FramePool(const FramePool &);
+    FramePool& operator=(const FramePool &);
+
+    public:
+        // constructor for framepool
+        FramePool();
+
+        // constructor for framepool
+        FramePool(PixelFormat pixFmt, int width, int height, int maxFrames=0, int align=64);
+
+        // destructor for framepool
+        ~FramePool();
+
+        // function to initialize pool for the given frame geometry
+        int init(PixelFormat pixFmt, int width, int height, int maxFrames=0, int align=64);
+
+        // function to initialize pool of shell frames, to hold references
+        // of frames owned elsewhere (e.g. decoder frames)
+        int initShells(int maxFrames=0);
+
+        // function to fetch a free frame, reference count set to 1
+        AVFrame* getFrame();
+
+        // function to add a reference to pooled frame
+        static void refFrame(AVFrame *avFrame);
+
+        // function to release a reference, frame is recycled on last release
+        static void releaseFrame(AVFrame *avFrame);
+
+        // function to check if pool matches the given geometry
+        bool matches(PixelFormat pixFmt, int width, int height);
+
+        // function to fetch total no of frames allocated by pool
+        int getFrameCount();
+
+        // function to fetch no of frames in use
+        int getUsedCount();
+};
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,54 @@
+#ifndef FRAME_RATE_FILTER_H
+#define FRAME_RATE_FILTER_H
+
+#include "VideoDecoder.h"
+
+/**
+ * @brief: FrameRateFilter class
+ *          selects decoded frames for a constant output frame rate from
+ *          their timestamps. frames are dropped before conversion and
+ *          encoding, missing output frames repeat the next input frame
+ */
+class FrameRateFilter
+{
+    // time base of input timestamps
+    AVRational m_timeBase;
+
+    // output frame rate, 0 = every frame passes
+    int m_frameRate;
+
+    // timestamp of first output frame, AV_NOPTS_VALUE = first input frame
+    int64_t m_startTs;
+
+    // index of next output frame
+    int64_t m_nextFrame;
+
+    // no of input, dropped and repeated frames
+    int m_inputFrames;
+    int m_droppedFrames;
+    int m_repeatedFrames;
+
+    public:
+        // constructor for frameratefilter
+        FrameRateFilter();
+
+        // function to set input time base and output frame rate
+        void reset(AVRational timeBase, int frameRate, int64_t startTs=AV_NOPTS_VALUE);
+
+        // function to set up filter for an opened video
+        int init(VideoDecoder &videoDecoder, int frameRate, int64_t startTs=AV_NOPTS_VALUE);
+
+        // function to find no of output frames for an input frame, 0 = drop
+        int filterFrame(int64_t ts);
+
+        // function to check if frames are filtered at all
+        bool isActive();
+
+        // function to fetch no of dropped frames
+        int getDroppedFrames();
+
+        // function to fetch no of repeated frames
+        int getRepeatedFrames();
+};
+
+#endif // FRAME_RATE_FILTER_H
@@ -0,0 +1,56 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <string>
+
+#include "FrameConverter.h"
+#include "FramePool.h"
+
+// ffmpeg header files.
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+/**
+ * @brief: ImageWriter class
+ *          writes frames as png or jpeg images, codec is chosen from
+ *          file extension and kept open while image size is the same
+ */
+class ImageWriter
+{
+    // image codec context
+    AVCodecContext *m_avCodecCtx;
+
+    // frame in codec format
+    FramePool m_framePool;
+
+    // converter to codec format
+    FrameConverter m_frameConverter;
+
+    // jpeg quality scale (2..31, lower is better)
+    int m_quality;
+
+    // function to open codec for image format and size
+    int openCodec(int codecId, int width, int height);
+
+    // function to close codec
+    void closeCodec();
+
+    // disable copy
+    ImageWriter(const ImageWriter &);
+    ImageWriter& operator=(const ImageWriter &);
+
+    public:
+        // constructor for imagewriter
+        ImageWriter(int quality=2);
+
+        // destructor for imagewriter
+        ~ImageWriter();
+
+        // function to write planes as an image file
+        int writeImage(const std::string &imageFile, const uint8_t *const srcData[],
+                       const int srcLinesize[], int srcWidth, int srcHeight,
+                       PixelFormat srcFormat, int width=-1, int height=-1);
+};
+
+#endif // IMAGE_WRITER_H
@@ -0,0 +1,141 @@
+#ifndef KEY_FRAME_INDEX_H
+#define KEY_FRAME_INDEX_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include <stdint.h>
+
+/**
+ * @brief: structure to define one keyframe of input video
+ */
+struct KeyFrameInfo
+{
+    // presentation timestamp, in stream time base
+    int64_t pts;
+
+    // byte offset of keyframe packet in file, -1 if unknown
+    int64_t pos;
+
+    // no of video packets before keyframe
+    int frameNumber;
+};
+
+/**
+ * @brief: structure to define header of keyframe index file, keyframe
+ *          entries follow it. fields are fixed size, so file is used
+ *          as it is once mapped
+ */
+struct KeyFrameIndexHeader
+{
+    // file identifier, "VKFI"
+    char magic[4];
+
+    // version of file layout
+    uint32_t version;
+
+    // no of keyframe entries
+    uint32_t count;
+
+    // index of video stream in file
+    int32_t streamIndex;
+
+    // time base of keyframe timestamps
+    int32_t timeBaseNum;
+    int32_t timeBaseDen;
+
+    // size and modification time of video when indexed, index is stale if changed
+    int64_t videoSize;
+    int64_t videoMtime;
+
+    // no of video packets in file
+    int32_t totalFrames;
+
+    // reserved, 0
+    int32_t reserved;
+};
+
+/**
+ * @brief: structure to define one keyframe entry of index file
+ */
+struct KeyFrameIndexEntry
+{
+    // presentation timestamp, in stream time base
+    int64_t pts;
+
+    // byte offset of keyframe packet in file, -1 if unknown
+    int64_t pos;
+
+    // no of video packets before keyframe
+    int32_t frameNumber;
+
+    // reserved, 0
+    int32_t reserved;
+};
+
+/**
+ * @brief: KeyFrameIndex class
+ *          builds and loads keyframe index of a video, kept in a sidecar
+ *          file next to it. index is memory mapped, so loading costs no
+ *          scan of the video
+ */
+class KeyFrameIndex
+{
+    // mapped index file, NULL if none is loaded
+    void *m_mapData;
+
+    // size of mapped index file
+    size_t m_mapSize;
+
+    // header and entries of mapped index file, sorted by timestamp
+    const KeyFrameIndexHeader *m_header;
+    const KeyFrameIndexEntry *m_entries;
+
+    // worker thread, builds indexes until no video is left
+    static void buildWorker(const std::vector<std::string> *videoFiles,
+                            std::atomic<int> *nextFile, std::atomic<int> *failedFiles);
+
+    // function to fetch size and modification time of video
+    static int getVideoStat(const std::string &videoFile, int64_t &size, int64_t &mtime);
+
+    // disable copy
+    KeyFrameIndex(const KeyFrameIndex &);
+    KeyFrameIndex& operator=(const KeyFrameIndex &);
+
+    public:
+        // constructor for keyframeindex
+        KeyFrameIndex();
+
+        // destructor for keyframeindex
+        ~KeyFrameIndex();
+
+        // function to make index filename of a video
+        static std::string getIndexFile(const std::string &videoFile);
+
+        // function to build index file of a video, by reading packets once
+        static int build(const std::string &videoFile);
+
+        // function to build index files of many videos on worker threads
+        static int buildAll(const std::vector<std::string> &videoFiles, int workers=1);
+
+        // function to map index file of a video, if present and not stale
+        int load(const std::string &videoFile, int streamIndex, int timeBaseNum, int timeBaseDen);
+
+        // function to unmap index file
+        void unload();
+
+        // function to check if an index is loaded
+        bool isLoaded();
+
+        // function to fetch no of video packets in indexed file
+        int getTotalFrames();
+
+        // function to find keyframe at or before the given timestamp
+        int findKeyFrame(int64_t pts, KeyFrameInfo &keyFrame);
+
+        // function to fetch all keyframes of index
+        int getKeyFrames(std::vector<KeyFrameInfo> &keyFrames);
+};
+
+#endif // KEY_FRAME_INDEX_H
@@ -0,0 +1,138 @@
+#ifndef LADDER_TRANSCODER_H
+#define LADDER_TRANSCODER_H
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Transcoder.h"
+#include "FrameConverter.h"
+#include "FramePool.h"
+#include "FrameRateFilter.h"
+#include "RingBuffer.h"
+
+/**
+ * @brief: structure to hold one rendition of a ladder and its encode stage
+ */
+struct LadderRendition
+{
+    // output options, size and frame rate resolved from input
+    VideoEncoderContext encoderContext;
+
+    // started video encoder
+    VideoEncoder *videoEncoder;
+
+    // decoded frames shared with other renditions, decode -> encode
+    RingBuffer<AVFrame*> frameQueue;
+
+    // selects decoded frames for output frame rate
+    FrameRateFilter frameRateFilter;
+
+    // converter from decoder to encoder format, and its frames
+    FrameConverter frameConverter;
+    FramePool framePool;
+
+    // encoder frame format
+    PixelFormat pixFmt;
+    int width;
+    int height;
+
+    // no of encoded frames, -1 = failure
+    int frames;
+
+    // convert and queue stats of rendition
+    TranscodeStats stats;
+
+    /**
+     * @brief: constructor to initialize member data
+     *
+     * @params: max no of decoded frames queued
+     */
+    LadderRendition(int queueSize) : frameQueue(queueSize)
+    {
+        videoEncoder = NULL;
+        pixFmt = PIX_FMT_NONE;
+        width = -1;
+        height = -1;
+        frames = 0;
+    }
+
+    /**
+     * @brief: allocation aligned for cache line aligned queue positions
+     */
+    static void* operator new(size_t size)
+    {
+        void *ptr = NULL;
+        if (posix_memalign(&ptr, 64, size) != 0)
+            throw std::bad_alloc();
+
+        return ptr;
+    }
+
+    static void operator delete(void *ptr)
+    {
+        free(ptr);
+    }
+};
+
+/**
+ * @brief: LadderTranscoder class
+ *          transcodes one input video into many renditions (adaptive bit
+ *          rate ladder). input is demuxed and decoded once, every decoded
+ *          frame is shared by reference with all renditions, which convert
+ *          and encode it on their own threads
+ */
+class LadderTranscoder
+{
+    // max no of decoded frames queued for every rendition
+    int m_queueSize;
+
+    // opened video decoder
+    VideoDecoder m_videoDecoder;
+
+    // renditions being encoded
+    std::vector<LadderRendition*> m_renditions;
+
+    // shell frames holding decoder references
+    FramePool m_shellPool;
+
+    // flag to stop all stages on error
+    std::atomic<bool> m_abort;
+
+    // no of decoded frames
+    int m_decodedFrames;
+
+    // function to start encoder of every rendition
+    int startRenditions(const std::vector<VideoEncoderContext> &renditions);
+
+    // function to stop encoders and free renditions
+    void freeRenditions();
+
+    // function to fetch a shell frame, waits while all are in use
+    AVFrame* waitForFrame();
+
+    // decode stage, runs demux and decode for all renditions
+    void decodeStage();
+
+    // encode stage of one rendition, runs convert, encode and mux
+    void encodeStage(LadderRendition *rendition);
+
+    // disable copy
+    LadderTranscoder(const LadderTranscoder &);
+    LadderTranscoder& operator=(const LadderTranscoder &);
+
+    public:
+        // constructor for laddertranscoder
+        LadderTranscoder(int queueSize=8);
+
+        // destructor for laddertranscoder
+        ~LadderTranscoder();
+
+        // function to transcode one input into all renditions
+        int transcode(const TranscodeJob &job, const std::vector<VideoEncoderContext> &renditions,
+                      std::vector<TranscodeResult> &results);
+};
+
+#endif // LADDER_TRANSCODER_H
@@ -0,0 +1,102 @@
+#ifndef MEMORY_IO_H
+#define MEMORY_IO_H
+
+#include <functional>
+#include <vector>
+
+#include <stdint.h>
+
+// ffmpeg header files.
+extern "C" {
+    #include <libavformat/avio.h>
+}
+
+/**
+ * @brief: callback to read input, fills buffer with up to size bytes
+ *
+ * @return: no of bytes read, 0 at end of input, < 0 on failure
+ */
+typedef std::function<int(uint8_t *buf, int size)> MemoryReadCallback;
+
+/**
+ * @brief: callback to write output, consumes size bytes of buffer
+ *
+ * @return: < 0 on failure, >= 0 on success
+ */
+typedef std::function<int(const uint8_t *buf, int size)> MemoryWriteCallback;
+
+/**
+ * @brief: MemoryIO class
+ *          AVIOContext reading input from a memory buffer or a read callback,
+ *          or writing output to a growable buffer or a write callback. buffers
+ *          are seekable, callbacks are streamed and can not seek
+ */
+class MemoryIO
+{
+    // input buffer, not owned
+    const uint8_t *m_inputData;
+    size_t m_inputSize;
+
+    // input read callback
+    MemoryReadCallback m_readCallback;
+
+    // output buffer, not owned
+    std::vector<uint8_t> *m_outputBuffer;
+
+    // output write callback
+    MemoryWriteCallback m_writeCallback;
+
+    // read/write position in buffer
+    int64_t m_position;
+
+    // avio context handed to demuxer/muxer
+    AVIOContext *m_avioCtx;
+
+    // function to allocate avio context with callbacks of current mode
+    int allocContext(bool write, bool seekable);
+
+    // avio callbacks
+    static int readPacket(void *opaque, uint8_t *buf, int bufSize);
+    static int writePacket(void *opaque, uint8_t *buf, int bufSize);
+    static int64_t seek(void *opaque, int64_t offset, int whence);
+
+    // disable copy
+    MemoryIO(const MemoryIO &);
+    MemoryIO& operator=(const MemoryIO &);
+
+    public:
+        // constructor for memoryio
+        MemoryIO();
+
+        // destructor for memoryio
+        ~MemoryIO();
+
+        // function to read input from memory buffer
+        int openInput(const uint8_t *data, size_t size);
+
+        // function to read input from callback
+        int openInput(const MemoryReadCallback &readCallback);
+
+        // function to write output to growable buffer
+        int openOutput(std::vector<uint8_t> *buffer);
+
+        // function to write output to callback
+        int openOutput(const MemoryWriteCallback &writeCallback);
+
+        // function to flush output and free avio context
+        int close();
+
+        // function to check if memoryio is open
+        bool isOpen();
+
+        // function to fetch avio context for demuxer/muxer
+        AVIOContext* getAVIOContext();
+
+        // read callback of stdin, for piped input
+        static int readStdin(uint8_t *buf, int size);
+
+        // write callback of stdout, for piped output
+        static int writeStdout(const uint8_t *buf, int size);
+};
+
+#endif // MEMORY_IO_H
@@ -0,0 +1,122 @@
+#ifndef READAHEAD_IO_H
+#define READAHEAD_IO_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "StageStats.h"
+
+// ffmpeg header files.
+extern "C" {
+    #include <libavformat/avio.h>
+}
+
+/**
+ * @brief: ReadaheadIO class
+ *          input AVIOContext reading a file through a large ring buffer,
+ *          filled ahead of the demuxer by a background thread. seeks
+ *          inside buffered data cost nothing, other seeks restart the
+ *          readahead at the new position
+ */
+class ReadaheadIO
+{
+    // input file descriptor, -1 if not open
+    int m_fd;
+
+    // size of input file
+    int64_t m_fileSize;
+
+    // ring buffer of file data
+    std::vector<uint8_t> m_buffer;
+
+    // file position of next byte handed to demuxer
+    int64_t m_readPos;
+
+    // ring offset of next byte handed to demuxer
+    size_t m_readOffset;
+
+    // no of bytes buffered from read position
+    size_t m_filled;
+
+    // flag set when file end or read error was reached
+    bool m_endOfFile;
+
+    // read error (AVERROR), 0 = none
+    int m_error;
+
+    // flag to stop readahead thread
+    bool m_stop;
+
+    // bumped on every seek, data read before it is dropped
+    uint64_t m_generation;
+
+    // guards buffer state
+    std::mutex m_mutex;
+
+    // signals data was buffered, or space was freed
+    std::condition_variable m_dataReady;
+    std::condition_variable m_spaceReady;
+
+    // readahead thread
+    std::thread m_thread;
+
+    // avio context handed to demuxer
+    AVIOContext *m_avioCtx;
+
+    // time demuxer waited for data on every read (micro seconds)
+    StageStats m_waitStats;
+
+    // no of bytes handed to demuxer, reads that waited, seeks, seeks inside buffer
+    int64_t m_bytesRead;
+    int m_stalls;
+    int m_seeks;
+    int m_bufferedSeeks;
+
+    // readahead thread, fills ring buffer ahead of read position
+    void readaheadThread();
+
+    // avio callbacks
+    static int readPacket(void *opaque, uint8_t *buf, int bufSize);
+    static int64_t seek(void *opaque, int64_t offset, int whence);
+
+    // disable copy
+    ReadaheadIO(const ReadaheadIO &);
+    ReadaheadIO& operator=(const ReadaheadIO &);
+
+    public:
+        // constructor for readaheadio
+        ReadaheadIO();
+
+        // destructor for readaheadio
+        ~ReadaheadIO();
+
+        // function to open input file and start readahead
+        int open(const std::string &inputFile, int bufferSize);
+
+        // function to stop readahead and close input file
+        void close();
+
+        // function to check if input is open
+        bool isOpen();
+
+        // function to fetch avio context for demuxer
+        AVIOContext* getAVIOContext();
+
+        // function to fetch time demuxer waited for data
+        const StageStats& getWaitStats();
+
+        // function to fetch no of bytes handed to demuxer
+        int64_t getBytesRead();
+
+        // function to fetch no of reads that waited for data
+        int getStalls();
+
+        // function to fetch no of seeks, and seeks inside buffered data
+        int getSeeks();
+        int getBufferedSeeks();
+};
+
+#endif // READAHEAD_IO_H
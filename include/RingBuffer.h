@@ -0,0 +1,178 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+/**
+ * @brief: RingBuffer class
+ *          bounded lock-free ring buffer, for one producer and one consumer
+ *          thread
+ */
+template <typename T>
+class RingBuffer
+{
+    // ring items
+    std::vector<T> m_items;
+
+    // capacity - 1, capacity is power of 2
+    size_t m_mask;
+
+    // next position to write, owned by producer
+    alignas(64) std::atomic<size_t> m_head;
+
+    // next position to read, owned by consumer
+    alignas(64) std::atomic<size_t> m_tail;
+
+    // max no of items queued at once
+    alignas(64) std::atomic<size_t> m_maxDepth;
+
+    // disable copy
+    RingBuffer(const RingBuffer &);
+    RingBuffer& operator=(const RingBuffer &);
+
+    /**
+     * @brief: function to wait before retrying a full/empty buffer,
+     *          spins first then sleeps
+     *
+     * @params: no of retries so far
+     */
+    static void backoff(int retries)
+    {
+        if (retries < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    public:
+        /**
+         * @brief: constructor for ringbuffer
+         *
+         * @params: min no of items, rounded up to power of 2
+         */
+        RingBuffer(size_t capacity) : m_head(0), m_tail(0), m_maxDepth(0)
+        {
+            // round capacity up to power of 2
+            size_t size = 2;
+            while (size < capacity)
+                size <<= 1;
+
+            m_items.resize(size);
+            m_mask = size - 1;
+        }
+
+        /**
+         * @brief: function to add an item, producer thread only
+         *
+         * @params: item to add
+         *
+         * @return: false if buffer is full
+         */
+        bool tryPush(const T &item)
+        {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            size_t tail = m_tail.load(std::memory_order_acquire);
+
+            // check if buffer is full
+            if (head - tail > m_mask)
+                return false;
+
+            m_items[head & m_mask] = item;
+            m_head.store(head + 1, std::memory_order_release);
+
+            // track max queue depth
+            size_t depth = head + 1 - tail;
+            if (depth > m_maxDepth.load(std::memory_order_relaxed))
+                m_maxDepth.store(depth, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        /**
+         * @brief: function to remove an item, consumer thread only
+         *
+         * @params: item to fill
+         *
+         * @return: false if buffer is empty
+         */
+        bool tryPop(T &item)
+        {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            size_t head = m_head.load(std::memory_order_acquire);
+
+            // check if buffer is empty
+            if (tail == head)
+                return false;
+
+            item = m_items[tail & m_mask];
+            m_tail.store(tail + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        /**
+         * @brief: function to add an item, waits while buffer is full
+         *
+         * @params: item to add, flag to stop waiting
+         *
+         * @return: false if stopped before item was added
+         */
+        bool push(const T &item, const std::atomic<bool> &stop)
+        {
+            for (int retries = 0; !tryPush(item); retries++)
+            {
+                if (stop.load(std::memory_order_relaxed))
+                    return false;
+                backoff(retries);
+            }
+            return true;
+        }
+
+        /**
+         * @brief: function to remove an item, waits while buffer is empty
+         *
+         * @params: item to fill, flag to stop waiting
+         *
+         * @return: false if stopped before item was removed
+         */
+        bool pop(T &item, const std::atomic<bool> &stop)
+        {
+            for (int retries = 0; !tryPop(item); retries++)
+            {
+                if (stop.load(std::memory_order_relaxed))
+                    return false;
+                backoff(retries);
+            }
+            return true;
+        }
+
+        /**
+         * @brief: function to fetch no of queued items
+         */
+        size_t size()
+        {
+            return m_head.load(std::memory_order_acquire) -
+                   m_tail.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief: function to fetch capacity of buffer
+         */
+        size_t capacity()
+        {
+            return m_mask + 1;
+        }
+
+        /**
+         * @brief: function to fetch max no of items queued at once
+         */
+        size_t maxDepth()
+        {
+            return m_maxDepth.load(std::memory_order_relaxed);
+        }
+};
+
+#endif // RING_BUFFER_H
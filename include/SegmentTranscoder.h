@@ -0,0 +1,54 @@
+#ifndef SEGMENT_TRANSCODER_H
+#define SEGMENT_TRANSCODER_H
+
+#include <string>
+#include <vector>
+
+#include "Transcoder.h"
+
+/**
+ * @brief: SegmentTranscoder class
+ *          transcodes one long input video by splitting it at keyframes
+ *          into segments, encoding segments on parallel workers and
+ *          joining encoded segments into one output video
+ */
+class SegmentTranscoder
+{
+    // no of segments, also no of workers
+    int m_segments;
+
+    // job being run
+    TranscodeJob m_job;
+
+    // start timestamp of every segment, plus end of last segment,
+    // in input stream time base
+    std::vector<int64_t> m_splitPoints;
+
+    // temporary output video of every segment
+    std::vector<std::string> m_segmentFiles;
+
+    // no of encoded frames of every segment, -1 = failure
+    std::vector<int> m_segmentFrames;
+
+    // stage stats of every segment, and of joining
+    std::vector<TranscodeStats> m_segmentStats;
+    TranscodeStats m_joinStats;
+
+    // function to choose split points at keyframes
+    int findSplitPoints();
+
+    // worker thread, transcodes one segment
+    void runSegment(int segment);
+
+    // function to join encoded segments into output video
+    int joinSegments();
+
+    public:
+        // constructor for segmenttranscoder
+        SegmentTranscoder(int segments=1);
+
+        // function to run one transcoding job in segments
+        int transcode(const TranscodeJob &job, TranscodeResult &result);
+};
+
+#endif // SEGMENT_TRANSCODER_H
@@ -0,0 +1,161 @@
+#ifndef STAGE_STATS_H
+#define STAGE_STATS_H
+
+#include <atomic>
+#include <cstdio>
+
+#include <stdint.h>
+
+// ffmpeg header files.
+extern "C" {
+    #include <libavutil/time.h>
+}
+
+// no of histogram buckets, 4 per power of 2 above 8
+#define STAGE_STATS_BUCKETS 160
+
+/**
+ * @brief: enumeration to define timed stages of transcoding
+ */
+enum TranscodeStage
+{
+    STAGE_DEMUX = 0,    // av_read_frame
+    STAGE_DECODE,       // avcodec_decode_video2
+    STAGE_CONVERT,      // sws_scale
+    STAGE_ENCODE,       // avcodec_encode_video2
+    STAGE_WRITE,        // av_interleaved_write_frame
+    TRANSCODE_STAGES
+};
+
+/**
+ * @brief: StageStats class
+ *          counts samples of one stage with total, max and a log scaled
+ *          histogram for percentiles. samples are stage times (micro
+ *          seconds) or queue depths. timing costs one flag check while
+ *          stats are disabled
+ */
+class StageStats
+{
+    // flag to enable timing of all stages
+    static std::atomic<bool> s_enabled;
+
+    // no of samples
+    int64_t m_count;
+
+    // sum and max of samples
+    int64_t m_total;
+    int64_t m_max;
+
+    // bytes processed by stage
+    int64_t m_bytes;
+
+    // no of samples in every bucket
+    uint32_t m_histogram[STAGE_STATS_BUCKETS];
+
+    // function to find bucket of a sample
+    static int getBucket(int64_t value);
+
+    // function to find middle sample of a bucket
+    static int64_t getBucketValue(int bucket);
+
+    public:
+        // constructor for stagestats
+        StageStats();
+
+        // function to enable or disable timing of all stages
+        static void setEnabled(bool enabled);
+
+        /**
+         * @brief: function to check if stages are timed
+         */
+        static bool isEnabled()
+        {
+            return s_enabled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief: function to fetch start time of a stage
+         *
+         * @return: time (micro seconds), 0 if stats are disabled
+         */
+        static int64_t start()
+        {
+            return isEnabled() ? av_gettime_relative() : 0;
+        }
+
+        /**
+         * @brief: function to add time of a stage since start()
+         *
+         * @params: start time from start(), bytes processed by stage
+         */
+        void stop(int64_t startTime, int64_t bytes=0)
+        {
+            if (startTime)
+                addSample(av_gettime_relative() - startTime, bytes);
+        }
+
+        // function to add one sample
+        void addSample(int64_t value, int64_t bytes=0);
+
+        // function to add samples of other stats
+        void add(const StageStats &stageStats);
+
+        // function to clear all samples
+        void reset();
+
+        // function to fetch no of samples
+        int64_t getCount() const;
+
+        // function to fetch sum of samples
+        int64_t getTotal() const;
+
+        // function to fetch max sample
+        int64_t getMax() const;
+
+        // function to fetch bytes processed by stage
+        int64_t getBytes() const;
+
+        // function to fetch average sample
+        double getAverage() const;
+
+        // function to fetch sample at a percentile (0..100)
+        int64_t getPercentile(double percentile) const;
+};
+
+/**
+ * @brief: structure to collect stats of all stages of one job
+ */
+struct TranscodeStats
+{
+    // time of every stage (micro seconds)
+    StageStats stages[TRANSCODE_STAGES];
+
+    // no of frames queued between decode and convert, sampled on push
+    StageStats decodeQueue;
+
+    // no of frames queued between convert and encode, sampled on push
+    StageStats encodeQueue;
+
+    // time demuxer waited for input data on every read (micro seconds)
+    StageStats inputWait;
+
+    // time muxer waited for output buffer space on every write (micro seconds)
+    StageStats outputWait;
+
+    // time from frame handed to encoder till its packet is muxed (micro seconds)
+    StageStats encodeLatency;
+
+    // no of frames held in encoder when a packet comes out
+    StageStats encodeDelay;
+
+    // function to add stats of other job part
+    void add(const TranscodeStats &transcodeStats);
+
+    // function to clear all stats
+    void reset();
+
+    // function to write stats as json object
+    void writeJson(FILE *jsonFp, const char *indent) const;
+};
+
+#endif // STAGE_STATS_H
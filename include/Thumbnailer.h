@@ -0,0 +1,89 @@
+#ifndef THUMBNAILER_H
+#define THUMBNAILER_H
+
+#include <string>
+#include <vector>
+
+#include "VideoDecoder.h"
+#include "ImageWriter.h"
+
+/**
+ * @brief: structure to define thumbnail options
+ */
+struct ThumbnailContext
+{
+    // output image, or filename pattern with %d for one image per sample
+    std::string outputFile;
+
+    // time between samples (seconds)
+    double interval;
+
+    // no of samples spread over video, 0 = samples by interval
+    int count;
+
+    // true = keyframe at or before sample time, false = exact frame
+    bool keyFrameOnly;
+
+    // image/tile width, <= 0 = input width, height keeps aspect ratio
+    int width;
+
+    // columns of contact sheet, 0 = one image per sample
+    int columns;
+
+    // jpeg quality scale (2..31, lower is better)
+    int quality;
+
+    /**
+     * @brief: constructor to initialize member data
+     */
+    ThumbnailContext()
+    {
+        // output image
+        outputFile = "thumb_%04d.jpg";
+
+        // one sample every 10 seconds
+        interval = 10.0;
+        count = 0;
+
+        // keyframes only
+        keyFrameOnly = true;
+
+        // thumbnail width
+        width = 320;
+
+        // one image per sample
+        columns = 0;
+
+        // jpeg quality
+        quality = 2;
+    }
+};
+
+/**
+ * @brief: Thumbnailer class
+ *          samples frames from a video by seeking, and writes them as
+ *          images or as one contact sheet
+ */
+class Thumbnailer
+{
+    // thumbnail options
+    ThumbnailContext m_thumbnailContext;
+
+    // writer of images
+    ImageWriter m_imageWriter;
+
+    // function to find sample times of video
+    int getSampleTimes(const VideoInfo &videoInfo, std::vector<double> &sampleTimes);
+
+    // function to make image filename of a sample
+    std::string getImageName(int index);
+
+    public:
+        // constructor for thumbnailer
+        Thumbnailer(const ThumbnailContext &thumbnailContext);
+
+        // function to sample frames of a video and write images
+        int extract(const std::string &inputFile, const VideoDecoderContext &decoderContext);
+};
+
+#endif // THUMBNAILER_H
@@ -0,0 +1,130 @@
+#ifndef TRANSCODE_PIPELINE_H
+#define TRANSCODE_PIPELINE_H
+
+#include <atomic>
+
+#include "VideoDecoder.h"
+#include "VideoEncoder.h"
+#include "FrameConverter.h"
+#include "FramePool.h"
+#include "FrameRateFilter.h"
+#include "RingBuffer.h"
+
+/**
+ * @brief: structure to report pipeline run statistics
+ */
+struct PipelineStats
+{
+    // no of frames decoded
+    int decodedFrames;
+
+    // no of decoded frames dropped for output frame rate
+    int droppedFrames;
+
+    // no of frames converted to encoder format
+    int convertedFrames;
+
+    // no of frames encoded
+    int encodedFrames;
+
+    // max no of frames queued between decode and convert
+    int maxDecodeQueue;
+
+    // max no of frames queued between convert and encode
+    int maxEncodeQueue;
+
+    // wall clock time of run (seconds)
+    double elapsedTime;
+
+    // convert stage time and queue depths, while StageStats is enabled
+    TranscodeStats stageStats;
+
+    /**
+     * @brief: constructor to initialize member data
+     */
+    PipelineStats()
+    {
+        decodedFrames = 0;
+        droppedFrames = 0;
+        convertedFrames = 0;
+        encodedFrames = 0;
+        maxDecodeQueue = 0;
+        maxEncodeQueue = 0;
+        elapsedTime = 0.0;
+    }
+};
+
+/**
+ * @brief: TranscodePipeline class
+ *          runs decode, convert and encode stages on separate threads,
+ *          connected by bounded queues of pooled frames
+ */
+class TranscodePipeline
+{
+    // opened video decoder
+    VideoDecoder *m_videoDecoder;
+
+    // started video encoder
+    VideoEncoder *m_videoEncoder;
+
+    // decoded frames, decode -> convert
+    RingBuffer<AVFrame*> m_decodeQueue;
+
+    // frames in encoder format, convert -> encode
+    RingBuffer<AVFrame*> m_encodeQueue;
+
+    // shell frames holding decoder references
+    FramePool m_shellPool;
+
+    // frames in encoder format
+    FramePool m_framePool;
+
+    // converter from decoder to encoder format
+    FrameConverter m_frameConverter;
+
+    // selects decoded frames for output frame rate
+    FrameRateFilter m_frameRateFilter;
+
+    // encoder frame format
+    PixelFormat m_pixFmt;
+    int m_width;
+    int m_height;
+
+    // flag to stop all stages on error
+    std::atomic<bool> m_abort;
+
+    // run statistics
+    PipelineStats m_stats;
+
+    // function to fetch a frame from pool, waits while pool is exhausted
+    AVFrame* waitForFrame(FramePool &framePool);
+
+    // function to release frames left in queues
+    void drainQueues();
+
+    // decode stage, runs demux and decode
+    void decodeStage();
+
+    // convert stage, runs colour conversion
+    void convertStage();
+
+    // encode stage, runs encode and mux
+    void encodeStage();
+
+    // disable copy
+    TranscodePipeline(const TranscodePipeline &);
+    TranscodePipeline& operator=(const TranscodePipeline &);
+
+    public:
+        // constructor for transcodepipeline
+        TranscodePipeline(VideoDecoder &videoDecoder, VideoEncoder &videoEncoder,
+                          int queueSize=8);
+
+        // function to run all stages until end of video
+        int run();
+
+        // function to fetch statistics of last run
+        PipelineStats getStats();
+};
+
+#endif // TRANSCODE_PIPELINE_H
@@ -0,0 +1,177 @@
+#ifndef TRANSCODE_SERVER_H
+#define TRANSCODE_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Transcoder.h"
+
+/**
+ * @brief: structure to hold one client connection of server, socket is
+ *          closed when last job of connection is answered
+ */
+struct ServerConnection
+{
+    // connected socket
+    int fd;
+
+    // lock for replies, written by reader and worker threads
+    std::mutex writeMutex;
+
+    // constructor for serverconnection
+    ServerConnection(int connFd);
+
+    // destructor for serverconnection, closes socket
+    ~ServerConnection();
+
+    // function to send one reply line
+    int sendLine(const std::string &line);
+};
+
+/**
+ * @brief: structure to hold one queued job of server
+ */
+struct ServerJob
+{
+    // job id, unique in server
+    int id;
+
+    // job to run
+    TranscodeJob job;
+
+    // connection to answer
+    std::shared_ptr<ServerConnection> connection;
+};
+
+/**
+ * @brief: TranscodeServer class
+ *          long running transcode daemon. clients connect to a unix domain
+ *          socket and send one job per line, jobs run on a pool of worker
+ *          threads started once, status and result of every job are sent
+ *          back on the same connection
+ *
+ *          protocol, tab separated key=value fields, one line each:
+ *              client: JOB  input=..  output=..  codec=H264 ..
+ *              server: ACCEPTED <id> | ERROR <reason>
+ *                      STARTED <id>
+ *                      DONE <id>  status=0  frames=..  time=..
+ */
+class TranscodeServer
+{
+    // no of worker threads
+    int m_workers;
+
+    // path of listening socket
+    std::string m_socketPath;
+
+    // listening socket, -1 = not started
+    int m_listenFd;
+
+    // flag to stop accepting and stop workers
+    std::atomic<bool> m_running;
+
+    // worker threads
+    std::vector<std::thread> m_workerThreads;
+
+    // jobs waiting for a worker
+    std::deque<ServerJob> m_jobQueue;
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCond;
+
+    // open connections, reader threads are detached and counted
+    std::vector<std::weak_ptr<ServerConnection> > m_connections;
+    int m_activeReaders;
+    std::mutex m_connMutex;
+    std::condition_variable m_connCond;
+
+    // id of next job
+    std::atomic<int> m_nextJobId;
+
+    // no of finished and failed jobs
+    std::atomic<int> m_doneJobs;
+    std::atomic<int> m_failedJobs;
+
+    // worker thread, runs queued jobs until server stops
+    void runWorker();
+
+    // connection thread, reads jobs of one client
+    void runConnection(std::shared_ptr<ServerConnection> connection);
+
+    // function to parse one request line and queue its job
+    void handleRequest(const std::shared_ptr<ServerConnection> &connection,
+                       const std::string &line);
+
+    // disable copy
+    TranscodeServer(const TranscodeServer &);
+    TranscodeServer& operator=(const TranscodeServer &);
+
+    public:
+        // constructor for transcodeserver
+        TranscodeServer(int workers=0);
+
+        // destructor for transcodeserver
+        ~TranscodeServer();
+
+        // function to listen on socket and start workers
+        int start(const std::string &socketPath);
+
+        // function to accept clients until stopped
+        int run();
+
+        // function to stop accepting, finish running jobs and stop workers
+        void stop();
+
+        // function to write job as request line
+        static std::string formatJob(const TranscodeJob &job);
+
+        // function to parse request line into job
+        static int parseJob(const std::string &line, TranscodeJob &job);
+};
+
+/**
+ * @brief: TranscodeClient class
+ *          local client of transcode server, submits jobs and waits for
+ *          their results
+ */
+class TranscodeClient
+{
+    // connected socket, -1 = not connected
+    int m_fd;
+
+    // bytes read after last reply line
+    std::string m_readBuffer;
+
+    // disable copy
+    TranscodeClient(const TranscodeClient &);
+    TranscodeClient& operator=(const TranscodeClient &);
+
+    public:
+        // constructor for transcodeclient
+        TranscodeClient();
+
+        // destructor for transcodeclient
+        ~TranscodeClient();
+
+        // function to connect to server socket
+        int connect(const std::string &socketPath);
+
+        // function to close connection
+        void close();
+
+        // function to send one job
+        int submit(const TranscodeJob &job);
+
+        // function to read next reply line
+        int readReply(std::string &reply);
+
+        // function to run jobs on server and wait for all results
+        int run(const std::vector<TranscodeJob> &jobs, std::vector<TranscodeResult> &results);
+};
+
+#endif // TRANSCODE_SERVER_H
@@ -0,0 +1,161 @@
+#ifndef TRANSCODER_H
+#define TRANSCODER_H
+
+#include <string>
+#include <vector>
+
+#include "VideoDecoder.h"
+#include "VideoEncoder.h"
+
+/**
+ * @brief: stream copy modes of a job, packets are copied only when input
+ *          is already in output codec, size and frame rate
+ */
+enum StreamCopyMode
+{
+    // always re-encode
+    STREAM_COPY_NONE,
+
+    // copy if no encode option (rate control, preset, gop..) is given
+    STREAM_COPY_AUTO,
+
+    // copy even if encode options are given, they are ignored
+    STREAM_COPY_FORCE
+};
+
+/**
+ * @brief: structure to define one transcoding job
+ */
+struct TranscodeJob
+{
+    // input video filename
+    std::string inputFile;
+
+    // output video filename
+    std::string outputFile;
+
+    // video decoder options
+    VideoDecoderContext decoderContext;
+
+    // output video options, width/height/frameRate <= 0 = same as input
+    VideoEncoderContext encoderContext;
+
+    // queue size of pipelined transcoding, 0 = serial
+    int pipelineQueue;
+
+    // copy packets without re-encoding when input matches output (StreamCopyMode)
+    int streamCopy;
+
+    // start of output in input video (seconds), <= 0 = start of video
+    double startTime;
+
+    // end of output in input video (seconds), <= 0 = end of video
+    double endTime;
+
+    // input video in memory, read instead of inputFile if set (not owned)
+    const uint8_t *inputData;
+    size_t inputSize;
+
+    // input video read callback, read instead of inputFile if set
+    MemoryReadCallback inputCallback;
+
+    // output video buffer, written instead of outputFile if set (not owned),
+    // outputFile still selects output format
+    std::vector<uint8_t> *outputBuffer;
+
+    // output video write callback, written instead of outputFile if set
+    MemoryWriteCallback outputCallback;
+
+    /**
+     * @brief: constructor to initialize member data
+     */
+    TranscodeJob()
+    {
+        // input and output video
+        inputFile = "";
+        outputFile = "";
+
+        // serial transcoding
+        pipelineQueue = 0;
+
+        // always re-encode
+        streamCopy = STREAM_COPY_NONE;
+
+        // whole video
+        startTime = 0.0;
+        endTime = 0.0;
+
+        // files, no memory input and output
+        inputData = NULL;
+        inputSize = 0;
+        outputBuffer = NULL;
+    }
+};
+
+/**
+ * @brief: structure to report result of one transcoding job
+ */
+struct TranscodeResult
+{
+    // input video filename
+    std::string inputFile;
+
+    // output video filename
+    std::string outputFile;
+
+    // job status, -1 = failure, 0 = success
+    int status;
+
+    // no of encoded frames
+    int frames;
+
+    // wall clock time of job (seconds)
+    double elapsedTime;
+
+    // stage stats of job, filled while StageStats is enabled
+    TranscodeStats stats;
+
+    /**
+     * @brief: constructor to initialize member data
+     */
+    TranscodeResult()
+    {
+        inputFile = "";
+        outputFile = "";
+        status = -1;
+        frames = 0;
+        elapsedTime = 0.0;
+    }
+};
+
+/**
+ * @brief: Transcoder class
+ *          transcodes one input video into one output video
+ */
+class Transcoder
+{
+    public:
+        // function to make ffmpeg safe to use from many threads
+        static int initThreading();
+
+        // function to open input and resolve output size and frame rate
+        static int openInput(VideoDecoder &videoDecoder, const std::string &inputFile,
+                             VideoDecoderContext decoderContext,
+                             VideoEncoderContext &encoderContext);
+
+        // function to run one transcoding job
+        static int transcode(const TranscodeJob &job, TranscodeResult &result);
+
+        // function to check if opened input can be copied to output without re-encoding
+        static bool canRemux(VideoDecoder &videoDecoder, const VideoEncoderContext &encoderContext,
+                             int streamCopy);
+
+        // function to run one job by copying packets, no decoding and encoding
+        static int remux(const TranscodeJob &job, TranscodeResult &result);
+
+        // function to write results of jobs as json report
+        static int writeReport(const std::string &reportFile,
+                               const std::vector<TranscodeResult> &results);
+};
+
+#endif // TRANSCODER_H
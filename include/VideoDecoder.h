@@ -2,6 +2,14 @@
 #define VIDEO_DECODER_H
 
 #include <string>
+#include <vector>
+
+#include "FrameConverter.h"
+#include "FramePool.h"
+#include "KeyFrameIndex.h"
+#include "ReadaheadIO.h"
+#include "MemoryIO.h"
+#include "StageStats.h"
 
 // ffmpeg header files.
 extern "C" {
@@ -69,6 +77,48 @@ struct VideoInfo
     }
 };
 
+/**
+ * @brief: structure to define video decoder options
+ */
+struct VideoDecoderContext
+{
+    // no of decoding threads, 0 = auto from no of cpu cores
+    int threadCount;
+
+    // threading type, FF_THREAD_FRAME and/or FF_THREAD_SLICE
+    int threadType;
+
+    // decode at 1/2^lowres of input size where codec supports it, 0 = full size
+    int lowres;
+
+    // use keyframe index file of video if present, 0 = never
+    int keyFrameIndex;
+
+    // read input through readahead buffer of this size (bytes), 0 = ffmpeg file i/o
+    int readaheadSize;
+
+    /**
+     * @brief: constructor to initialize member data
+     */
+    VideoDecoderContext()
+    {
+        // auto thread count
+        threadCount = 0;
+
+        // frame threading, slice threading if codec has no frame threading
+        threadType = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+        // full size decoding
+        lowres = 0;
+
+        // keyframe index if present
+        keyFrameIndex = 1;
+
+        // ffmpeg file i/o
+        readaheadSize = 0;
+    }
+};
+
 /**
  * @brief: VideoDecoder class 
  *          decode frames from video into rgb24
@@ -96,6 +146,12 @@ class VideoDecoder
     // converted rgb frame
     AVFrame m_avFrameRGB;
 
+    // converter from input format to rgb24
+    FrameConverter m_frameConverter;
+
+    // pool of frames handed out by decoder
+    FramePool m_framePool;
+
     // avpkt
     AVPacket m_avPkt;
 
@@ -112,17 +168,49 @@ class VideoDecoder
     int m_totalFrames;
 
     // total duration of video
-    int m_totalDuration;
+    int64_t m_totalDuration;
 
     // frame rate of input video
     int m_frameRate;
 
+    // flag set when all packets are read
+    int m_endOfVideo;
+
+    // frames before this timestamp are skipped, AV_NOPTS_VALUE = none
+    int64_t m_rangeStartTs;
+
+    // frames from this timestamp on end video, AV_NOPTS_VALUE = none
+    int64_t m_rangeEndTs;
+
+    // video decoder options
+    VideoDecoderContext m_decoderContext;
+
+    // keyframe index of video, loaded if present
+    KeyFrameIndex m_keyFrameIndex;
+
+    // readahead input of video, open if enabled
+    ReadaheadIO m_readaheadIO;
+
+    // input buffer or read callback, read instead of input file if set
+    const uint8_t *m_inputData;
+    size_t m_inputSize;
+    MemoryReadCallback m_inputCallback;
+
+    // memory input of video, open while memory input is read
+    MemoryIO m_memoryIO;
+
+    // demux, decode and convert stats of opened video
+    TranscodeStats m_stats;
+
     // function to initialize private member data
     void initLocals();
 
     // function to read one frame from video and decode
     int readAndDecodeFrame();
 
+    // function to read and decode next frame, ignoring range
+    int decodeFrame();
+
     public:
         // default constructor for videodecoder
         VideoDecoder();
@@ -133,17 +221,76 @@ class VideoDecoder
         // destructor for videodecoder
         ~VideoDecoder();
 
+        // function to set decoder options, applied on next openVideo
+        void setDecoderContext(const VideoDecoderContext &decoderContext);
+
         // function to open input video
         int openVideo(std::string inpVideoFilePath="");
 
+        // function to read input video from memory buffer instead of file
+        void setInputBuffer(const uint8_t *data, size_t size);
+
+        // function to read input video from callback instead of file
+        void setInputCallback(const MemoryReadCallback &readCallback);
+
+        // function to check if input video can be opened again
+        bool canReopen();
+
         // function to close video if opened
         void closeVideo();
 
         // function to fetch one decoded frame from input video
         int getNewFrame(unsigned char *frameArray);
 
+#ifdef FFMPEG_2_7_6
+        // function to fetch one decoded frame as planes, without conversion
+        int getNewFrame(AVFrame *avFrame);
+
+        // function to fetch one decoded frame owned by frame pool
+        AVFrame* getNewPooledFrame(PixelFormat pixFmt=PIX_FMT_NONE);
+
+        // function to fetch the frame at a time, by seeking
+        int getFrameAt(double seconds, AVFrame *avFrame, bool keyFrameOnly=true);
+#endif
+
         // function to fetch video information of the input video
         int getVideoInfo(VideoInfo &videoInfo);
+
+        // function to fetch average rgb conversion time per frame
+        double getAvgConvertTime();
+
+        // function to find all keyframes by reading packets, without decoding
+        int probeKeyFrames(std::vector<KeyFrameInfo> &keyFrames);
+
+        // function to seek to keyframe at or before the given timestamp
+        int seekToKeyFrame(int64_t pts);
+
+        // function to seek to a time, frame accurate
+        int seek(double seconds);
+
+        // function to end video at a time, <= 0 = end of video
+        void setEndTime(double seconds);
+
+        // function to convert time from start of video to stream timestamp
+        int64_t getTimestamp(double seconds);
+
+        // function to read one packet of video stream, without decoding
+        int readPacket(AVPacket *avPkt);
+
+        // function to fetch stage stats of opened video
+        const TranscodeStats& getStats();
+
+        // function to fetch video stream of input video
+        AVStream* getVideoStream();
+
+        // function to skip decoding of non reference frames
+        void setSkipNonRefFrames(bool skip);
+
+        // function to fetch highest lowres level supported by codec of opened video
+        int getMaxLowres();
+
+        // function to find lowres level still decoding at least the given size
+        static int getLowresForSize(int inpWidth, int inpHeight, int outWidth, int outHeight);
 };
 
 #endif // VIDEO_DECODER_H
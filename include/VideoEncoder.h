@@ -3,12 +3,64 @@
 
 #include <string>
 
+#include "FrameConverter.h"
+#include "FramePool.h"
+#include "AsyncWriterIO.h"
+#include "MemoryIO.h"
+#include "StageStats.h"
+
 // ffmpeg header files.
 extern "C" {
     #include <libavformat/avformat.h>
     #include <libswscale/swscale.h>
 }
 
+/**
+ * @brief: rate control modes of output video
+ */
+enum VideoRateControl
+{
+    // codec default, bit rate with quality scale
+    RATE_CONTROL_DEFAULT,
+
+    // constant quantizer, from quality
+    RATE_CONTROL_CQP,
+
+    // constant rate factor, from crf (H264 only)
+    RATE_CONTROL_CRF,
+
+    // average bit rate, from bitRate
+    RATE_CONTROL_ABR
+};
+
+/**
+ * @brief: scaling modes of output video, when width and height are both set
+ */
+enum VideoScaleMode
+{
+    // exactly width x height, aspect ratio may change
+    SCALE_MODE_STRETCH,
+
+    // largest size within width x height, keeping aspect ratio
+    SCALE_MODE_FIT
+};
+
+/**
+ * @brief: segmented output formats, segments are cut at keyframes and the
+ *          playlist/manifest is updated as every segment is written
+ */
+enum VideoSegmentFormat
+{
+    // one output file
+    SEGMENT_FORMAT_NONE,
+
+    // MPEG-TS segments and HLS playlist (.m3u8)
+    SEGMENT_FORMAT_HLS,
+
+    // fragmented MP4 segments and DASH manifest (.mpd)
+    SEGMENT_FORMAT_DASH
+};
+
 /**
  * @brief: Video Encoder structure
  */
@@ -20,17 +72,63 @@ struct VideoEncoderContext
     // output video codec
     std::string codecStr;
 
-    // output video width
+    // output container (mpegts/mp4/matroska..), empty = from output filename
+    std::string containerFormat;
+
+    // output video width, <= 0 = from height keeping aspect ratio, or input width
     int width;
 
-    // output video height
+    // output video height, <= 0 = from width keeping aspect ratio, or input height
     int height;
 
+    // scaling mode, when width and height are both set
+    VideoScaleMode scaleMode;
+
     // output framerate
     int frameRate;
 
     // output video quality
     int quality;
+
+    // no of encoding threads, 0 = auto from no of cpu cores
+    int threadCount;
+
+    // x264 preset (ultrafast..placebo), empty = legacy tuning
+    std::string preset;
+
+    // x264 tune (film, animation, zerolatency..), empty = none
+    std::string tune;
+
+    // rate control mode
+    VideoRateControl rateControl;
+
+    // constant rate factor, used with RATE_CONTROL_CRF
+    int crf;
+
+    // output bit rate (bits/sec), used with RATE_CONTROL_ABR
+    int bitRate;
+
+    // gop length (frames between keyframes)
+    int gopSize;
+
+    // write output through async writer with buffer of this size (bytes), 0 = ffmpeg file i/o
+    int writeBufferSize;
+
+    // expected output size (bytes) reserved up front by async writer, 0 = unknown
+    int64_t preallocSize;
+
+    // segmented output, output filename is playlist/manifest
+    VideoSegmentFormat segmentFormat;
+
+    // target segment duration (seconds), segments end at next keyframe
+    double segmentTime;
+
+    // low latency encoding: no b-frames/lookahead, slice threads, packets
+    // flushed as muxed, encoder latency measured per frame
+    bool lowLatency;
+
+    // H264 periodic intra refresh instead of keyframes (gop = refresh period)
+    bool intraRefresh;
     
     /**
      * @brief: constructor to initialize member data
@@ -43,17 +141,54 @@ struct VideoEncoderContext
         // output video codec 
         codecStr = "";
 
+        // container from output filename
+        containerFormat = "";
+
         // output video width
         width = -1;
 
         // output video height
         height = -1;
 
+        // exact output size
+        scaleMode = SCALE_MODE_STRETCH;
+
         // output video framerate
         frameRate = 0;
 
         // output video quality
         quality = 2;
+
+        // auto encoding threads
+        threadCount = 0;
+
+        // no preset and tune
+        preset = "";
+        tune = "";
+
+        // codec default rate control
+        rateControl = RATE_CONTROL_DEFAULT;
+
+        // default x264 rate factor
+        crf = 23;
+
+        // output bit rate
+        bitRate = 400000;
+
+        // gop length
+        gopSize = 12;
+
+        // ffmpeg file i/o, no reserved space
+        writeBufferSize = 0;
+        preallocSize = 0;
+
+        // one output file
+        segmentFormat = SEGMENT_FORMAT_NONE;
+        segmentTime = 4.0;
+
+        // encoding for compression, not latency
+        lowLatency = false;
+        intraRefresh = false;
     }
 };
 
@@ -75,23 +210,43 @@ class VideoEncoder
     // codec context
     AVCodecContext *m_avCodecCtx;
 
-    // frame
-    AVFrame *m_avFrame;
-
     // stream index
     int m_streamIdx;
 
+    // output codec id
+    int m_codecId;
+
     // frame count
     int m_frameCount;
 
-    // input picture buffer
-    uint8_t *m_pictureInpBuf;
+    // time frame was handed to encoder (micro seconds), 0 = not measured
+    int64_t m_inputTime;
+
+    // input times of frames held in encoder, by frame count
+    std::vector<int64_t> m_frameInputTimes;
+
+    // frame handed to encoder, points to planes of caller's frame so the
+    // caller's frame is never changed, it may be shared by other encoders
+    AVFrame *m_encodeFrame;
+
+    // converter from rgb24 to encoder format
+    FrameConverter m_frameConverter;
 
-    // output picture buffer
-    uint8_t *m_pictureOutBuf;
+    // convert, encode and write stats of output video
+    TranscodeStats m_stats;
 
-    // output picture buffer size
-    int m_pictureOutBufSize;
+    // pool of frames in encoder format
+    FramePool m_framePool;
+
+    // async writer of output video, open if enabled
+    AsyncWriterIO m_writerIO;
+
+    // output buffer or write callback, written instead of output file if set
+    std::vector<uint8_t> *m_outputBuffer;
+    MemoryWriteCallback m_outputCallback;
+
+    // memory output of video, open while memory output is written
+    MemoryIO m_memoryIO;
     
     // Video Encoder Context member data
     struct VideoEncoderContext m_encoderContext;
@@ -99,9 +254,6 @@ class VideoEncoder
     // flag to check for encoder context set
     int m_encoderCtxSet;
  
-    // function to clean encoder
-    void cleanEncoder();
-
     // function to initialize video
     int initializeVideo();
 
@@ -111,8 +263,26 @@ class VideoEncoder
     // function to initialize encoder
     int initEncoder();
 
+    // function to write header with muxer options
+    int writeHeader();
+
+    // function to open output file of format context
+    int openOutput(const char *outputFile);
+
+    // function to close output file of format context
+    void closeOutput();
+
+    // function to free output of a failed start
+    void freeOutput();
+
     // function to add a frame after conversion
-    int addFrame();
+    int addFrame(AVFrame *avFrame);
+
+    // function to encode a frame and write its packet
+    int encodeFrame(AVFrame *avFrame);
+
+    // function to write frames delayed in encoder
+    int flushEncoder();
 
     // function to add stream 
     AVStream* addStream();
@@ -120,8 +290,9 @@ class VideoEncoder
     // function to open video
     int openVideo();
 
-    // function to allocate frame
-    AVFrame* allocFrame();
+    // function to convert planes to encoder format and add frame
+    int convertAndAddFrame(const uint8_t *const srcData[], const int srcLinesize[],
+                           int srcWidth, int srcHeight, PixelFormat srcFormat);
 
     // function to initialize member data
     void initLocals();
@@ -142,14 +313,55 @@ class VideoEncoder
         // function to start video encoding
         int startVideoEncode();
 
+        // function to write output video to growable buffer instead of file
+        void setOutputBuffer(std::vector<uint8_t> *buffer);
+
+        // function to write output video to callback instead of file
+        void setOutputCallback(const MemoryWriteCallback &writeCallback);
+
         // function to stop video encoding
         int stopVideoEncode();
 
         // function to add new frame
         int addNewFrame(unsigned char *frameArr);
+
+        // function to add new planar frame, converted only if format differs
+        int addNewFrame(AVFrame *avFrame);
     
         // function to check status of encoder context
         int encoderCtxSet();
+
+        // function to fetch average conversion time per frame
+        double getAvgConvertTime();
+
+        // function to fetch stage stats of output video
+        const TranscodeStats& getStats();
+
+        // function to clear stage stats
+        void resetStats();
+
+        // function to fetch format of frames accepted without conversion
+        int getFrameFormat(PixelFormat &pixFmt, int &width, int &height);
+
+        // function to fetch output frame rate
+        int getFrameRate();
+
+        // function to find codec of output video format
+        static int getCodecId(const std::string &codecStr);
+
+        // function to find output size for an input size
+        static void getOutputSize(const struct VideoEncoderContext &encoderCtx, int inpWidth,
+                                  int inpHeight, int &outWidth, int &outHeight);
+
+        // function to start writing packets of an input stream, no encoding
+        int startStreamCopy(const AVStream *inpStream);
+
+        // function to find output format of output file, as used by encoder
+        static AVOutputFormat* guessOutputFormat(const VideoEncoderContext &encoderContext,
+                                                 const char *outputFile);
+
+        // function to write an already encoded packet
+        int addPacket(AVPacket *avPkt, AVRational timeBase);
 };
 
 #endif // VIDEO_ENCODER_H
@@ -0,0 +1,416 @@
+
+/**
+ * Description: AsyncWriterIO Class
+ *                  write muxed output through a ring buffer, written to
+ *                  file in large blocks by a background thread
+ */
+
+#include "AsyncWriterIO.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+extern "C" {
+    #include <libavutil/common.h>
+    #include <libavutil/mem.h>
+}
+
+// bytes buffered before writer thread writes them
+#define WRITER_BLOCK_SIZE (1024 * 1024)
+
+// size of avio buffer, muxer writes are copied to ring buffer
+#define WRITER_AVIO_SIZE (64 * 1024)
+
+using namespace std;
+
+/**
+ * @brief: Default constructor for AsyncWriterIO
+ *          no output is open
+ */
+AsyncWriterIO::AsyncWriterIO()
+{
+    m_fd = -1;
+    m_flushPos = 0;
+    m_flushOffset = 0;
+    m_filled = 0;
+    m_fileSize = 0;
+    m_preallocSize = 0;
+    m_error = 0;
+    m_flush = false;
+    m_stop = false;
+    m_avioCtx = NULL;
+    m_bytesWritten = 0;
+    m_writes = 0;
+    m_seeks = 0;
+}
+
+/**
+ * @brief: destructor, write buffered bytes and close output
+ */
+AsyncWriterIO::~AsyncWriterIO()
+{
+    // function call to close output
+    close();
+}
+
+/**
+ * @brief: function to create output file and start writer thread. file
+ *          space is reserved up front when output size is known, so file
+ *          system does not extend it on every write
+ *
+ * @params: output filename, size of ring buffer (bytes), expected output
+ *          size (bytes, 0 = unknown)
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int AsyncWriterIO::open(const string &outputFile, int bufferSize, int64_t preallocSize)
+{
+    close();
+
+    m_fd = ::open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "AsyncWriterIO:: Could not create file: %s\n" "\x1b[0m",
+                                                                    outputFile.c_str());
+        return -1; // return failure
+    }
+
+    // reserve file space, file is cut to written size on close
+    m_preallocSize = 0;
+    if (preallocSize > 0 && fallocate(m_fd, 0, 0, (off_t)preallocSize) == 0)
+        m_preallocSize = preallocSize;
+
+    // ring buffer, at least two blocks
+    m_buffer.assign((size_t)FFMAX(bufferSize, 2 * WRITER_BLOCK_SIZE), 0);
+
+    // avio context, buffer is owned by context
+    uint8_t *avioBuffer = (uint8_t *)av_malloc(WRITER_AVIO_SIZE);
+    if (avioBuffer)
+        m_avioCtx = avio_alloc_context(avioBuffer, WRITER_AVIO_SIZE, 1, this,
+                                       NULL, &AsyncWriterIO::writePacket, &AsyncWriterIO::seek);
+
+    if (!m_avioCtx)
+    {
+        av_free(avioBuffer);
+        close();
+        return -1; // return failure
+    }
+
+    // reset write state and counters
+    m_flushPos = 0;
+    m_flushOffset = 0;
+    m_filled = 0;
+    m_fileSize = 0;
+    m_error = 0;
+    m_flush = false;
+    m_stop = false;
+    m_waitStats.reset();
+    m_bytesWritten = 0;
+    m_writes = 0;
+    m_seeks = 0;
+
+    // start writing buffer
+    m_thread = thread(&AsyncWriterIO::writerThread, this);
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to write buffered bytes, stop writer thread and close
+ *          output file. muxer must not use avio context any more
+ *
+ * @return: returns -1 if any write failed, 0 on success
+ */
+int AsyncWriterIO::close()
+{
+    int status = 0;
+
+    // write bytes left in avio buffer and ring buffer
+    if (m_thread.joinable())
+    {
+        avio_flush(m_avioCtx);
+
+        {
+            unique_lock<mutex> lock(m_mutex);
+            drain(lock);
+            m_stop = true;
+        }
+
+        m_dataReady.notify_all();
+        m_thread.join();
+
+        status = m_error < 0 || m_avioCtx->error < 0 ? -1 : 0;
+    }
+
+    // free avio context and its buffer
+    if (m_avioCtx)
+    {
+        av_freep(&m_avioCtx->buffer);
+        av_freep(&m_avioCtx);
+    }
+
+    if (m_fd >= 0)
+    {
+        // cut unused reserved space
+        if (m_preallocSize > 0 && ftruncate(m_fd, (off_t)m_fileSize) != 0)
+            status = -1;
+
+        if (::close(m_fd) != 0)
+            status = -1;
+
+        m_fd = -1;
+    }
+
+    // release ring buffer
+    vector<uint8_t>().swap(m_buffer);
+
+    if (status < 0)
+        fprintf(stderr, "\x1b[31m" "AsyncWriterIO:: Could not write output\n" "\x1b[0m");
+
+    return status;
+}
+
+/**
+ * @brief: function to check if output is open
+ *
+ * @return: true if open, false otherwise
+ */
+bool AsyncWriterIO::isOpen()
+{
+    return m_avioCtx != NULL;
+}
+
+/**
+ * @brief: writer thread, writes buffered bytes once a block is buffered,
+ *          or all of them on flush. file is written without lock, muxer
+ *          only fills free space, so both never touch the same bytes
+ */
+void AsyncWriterIO::writerThread()
+{
+    unique_lock<mutex> lock(m_mutex);
+
+    while (true)
+    {
+        // wait for a full block, a flush or stop
+        if (m_filled == 0 || (m_filled < WRITER_BLOCK_SIZE && !m_flush && !m_stop))
+        {
+            if (m_stop && m_filled == 0)
+                break;
+
+            m_dataReady.wait(lock);
+            continue;
+        }
+
+        // buffered bytes, up to end of ring
+        size_t bufferSize = m_buffer.size();
+        size_t flushOffset = m_flushOffset;
+        size_t bytes = FFMIN(m_filled, bufferSize - flushOffset);
+        int64_t filePos = m_flushPos;
+
+        // write without lock, after a failed write bytes are dropped
+        int writeError = m_error;
+        lock.unlock();
+
+        size_t written = 0;
+        while (writeError == 0 && written < bytes)
+        {
+            ssize_t status = pwrite(m_fd, &m_buffer[flushOffset + written], bytes - written,
+                                                        (off_t)(filePos + (int64_t)written));
+            if (status > 0)
+                written += (size_t)status;
+            else if (status < 0 && errno != EINTR)
+                writeError = AVERROR(errno);
+        }
+
+        lock.lock();
+
+        if (writeError < 0 && m_error == 0)
+            m_error = writeError;
+
+        // free written bytes
+        m_flushOffset = (flushOffset + bytes) % bufferSize;
+        m_filled -= bytes;
+        m_flushPos += (int64_t)bytes;
+        m_bytesWritten += (int64_t)written;
+        m_writes++;
+
+        m_spaceReady.notify_one();
+    }
+}
+
+/**
+ * @brief: function to wait till all buffered bytes are written, time of
+ *          wait is counted as muxer wait
+ *
+ * @params: lock of m_mutex, held by caller
+ */
+void AsyncWriterIO::drain(unique_lock<mutex> &lock)
+{
+    if (m_filled == 0)
+        return;
+
+    int64_t startTime = av_gettime_relative();
+
+    m_flush = true;
+    m_dataReady.notify_one();
+
+    while (m_filled > 0)
+        m_spaceReady.wait(lock);
+
+    m_flush = false;
+
+    m_waitStats.addSample(av_gettime_relative() - startTime);
+}
+
+/**
+ * @brief: avio write callback, copies bytes to ring buffer, waits only if
+ *          writer thread is behind muxer
+ *
+ * @params: asyncwriterio, bytes to write, no of bytes
+ *
+ * @return: no of bytes written, AVERROR on failure
+ */
+int AsyncWriterIO::writePacket(void *opaque, uint8_t *buf, int bufSize)
+{
+    AsyncWriterIO *writerIO = (AsyncWriterIO *)opaque;
+
+    unique_lock<mutex> lock(writerIO->m_mutex);
+
+    size_t bufferSize = writerIO->m_buffer.size();
+    size_t remaining = (size_t)bufSize;
+    int64_t waitTime = 0;
+
+    while (remaining > 0 && writerIO->m_error == 0)
+    {
+        // wait for space, time of wait is the i/o stall of muxer
+        if (writerIO->m_filled == bufferSize)
+        {
+            int64_t startTime = av_gettime_relative();
+            while (writerIO->m_filled == bufferSize)
+                writerIO->m_spaceReady.wait(lock);
+
+            waitTime += av_gettime_relative() - startTime;
+            continue;
+        }
+
+        // free space, up to end of ring
+        size_t writeOffset = (writerIO->m_flushOffset + writerIO->m_filled) % bufferSize;
+        size_t bytes = FFMIN(remaining, bufferSize - writerIO->m_filled);
+        bytes = FFMIN(bytes, bufferSize - writeOffset);
+
+        // copy without lock, writer thread does not read free space
+        lock.unlock();
+        memcpy(&writerIO->m_buffer[writeOffset], buf + (bufSize - remaining), bytes);
+        lock.lock();
+
+        writerIO->m_filled += bytes;
+        remaining -= bytes;
+
+        // wake writer thread once a block is buffered
+        if (writerIO->m_filled >= WRITER_BLOCK_SIZE)
+            writerIO->m_dataReady.notify_one();
+    }
+
+    writerIO->m_waitStats.addSample(waitTime);
+
+    // file grows to end of buffered bytes
+    int64_t writePos = writerIO->m_flushPos + (int64_t)writerIO->m_filled;
+    writerIO->m_fileSize = FFMAX(writerIO->m_fileSize, writePos);
+
+    return writerIO->m_error < 0 ? writerIO->m_error : bufSize;
+}
+
+/**
+ * @brief: avio seek callback, used by muxers to rewrite headers. buffered
+ *          bytes are written first, then writing continues at new position
+ *
+ * @params: asyncwriterio, offset, whence (SEEK_SET/SEEK_CUR/SEEK_END/AVSEEK_SIZE)
+ *
+ * @return: new position, file size for AVSEEK_SIZE, AVERROR on failure
+ */
+int64_t AsyncWriterIO::seek(void *opaque, int64_t offset, int whence)
+{
+    AsyncWriterIO *writerIO = (AsyncWriterIO *)opaque;
+
+    whence &= ~AVSEEK_FORCE;
+
+    unique_lock<mutex> lock(writerIO->m_mutex);
+
+    if (whence == AVSEEK_SIZE)
+        return writerIO->m_fileSize;
+
+    // target position
+    int64_t writePos = writerIO->m_flushPos + (int64_t)writerIO->m_filled;
+    int64_t position = offset;
+    if (whence == SEEK_CUR)
+        position += writePos;
+    else if (whence == SEEK_END)
+        position += writerIO->m_fileSize;
+    else if (whence != SEEK_SET)
+        return AVERROR(EINVAL);
+
+    if (position < 0)
+        return AVERROR(EINVAL);
+
+    // already there, nothing to write
+    if (position == writePos)
+        return position;
+
+    writerIO->m_seeks++;
+
+    // write bytes before seek position, then continue at new position
+    writerIO->drain(lock);
+
+    writerIO->m_flushPos = position;
+    writerIO->m_flushOffset = 0;
+
+    return writerIO->m_error < 0 ? writerIO->m_error : position;
+}
+
+/**
+ * @brief: function to fetch avio context for muxer
+ *
+ * @return: avio context, NULL if no output is open
+ */
+AVIOContext* AsyncWriterIO::getAVIOContext()
+{
+    return m_avioCtx;
+}
+
+/**
+ * @brief: function to fetch time muxer waited for buffer space, one sample
+ *          per write and seek, 0 if space was free
+ *
+ * @return: wait stats (micro seconds)
+ */
+const StageStats& AsyncWriterIO::getWaitStats()
+{
+    return m_waitStats;
+}
+
+/**
+ * @brief: function to fetch no of bytes written to file
+ */
+int64_t AsyncWriterIO::getBytesWritten()
+{
+    return m_bytesWritten;
+}
+
+/**
+ * @brief: function to fetch no of file writes
+ */
+int AsyncWriterIO::getWrites()
+{
+    return m_writes;
+}
+
+/**
+ * @brief: function to fetch no of seeks
+ */
+int AsyncWriterIO::getSeeks()
+{
+    return m_seeks;
+}
@@ -0,0 +1,274 @@
+
+/**
+ * Description: BatchTranscoder Class
+ *                  transcode many videos on a pool of worker threads
+ */
+
+#include "BatchTranscoder.h"
+
+#include <set>
+#include <thread>
+#include <unistd.h>
+
+extern "C" {
+    #include <libavutil/time.h>
+}
+
+using namespace std;
+
+/**
+ * @brief: Parameterized constructor for BatchTranscoder
+ *
+ * @params: no of concurrent jobs, default = 1
+ */
+BatchTranscoder::BatchTranscoder(int workers)
+{
+    // at least one worker
+    m_workers = workers > 0 ? workers : 1;
+
+    // next job
+    m_nextJob = 0;
+
+    // run time
+    m_elapsedTime = 0.0;
+}
+
+/**
+ * @brief: function to make output filename from template.
+ *          %n = input filename without directory and extension,
+ *          %i = job index, %% = %
+ *
+ * @params: filename template, input filename, job index
+ *
+ * @return: output filename
+ */
+string BatchTranscoder::makeOutputName(const string &nameTemplate, const string &inputFile,
+                                       int index)
+{
+    // input filename without directory
+    string baseName = inputFile;
+    size_t pos = baseName.find_last_of('/');
+    if (pos != string::npos)
+        baseName = baseName.substr(pos + 1);
+
+    // input filename without extension
+    pos = baseName.find_last_of('.');
+    if (pos != string::npos && pos > 0)
+        baseName = baseName.substr(0, pos);
+
+    string outputFile = "";
+
+    // replace tokens of template
+    for (size_t i = 0; i < nameTemplate.size(); i++)
+    {
+        if (nameTemplate[i] == '%' && i + 1 < nameTemplate.size())
+        {
+            char token = nameTemplate[i + 1];
+
+            if (token == 'n')
+            {
+                outputFile += baseName;
+                i++;
+                continue;
+            }
+            else if (token == 'i')
+            {
+                outputFile += to_string(index);
+                i++;
+                continue;
+            }
+            else if (token == '%')
+            {
+                outputFile += '%';
+                i++;
+                continue;
+            }
+        }
+
+        outputFile += nameTemplate[i];
+    }
+
+    return outputFile;
+}
+
+/**
+ * @brief: function to check that no two jobs write the same output, e.g.
+ *          inputs with same name in different directories and a template
+ *          without %i. concurrent jobs would corrupt the shared file
+ *
+ * @params: jobs to check
+ *
+ * @return: returns -1 if an output is written by more than one job, 0 otherwise
+ */
+int BatchTranscoder::checkOutputNames(const vector<TranscodeJob> &jobs)
+{
+    set<string> outputFiles;
+
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        if (!outputFiles.insert(jobs[i].outputFile).second)
+        {
+            fprintf(stderr, "\x1b[31m" "BatchTranscoder:: Output %s of %s is written by more "
+                            "than one job, add %%i to output template\n" "\x1b[0m",
+                            jobs[i].outputFile.c_str(), jobs[i].inputFile.c_str());
+            return -1; // return failure
+        }
+    }
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to add one job for each input
+ *
+ * @params: input filenames, output filename template, job with common options
+ */
+void BatchTranscoder::addJobs(const vector<string> &inputFiles, const string &nameTemplate,
+                              const TranscodeJob &jobTemplate)
+{
+    for (size_t i = 0; i < inputFiles.size(); i++)
+    {
+        TranscodeJob job = jobTemplate;
+        job.inputFile = inputFiles[i];
+        job.outputFile = makeOutputName(nameTemplate, inputFiles[i], (int)m_jobs.size());
+        m_jobs.push_back(job);
+    }
+}
+
+/**
+ * @brief: function to add one job
+ *
+ * @params: job to add
+ */
+void BatchTranscoder::addJob(const TranscodeJob &job)
+{
+    m_jobs.push_back(job);
+}
+
+/**
+ * @brief: worker thread, runs jobs until none is left
+ */
+void BatchTranscoder::runWorker()
+{
+    // loop for all remaining jobs
+    for (int job = m_nextJob++; job < (int)m_jobs.size(); job = m_nextJob++)
+    {
+        Transcoder::transcode(m_jobs[job], m_results[job]);
+
+        fprintf(stderr, "\x1b[32m" "BatchTranscoder:: Job %d %s: %s\n" "\x1b[0m", job,
+                m_results[job].status == 0 ? "done" : "failed", m_jobs[job].inputFile.c_str());
+    }
+}
+
+/**
+ * @brief: function to run all jobs on worker threads
+ *
+ * @return: returns no of failed jobs
+ */
+int BatchTranscoder::run()
+{
+    // make ffmpeg safe to use from workers
+    if (Transcoder::initThreading() < 0)
+        return (int)m_jobs.size(); // all failed
+
+    // jobs must not share an output file
+    if (checkOutputNames(m_jobs) < 0)
+    {
+        m_results.assign(m_jobs.size(), TranscodeResult());
+        for (size_t i = 0; i < m_jobs.size(); i++)
+        {
+            m_results[i].inputFile = m_jobs[i].inputFile;
+            m_results[i].outputFile = m_jobs[i].outputFile;
+        }
+
+        return (int)m_jobs.size(); // all failed
+    }
+
+    // share cpu cores among workers, where threads are auto
+    int cores = FFMAX((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+    int threadsPerJob = FFMAX(cores / m_workers, 1);
+
+    for (size_t i = 0; i < m_jobs.size(); i++)
+    {
+        if (m_jobs[i].decoderContext.threadCount <= 0)
+            m_jobs[i].decoderContext.threadCount = threadsPerJob;
+
+        if (m_jobs[i].encoderContext.threadCount <= 0)
+            m_jobs[i].encoderContext.threadCount = threadsPerJob;
+    }
+
+    // reset results
+    m_results.assign(m_jobs.size(), TranscodeResult());
+    m_nextJob = 0;
+
+    // run start time
+    int64_t startTime = av_gettime_relative();
+
+    // start workers, no more than jobs
+    vector<thread> workers;
+    int noOfWorkers = FFMIN(m_workers, (int)m_jobs.size());
+    for (int i = 0; i < noOfWorkers; i++)
+        workers.push_back(thread(&BatchTranscoder::runWorker, this));
+
+    // wait for all workers
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    m_elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+
+    // count failed jobs
+    int failedJobs = 0;
+    for (size_t i = 0; i < m_results.size(); i++)
+        if (m_results[i].status != 0)
+            failedJobs++;
+
+    return failedJobs;
+}
+
+/**
+ * @brief: function to fetch result of every job
+ *
+ * @return: results, same order as jobs
+ */
+const vector<TranscodeResult>& BatchTranscoder::getResults()
+{
+    return m_results;
+}
+
+/**
+ * @brief: function to print per job and aggregate summary
+ */
+void BatchTranscoder::printSummary()
+{
+    int failedJobs = 0;
+    long totalFrames = 0;
+    double jobTime = 0.0;
+
+    printf("==============================================\n");
+
+    // per job summary
+    for (size_t i = 0; i < m_results.size(); i++)
+    {
+        const TranscodeResult &result = m_results[i];
+
+        printf("[%3d] %-6s %6d frames %8.2f sec %8.1f fps  %s -> %s\n", (int)i,
+               result.status == 0 ? "OK" : "FAILED", result.frames, result.elapsedTime,
+               result.elapsedTime > 0 ? result.frames / result.elapsedTime : 0.0,
+               result.inputFile.c_str(), result.outputFile.c_str());
+
+        if (result.status != 0)
+            failedJobs++;
+
+        totalFrames += result.frames;
+        jobTime += result.elapsedTime;
+    }
+
+    // aggregate summary
+    printf("==============================================\n");
+    printf("Jobs           :   %d (%d failed, %d workers)\n", (int)m_results.size(),
+                                                            failedJobs, m_workers);
+    printf("Frames         :   %ld\n", totalFrames);
+    printf("Wall time      :   %.2f sec (%.2f sec of job time)\n", m_elapsedTime, jobTime);
+    printf("Throughput     :   %.1f fps\n", m_elapsedTime > 0 ? totalFrames / m_elapsedTime : 0.0);
+    printf("==============================================\n");
+}
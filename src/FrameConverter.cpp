@@ -0,0 +1,197 @@
+
+/**
+ * Description: FrameConverter Class
+ *                  convert frames between pixel formats and sizes
+ */
+
+#include "FrameConverter.h"
+
+extern "C" {
+    #include <libavutil/time.h>
+}
+
+// max no of scale contexts kept in cache
+#define MAX_CACHED_CONTEXTS 8
+
+using namespace std;
+
+/**
+ * @brief: Default constructor for FrameConverter
+ *          Initializes all the member data
+ */
+FrameConverter::FrameConverter()
+{
+    // function call to initialize member data
+    initLocals();
+}
+
+/**
+ * @brief: destructor, release all cached scale contexts
+ */
+FrameConverter::~FrameConverter()
+{
+    // function call to release scale contexts
+    clear();
+}
+
+/**
+ * @brief: function to initialize member data
+ */
+void FrameConverter::initLocals()
+{
+    // last used scale context
+    m_lastSwsContext = NULL;
+
+    // last used key
+    memset(&m_lastKey, 0, sizeof(m_lastKey));
+
+    // conversion timings
+    m_lastConvertTime = 0;
+    m_totalConvertTime = 0;
+
+    // no of converted frames
+    m_convertCount = 0;
+}
+
+/**
+ * @brief: function to release all cached scale contexts
+ */
+void FrameConverter::clear()
+{
+    // loop for all cached contexts and free
+    map<FrameConverterKey, struct SwsContext*>::iterator it;
+    for (it = m_swsContexts.begin(); it != m_swsContexts.end(); it++)
+        sws_freeContext(it->second);
+
+    // clear cache
+    m_swsContexts.clear();
+
+    // reset last used context
+    m_lastSwsContext = NULL;
+}
+
+/**
+ * @brief: function to fetch scale context, creates one if not cached
+ *
+ * @params: key of the required context
+ *
+ * @return: scale context on success, NULL on failure
+ */
+struct SwsContext* FrameConverter::getContext(const FrameConverterKey &key)
+{
+    // same geometry as last frame, reuse context
+    if (m_lastSwsContext && m_lastKey == key)
+        return m_lastSwsContext;
+
+    // look up cached contexts
+    map<FrameConverterKey, struct SwsContext*>::iterator it = m_swsContexts.find(key);
+
+    // geometry changed to a new one, create context
+    if (it == m_swsContexts.end())
+    {
+        // keep cache bounded
+        if (m_swsContexts.size() >= MAX_CACHED_CONTEXTS)
+            clear();
+
+        // initialize swsScale struct for conversion
+        struct SwsContext *swsContext = sws_getContext(key.srcWidth, key.srcHeight,
+                            (::PixelFormat)key.srcFormat, key.dstWidth, key.dstHeight,
+                            (::PixelFormat)key.dstFormat, key.flags, NULL, NULL, NULL);
+
+        // check if initialization was success
+        if (!swsContext)
+        {
+            fprintf(stderr, "\x1b[31m" "FrameConverter:: Could not get scale context\n" "\x1b[0m");
+            return NULL; // return failure
+        }
+
+        it = m_swsContexts.insert(make_pair(key, swsContext)).first;
+    }
+
+    // remember last used context
+    m_lastKey = key;
+    m_lastSwsContext = it->second;
+
+    return m_lastSwsContext;
+}
+
+/**
+ * @brief: function to convert one frame
+ *
+ * @params: source planes, linesizes, width, height and pixel format,
+ *          destination planes, linesizes, width, height and pixel format,
+ *          scaling filter flags, default = SWS_BICUBIC
+ *
+ * @return: returns -1 on failure, height of output slice on success
+ */
+int FrameConverter::convert(const uint8_t *const srcData[], const int srcLinesize[],
+                            int srcWidth, int srcHeight, PixelFormat srcFormat,
+                            uint8_t *const dstData[], const int dstLinesize[],
+                            int dstWidth, int dstHeight, PixelFormat dstFormat,
+                            int flags)
+{
+    // fill key for the required conversion
+    FrameConverterKey key;
+    key.srcWidth = srcWidth;
+    key.srcHeight = srcHeight;
+    key.srcFormat = srcFormat;
+    key.dstWidth = dstWidth;
+    key.dstHeight = dstHeight;
+    key.dstFormat = dstFormat;
+    key.flags = flags;
+
+    // fetch cached scale context
+    struct SwsContext *swsContext = getContext(key);
+
+    // check if context was found
+    if (!swsContext)
+        return -1; // return failure
+
+    // conversion start time
+    int64_t startTime = av_gettime_relative();
+
+    // convert source to destination format
+    int retStatus = sws_scale(swsContext, srcData, srcLinesize, 0, srcHeight,
+                              dstData, dstLinesize);
+
+    // update conversion timings
+    m_lastConvertTime = av_gettime_relative() - startTime;
+    m_totalConvertTime += m_lastConvertTime;
+    m_convertCount++;
+
+    return retStatus;
+}
+
+/**
+ * @brief: function to fetch time taken by last conversion
+ *
+ * @return: time in micro seconds
+ */
+int64_t FrameConverter::getLastConvertTime()
+{
+    return m_lastConvertTime;
+}
+
+/**
+ * @brief: function to fetch average conversion time per frame
+ *
+ * @return: time in micro seconds, 0 if no frame was converted
+ */
+double FrameConverter::getAvgConvertTime()
+{
+    // check if any frame was converted
+    if (m_convertCount == 0)
+        return 0.0;
+
+    return (double)m_totalConvertTime / m_convertCount;
+}
+
+/**
+ * @brief: function to fetch no of converted frames
+ *
+ * @return: no of frames
+ */
+int FrameConverter::getConvertCount()
+{
+    return m_convertCount;
+}
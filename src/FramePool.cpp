@@ -0,0 +1,410 @@
+
+/**
+ * Description: FramePool Class
+ *                  pool of aligned, reference counted frames
+ */
+
+#include "FramePool.h"
+
+extern "C" {
+    #include <libavutil/imgutils.h>
+}
+
+// alignment of frame buffer start address
+#define FRAME_BUFFER_ALIGN 64
+
+// extra bytes at end of frame buffer, for simd over-reads
+#define FRAME_BUFFER_PADDING 64
+
+using namespace std;
+
+/**
+ * @brief: Default constructor for FramePool
+ *          Initializes all the member data
+ */
+FramePool::FramePool()
+{
+    // function call to initialize member data
+    initLocals();
+}
+
+/**
+ * @brief: Parameterized constructor for FramePool
+ *
+ * @params: pixel format, width, height, max frames (0 = no limit),
+ *          line size alignment
+ */
+FramePool::FramePool(PixelFormat pixFmt, int width, int height, int maxFrames, int align)
+{
+    // function call to initialize member data
+    initLocals();
+
+    // initialize pool geometry
+    init(pixFmt, width, height, maxFrames, align);
+}
+
+/**
+ * @brief: destructor, free all pooled frames
+ */
+FramePool::~FramePool()
+{
+    // lock entries
+    lock_guard<mutex> lock(m_state->mutex);
+
+    // function call to free entries
+    freeEntries();
+}
+
+/**
+ * @brief: function to initialize member data
+ */
+void FramePool::initLocals()
+{
+    // lock shared with entries
+    m_state = make_shared<FramePoolState>();
+
+    // pooled frame geometry
+    m_pixFmt = PIX_FMT_NONE;
+    m_width = -1;
+    m_height = -1;
+    m_align = FRAME_BUFFER_ALIGN;
+
+    // pooled frame line sizes
+    memset(m_linesize, 0, sizeof(m_linesize));
+
+    // pooled frame buffer size
+    m_bufferSize = 0;
+
+    // no limit on frames
+    m_maxFrames = 0;
+
+    // frames with buffer
+    m_shells = false;
+}
+
+/**
+ * @brief: function to initialize pool for given frame geometry,
+ *          frames of previous geometry are released
+ *
+ * @params: pixel format, width, height, max frames (0 = no limit),
+ *          line size alignment
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int FramePool::init(PixelFormat pixFmt, int width, int height, int maxFrames, int align)
+{
+    // lock entries
+    lock_guard<mutex> lock(m_state->mutex);
+
+    // release frames of previous geometry
+    freeEntries();
+
+    // check for valid geometry
+    if (pixFmt == PIX_FMT_NONE || width <= 0 || height <= 0 || align <= 0)
+    {
+        fprintf(stderr, "\x1b[31m" "FramePool:: Invalid frame geometry\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    // fill line sizes for the pixel format
+    if (av_image_fill_linesizes(m_linesize, pixFmt, width) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "FramePool:: Could not get line sizes\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    // align every line size
+    for (int i = 0; i < 4; i++)
+        m_linesize[i] = FFALIGN(m_linesize[i], align);
+
+    // fetch buffer size for aligned line sizes
+    uint8_t *data[4];
+    m_bufferSize = av_image_fill_pointers(data, pixFmt, height, NULL, m_linesize);
+
+    // check for valid buffer size
+    if (m_bufferSize <= 0)
+    {
+        fprintf(stderr, "\x1b[31m" "FramePool:: Could not get buffer size\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    // set pool geometry
+    m_pixFmt = pixFmt;
+    m_width = width;
+    m_height = height;
+    m_align = align;
+    m_maxFrames = maxFrames;
+    m_shells = false;
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to initialize pool of shell frames. shell frames have
+ *          no buffer, they hold references (av_frame_ref) of frames owned
+ *          elsewhere and are unreferenced when recycled
+ *
+ * @params: max frames (0 = no limit)
+ *
+ * @return: returns 0 on success
+ */
+int FramePool::initShells(int maxFrames)
+{
+    // lock entries
+    lock_guard<mutex> lock(m_state->mutex);
+
+    // release frames of previous geometry
+    freeEntries();
+
+    // no geometry for shell frames
+    m_pixFmt = PIX_FMT_NONE;
+    m_width = -1;
+    m_height = -1;
+    memset(m_linesize, 0, sizeof(m_linesize));
+    m_bufferSize = 0;
+    m_maxFrames = maxFrames;
+    m_shells = true;
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to check if pool matches given geometry
+ *
+ * @params: pixel format, width, height
+ *
+ * @return: true if geometry matches
+ */
+bool FramePool::matches(PixelFormat pixFmt, int width, int height)
+{
+    return m_pixFmt == pixFmt && m_width == width && m_height == height;
+}
+
+/**
+ * @brief: function to allocate a new pool entry, called with lock held
+ *
+ * @return: entry on success, NULL on failure
+ */
+FramePoolEntry* FramePool::allocEntry()
+{
+    // allocate aligned buffer, shell frames have none
+    void *buffer = NULL;
+    if (!m_shells && posix_memalign(&buffer, FRAME_BUFFER_ALIGN, 
+                                    m_bufferSize + FRAME_BUFFER_PADDING) != 0)
+    {
+        fprintf(stderr, "\x1b[31m" "FramePool:: Could not alloc frame buffer\n" "\x1b[0m");
+        return NULL; // return failure
+    }
+
+    // allocate frame
+    AVFrame *avFrame = av_frame_alloc();
+
+    // check if allocation was success
+    if (!avFrame)
+    {
+        free(buffer);
+        fprintf(stderr, "\x1b[31m" "FramePool:: Could not alloc frame\n" "\x1b[0m");
+        return NULL; // return failure
+    }
+
+    // point frame planes into the buffer
+    if (buffer)
+    {
+        av_image_fill_pointers(avFrame->data, m_pixFmt, m_height, (uint8_t *)buffer, m_linesize);
+        for (int i = 0; i < 4; i++)
+            avFrame->linesize[i] = m_linesize[i];
+
+        // set frame geometry
+        avFrame->format = m_pixFmt;
+        avFrame->width = m_width;
+        avFrame->height = m_height;
+    }
+
+    // create entry
+    FramePoolEntry *entry = new FramePoolEntry;
+    entry->frame = avFrame;
+    entry->buffer = (uint8_t *)buffer;
+    entry->refCount = 0;
+    entry->pool = this;
+    entry->state = m_state;
+
+    // frame keeps pointer to its entry
+    avFrame->opaque = entry;
+
+    // add entry to pool, reserve free list so recycling never allocates
+    m_entries.push_back(entry);
+    m_freeEntries.reserve(m_entries.size());
+
+    return entry;
+}
+
+/**
+ * @brief: function to free all entries, called with lock held.
+ *          entries still in use are detached and freed on last release
+ */
+void FramePool::freeEntries()
+{
+    // loop for all entries
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        FramePoolEntry *entry = m_entries[i];
+
+        // entry in use, detach from pool. state lock is already held
+        if (entry->refCount > 0)
+        {
+            entry->pool = NULL;
+            continue;
+        }
+
+        // free frame, buffer and entry
+        av_frame_free(&entry->frame);
+        free(entry->buffer);
+        delete entry;
+    }
+
+    // clear lists
+    m_entries.clear();
+    m_freeEntries.clear();
+}
+
+/**
+ * @brief: function to fetch a free frame from pool
+ *
+ * @return: frame with reference count 1 on success, NULL on failure
+ *          or when max frames are in use
+ */
+AVFrame* FramePool::getFrame()
+{
+    // lock entries
+    lock_guard<mutex> lock(m_state->mutex);
+
+    // check if pool was initialized
+    if (m_bufferSize <= 0 && !m_shells)
+        return NULL; // return failure
+
+    FramePoolEntry *entry = NULL;
+
+    // reuse a free entry if any
+    if (!m_freeEntries.empty())
+    {
+        entry = m_freeEntries.back();
+        m_freeEntries.pop_back();
+    }
+    else
+    {
+        // check for max frames limit
+        if (m_maxFrames > 0 && (int)m_entries.size() >= m_maxFrames)
+            return NULL; // pool exhausted
+
+        // allocate new entry
+        entry = allocEntry();
+        if (!entry)
+            return NULL; // return failure
+    }
+
+    // first reference
+    entry->refCount = 1;
+
+    // reset frame properties of previous use
+    AVFrame *avFrame = entry->frame;
+    avFrame->pts = AV_NOPTS_VALUE;
+    avFrame->pkt_dts = AV_NOPTS_VALUE;
+    avFrame->key_frame = 0;
+    avFrame->pict_type = AV_PICTURE_TYPE_NONE;
+
+    return avFrame;
+}
+
+/**
+ * @brief: function to put entry back in free list, called with lock held
+ *
+ * @params: entry to recycle
+ */
+void FramePool::recycleEntry(FramePoolEntry *entry)
+{
+    // drop references held by shell frame, keep link to entry
+    if (!entry->buffer)
+    {
+        av_frame_unref(entry->frame);
+        entry->frame->opaque = entry;
+    }
+
+    m_freeEntries.push_back(entry);
+}
+
+/**
+ * @brief: function to add a reference to pooled frame
+ *
+ * @params: frame fetched from a pool
+ */
+void FramePool::refFrame(AVFrame *avFrame)
+{
+    // check for valid pooled frame
+    if (!avFrame || !avFrame->opaque)
+        return;
+
+    FramePoolEntry *entry = (FramePoolEntry *)avFrame->opaque;
+
+    // lock is shared with pool, valid even if pool is gone
+    lock_guard<mutex> lock(entry->state->mutex);
+    entry->refCount++;
+}
+
+/**
+ * @brief: function to release a reference to pooled frame,
+ *          frame is recycled when last reference is released
+ *
+ * @params: frame fetched from a pool
+ */
+void FramePool::releaseFrame(AVFrame *avFrame)
+{
+    // check for valid pooled frame
+    if (!avFrame || !avFrame->opaque)
+        return;
+
+    FramePoolEntry *entry = (FramePoolEntry *)avFrame->opaque;
+
+    // lock is shared with pool, owner is read under it as pool may be
+    // detaching its entries right now
+    {
+        lock_guard<mutex> lock(entry->state->mutex);
+
+        if (--entry->refCount > 0)
+            return;
+
+        // recycle on last release
+        if (entry->pool)
+        {
+            entry->pool->recycleEntry(entry);
+            return;
+        }
+    }
+
+    // entry detached from pool, free on last release. lock is released
+    // first, entry may hold last reference of it
+    av_frame_free(&entry->frame);
+    free(entry->buffer);
+    delete entry;
+}
+
+/**
+ * @brief: function to fetch total no of frames allocated by pool
+ *
+ * @return: no of frames
+ */
+int FramePool::getFrameCount()
+{
+    lock_guard<mutex> lock(m_state->mutex);
+    return (int)m_entries.size();
+}
+
+/**
+ * @brief: function to fetch no of frames in use
+ *
+ * @return: no of frames
+ */
+int FramePool::getUsedCount()
+{
+    lock_guard<mutex> lock(m_state->mutex);
+    return (int)(m_entries.size() - m_freeEntries.size());
+}
@@ -0,0 +1,162 @@
+
+/**
+ * Description: FrameRateFilter Class
+ *                  select decoded frames for a constant output frame rate
+ */
+
+#include "FrameRateFilter.h"
+
+extern "C" {
+    #include <libavutil/mathematics.h>
+}
+
+using namespace std;
+
+/**
+ * @brief: Default constructor for FrameRateFilter
+ *          every frame passes until filter is set up
+ */
+FrameRateFilter::FrameRateFilter()
+{
+    AVRational timeBase = {1, 1};
+    reset(timeBase, 0);
+}
+
+/**
+ * @brief: function to set input time base and output frame rate
+ *
+ * @params: time base of input timestamps, output frame rate (0 = every frame
+ *          passes), timestamp of first output frame (default = first frame)
+ */
+void FrameRateFilter::reset(AVRational timeBase, int frameRate, int64_t startTs)
+{
+    m_timeBase = timeBase;
+    m_frameRate = frameRate > 0 ? frameRate : 0;
+    m_startTs = startTs;
+    m_nextFrame = 0;
+
+    m_inputFrames = 0;
+    m_droppedFrames = 0;
+    m_repeatedFrames = 0;
+}
+
+/**
+ * @brief: function to set up filter for an opened video. frames pass as
+ *          they are if output frame rate is input frame rate. if output
+ *          frame rate is half of input or less, decoder skips non reference
+ *          frames, they would mostly be dropped anyway
+ *
+ * @params: opened video decoder, output frame rate,
+ *          timestamp of first output frame (default = first frame)
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int FrameRateFilter::init(VideoDecoder &videoDecoder, int frameRate, int64_t startTs)
+{
+    AVStream *avStream = videoDecoder.getVideoStream();
+    if (!avStream)
+        return -1; // return failure
+
+    VideoInfo videoInfo;
+    videoDecoder.getVideoInfo(videoInfo);
+
+    // same frame rate, every frame passes
+    if (frameRate <= 0 || frameRate == videoInfo.frameRate)
+        frameRate = 0;
+
+    reset(avStream->time_base, frameRate, startTs);
+
+    // skip decoding of frames nothing refers to
+    bool skipNonRef = frameRate > 0 && videoInfo.frameRate >= 2 * frameRate;
+    videoDecoder.setSkipNonRefFrames(skipNonRef);
+
+    if (frameRate > 0)
+        fprintf(stderr, "\x1b[32m" "FrameRateFilter:: %d -> %d fps%s\n" "\x1b[0m",
+                    videoInfo.frameRate, frameRate, skipNonRef ? ", skipping non-ref frames" : "");
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to find no of output frames for an input frame. input
+ *          frame is placed at the nearest output frame, it is dropped if
+ *          that output frame was already filled, repeated if output frames
+ *          before it are missing
+ *
+ * @params: timestamp of input frame, in input time base
+ *
+ * @return: no of output frames, 0 = drop frame
+ */
+int FrameRateFilter::filterFrame(int64_t ts)
+{
+    m_inputFrames++;
+
+    // every frame passes
+    if (m_frameRate <= 0)
+        return 1;
+
+    // no timestamp, frame takes next output frame
+    if (ts == AV_NOPTS_VALUE)
+    {
+        m_nextFrame++;
+        return 1;
+    }
+
+    // first frame starts output
+    if (m_startTs == AV_NOPTS_VALUE)
+        m_startTs = ts;
+
+    // nearest output frame
+    AVRational frameTimeBase = {1, m_frameRate};
+    int64_t frame = av_rescale_q_rnd(ts - m_startTs, m_timeBase, frameTimeBase, AV_ROUND_NEAR_INF);
+
+    // output frame already filled
+    if (frame < m_nextFrame)
+    {
+        m_droppedFrames++;
+        return 0;
+    }
+
+    // gap of more than a second is a timestamp jump, restart output timeline
+    if (frame - m_nextFrame >= m_frameRate)
+    {
+        m_startTs = ts - av_rescale_q(m_nextFrame, frameTimeBase, m_timeBase);
+        frame = m_nextFrame;
+    }
+
+    int copies = (int)(frame - m_nextFrame + 1);
+    m_repeatedFrames += copies - 1;
+    m_nextFrame = frame + 1;
+
+    return copies;
+}
+
+/**
+ * @brief: function to check if frames are filtered at all
+ *
+ * @return: true if output frame rate differs from input
+ */
+bool FrameRateFilter::isActive()
+{
+    return m_frameRate > 0;
+}
+
+/**
+ * @brief: function to fetch no of dropped frames
+ *
+ * @return: no of dropped frames
+ */
+int FrameRateFilter::getDroppedFrames()
+{
+    return m_droppedFrames;
+}
+
+/**
+ * @brief: function to fetch no of repeated frames
+ *
+ * @return: no of repeated frames
+ */
+int FrameRateFilter::getRepeatedFrames()
+{
+    return m_repeatedFrames;
+}
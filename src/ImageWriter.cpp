@@ -0,0 +1,207 @@
+
+/**
+ * Description: ImageWriter Class
+ *                  write frames as png or jpeg images
+ */
+
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+/**
+ * @brief: Parameterized constructor for ImageWriter
+ *
+ * @params: jpeg quality scale (2..31, lower is better), default = 2
+ */
+ImageWriter::ImageWriter(int quality)
+{
+    // codec is opened on first image
+    m_avCodecCtx = NULL;
+
+    // jpeg quality
+    m_quality = quality > 0 ? quality : 2;
+}
+
+/**
+ * @brief: destructor, close image codec
+ */
+ImageWriter::~ImageWriter()
+{
+    // function call to close codec
+    closeCodec();
+}
+
+/**
+ * @brief: function to open codec for image format and size, codec is kept
+ *          open while format and size are the same
+ *
+ * @params: image codec id, image width and height
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int ImageWriter::openCodec(int codecId, int width, int height)
+{
+    // codec already open for same format and size
+    if (m_avCodecCtx && m_avCodecCtx->codec_id == codecId &&
+            m_avCodecCtx->width == width && m_avCodecCtx->height == height)
+        return 0;
+
+    closeCodec();
+
+    // find image encoder
+    AVCodec *avCodec = avcodec_find_encoder((AVCodecID)codecId);
+    if (!avCodec)
+    {
+        fprintf(stderr, "\x1b[31m" "ImageWriter:: Image codec not found\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    m_avCodecCtx = avcodec_alloc_context3(avCodec);
+    if (!m_avCodecCtx)
+        return -1; // return failure
+
+    // image size and format, png keeps rgb, jpeg needs full range yuv
+    m_avCodecCtx->width = width;
+    m_avCodecCtx->height = height;
+    m_avCodecCtx->time_base.num = 1;
+    m_avCodecCtx->time_base.den = 25;
+    m_avCodecCtx->pix_fmt = codecId == CODEC_ID_PNG ? PIX_FMT_RGB24 : PIX_FMT_YUVJ420P;
+
+    // jpeg quality
+    if (codecId == CODEC_ID_MJPEG)
+    {
+        m_avCodecCtx->flags |= CODEC_FLAG_QSCALE;
+        m_avCodecCtx->global_quality = FF_QP2LAMBDA * m_quality;
+    }
+
+    // open image codec
+    if (avcodec_open2(m_avCodecCtx, avCodec, NULL) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "ImageWriter:: Could not open image codec\n" "\x1b[0m");
+        avcodec_free_context(&m_avCodecCtx);
+        return -1; // return failure
+    }
+
+    // frame in codec format
+    if (m_framePool.init((::PixelFormat)m_avCodecCtx->pix_fmt, width, height, 1) < 0)
+    {
+        closeCodec();
+        return -1; // return failure
+    }
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to close image codec
+ */
+void ImageWriter::closeCodec()
+{
+    if (m_avCodecCtx)
+    {
+        avcodec_close(m_avCodecCtx);
+        avcodec_free_context(&m_avCodecCtx);
+        m_avCodecCtx = NULL;
+    }
+}
+
+/**
+ * @brief: function to write planes as an image file, format is chosen from
+ *          file extension (.png, .jpg, .jpeg). planes are scaled and
+ *          converted to image format in one step
+ *
+ * @params: image filename, source planes, linesizes, width, height and
+ *          pixel format, image width and height (<= 0 = source size)
+ *
+ * @return: returns -1 on failure, image file size on success
+ */
+int ImageWriter::writeImage(const string &imageFile, const uint8_t *const srcData[],
+                            const int srcLinesize[], int srcWidth, int srcHeight,
+                            PixelFormat srcFormat, int width, int height)
+{
+    // image size, source size if not given
+    if (width <= 0 || height <= 0)
+    {
+        width = srcWidth;
+        height = srcHeight;
+    }
+
+    // image format from extension
+    string extension = "";
+    size_t pos = imageFile.find_last_of('.');
+    if (pos != string::npos)
+        extension = imageFile.substr(pos + 1);
+
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    int codecId = CODEC_ID_NONE;
+    if (extension == "png")
+        codecId = CODEC_ID_PNG;
+    else if (extension == "jpg" || extension == "jpeg")
+        codecId = CODEC_ID_MJPEG;
+    else
+    {
+        fprintf(stderr, "\x1b[31m" "ImageWriter:: Image format not supported(png/jpg): %s\n" "\x1b[0m",
+                                                                            imageFile.c_str());
+        return -1; // return failure
+    }
+
+    if (openCodec(codecId, width, height) < 0)
+        return -1; // return failure
+
+    // frame in codec format
+    AVFrame *avFrame = m_framePool.getFrame();
+    if (!avFrame)
+        return -1; // return failure
+
+    // scale and convert to codec format
+    if (m_frameConverter.convert(srcData, srcLinesize, srcWidth, srcHeight, srcFormat,
+                avFrame->data, avFrame->linesize, width, height,
+                (::PixelFormat)m_avCodecCtx->pix_fmt) < 0)
+    {
+        FramePool::releaseFrame(avFrame);
+        return -1; // return failure
+    }
+
+    avFrame->pts = 0;
+    avFrame->quality = m_avCodecCtx->global_quality;
+
+    // empty packet, data is allocated by encoder
+    AVPacket avPkt;
+    av_init_packet(&avPkt);
+    avPkt.data = NULL;
+    avPkt.size = 0;
+
+    int gotPacket = 0;
+    int retStatus = avcodec_encode_video2(m_avCodecCtx, &avPkt, avFrame, &gotPacket);
+
+    FramePool::releaseFrame(avFrame);
+
+    if (retStatus < 0 || !gotPacket)
+    {
+        fprintf(stderr, "\x1b[31m" "ImageWriter:: Could not encode image\n" "\x1b[0m");
+        av_free_packet(&avPkt);
+        return -1; // return failure
+    }
+
+    // write image file
+    FILE *imageFp = fopen(imageFile.c_str(), "wb");
+    if (!imageFp)
+    {
+        fprintf(stderr, "\x1b[31m" "ImageWriter:: Could not open file: %s\n" "\x1b[0m",
+                                                                    imageFile.c_str());
+        av_free_packet(&avPkt);
+        return -1; // return failure
+    }
+
+    size_t written = fwrite(avPkt.data, 1, avPkt.size, imageFp);
+    fclose(imageFp);
+
+    int size = avPkt.size;
+    av_free_packet(&avPkt);
+
+    return written == (size_t)size ? size : -1;
+}
@@ -0,0 +1,419 @@
+
+/**
+ * Description: KeyFrameIndex Class
+ *                  build and map keyframe index files of videos
+ */
+
+#include "KeyFrameIndex.h"
+#include "Transcoder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+    #include <libavutil/time.h>
+}
+
+// identifier and layout version of index file
+#define KEY_FRAME_INDEX_MAGIC "VKFI"
+#define KEY_FRAME_INDEX_VERSION 1
+
+using namespace std;
+
+/**
+ * @brief: function to sort keyframes by timestamp
+ */
+static bool compareKeyFrames(const KeyFrameInfo &first, const KeyFrameInfo &second)
+{
+    return first.pts < second.pts;
+}
+
+/**
+ * @brief: Default constructor for KeyFrameIndex
+ *          no index is loaded
+ */
+KeyFrameIndex::KeyFrameIndex()
+{
+    m_mapData = NULL;
+    m_mapSize = 0;
+    m_header = NULL;
+    m_entries = NULL;
+}
+
+/**
+ * @brief: destructor, unmap index file
+ */
+KeyFrameIndex::~KeyFrameIndex()
+{
+    // function call to unmap index
+    unload();
+}
+
+/**
+ * @brief: function to make index filename of a video, index is kept next
+ *          to the video
+ *
+ * @params: video filename
+ *
+ * @return: index filename
+ */
+string KeyFrameIndex::getIndexFile(const string &videoFile)
+{
+    return videoFile + ".kfi";
+}
+
+/**
+ * @brief: function to fetch size and modification time of video
+ *
+ * @params: video filename, size and modification time to fill
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int KeyFrameIndex::getVideoStat(const string &videoFile, int64_t &size, int64_t &mtime)
+{
+    struct stat videoStat;
+    if (stat(videoFile.c_str(), &videoStat) != 0)
+        return -1; // return failure
+
+    size = (int64_t)videoStat.st_size;
+    mtime = (int64_t)videoStat.st_mtime;
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to build index file of a video. packets are read once
+ *          without decoding, keyframes are written sorted by timestamp.
+ *          index is written to a temporary file and renamed, so readers
+ *          never see a partial index
+ *
+ * @params: video filename
+ *
+ * @return: returns -1 on failure, no of keyframes on success
+ */
+int KeyFrameIndex::build(const string &videoFile)
+{
+    int64_t videoSize = 0, videoMtime = 0;
+    if (getVideoStat(videoFile, videoSize, videoMtime) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "KeyFrameIndex:: Could not find video: %s\n" "\x1b[0m",
+                                                                    videoFile.c_str());
+        return -1; // return failure
+    }
+
+    // open video, packets are read from container, old index is not used
+    VideoDecoderContext decoderContext;
+    decoderContext.threadCount = 1;
+    decoderContext.keyFrameIndex = 0;
+
+    VideoDecoder videoDecoder;
+    videoDecoder.setDecoderContext(decoderContext);
+
+    if (videoDecoder.openVideo(videoFile) < 0)
+        return -1; // return failure
+
+    // find keyframes, no decoding
+    vector<KeyFrameInfo> keyFrames;
+    if (videoDecoder.probeKeyFrames(keyFrames) < 0)
+    {
+        videoDecoder.closeVideo();
+        return -1; // return failure
+    }
+
+    AVStream *avStream = videoDecoder.getVideoStream();
+
+    VideoInfo videoInfo;
+    videoDecoder.getVideoInfo(videoInfo);
+
+    // fill header
+    KeyFrameIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, KEY_FRAME_INDEX_MAGIC, sizeof(header.magic));
+    header.version = KEY_FRAME_INDEX_VERSION;
+    header.streamIndex = avStream->index;
+    header.timeBaseNum = avStream->time_base.num;
+    header.timeBaseDen = avStream->time_base.den;
+    header.videoSize = videoSize;
+    header.videoMtime = videoMtime;
+    header.totalFrames = videoInfo.totalFrame;
+
+    videoDecoder.closeVideo();
+
+    // drop keyframes without timestamp, sort by timestamp
+    vector<KeyFrameIndexEntry> entries;
+    sort(keyFrames.begin(), keyFrames.end(), compareKeyFrames);
+
+    for (size_t i = 0; i < keyFrames.size(); i++)
+    {
+        if (keyFrames[i].pts == AV_NOPTS_VALUE)
+            continue;
+
+        KeyFrameIndexEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.pts = keyFrames[i].pts;
+        entry.pos = keyFrames[i].pos;
+        entry.frameNumber = keyFrames[i].frameNumber;
+        entries.push_back(entry);
+    }
+
+    header.count = (uint32_t)entries.size();
+
+    // write temporary index file
+    string indexFile = getIndexFile(videoFile);
+    string tempFile = indexFile + ".tmp";
+
+    FILE *indexFp = fopen(tempFile.c_str(), "wb");
+    if (!indexFp)
+    {
+        fprintf(stderr, "\x1b[31m" "KeyFrameIndex:: Could not open file: %s\n" "\x1b[0m",
+                                                                    tempFile.c_str());
+        return -1; // return failure
+    }
+
+    bool written = fwrite(&header, sizeof(header), 1, indexFp) == 1 &&
+                   (entries.empty() || fwrite(&entries[0], sizeof(KeyFrameIndexEntry),
+                                              entries.size(), indexFp) == entries.size());
+
+    if (fclose(indexFp) != 0)
+        written = false;
+
+    // replace index file
+    if (!written || rename(tempFile.c_str(), indexFile.c_str()) != 0)
+    {
+        fprintf(stderr, "\x1b[31m" "KeyFrameIndex:: Could not write file: %s\n" "\x1b[0m",
+                                                                    indexFile.c_str());
+        unlink(tempFile.c_str());
+        return -1; // return failure
+    }
+
+    return (int)entries.size();
+}
+
+/**
+ * @brief: worker thread, builds indexes until no video is left
+ *
+ * @params: videos to index, index of next video, no of failed videos
+ */
+void KeyFrameIndex::buildWorker(const vector<string> *videoFiles, atomic<int> *nextFile,
+                                atomic<int> *failedFiles)
+{
+    // loop for all remaining videos
+    for (int file = (*nextFile)++; file < (int)videoFiles->size(); file = (*nextFile)++)
+    {
+        int keyFrames = build((*videoFiles)[file]);
+
+        if (keyFrames < 0)
+            (*failedFiles)++;
+
+        fprintf(stderr, "\x1b[32m" "KeyFrameIndex:: Index %d %s (%d keyframes): %s\n" "\x1b[0m",
+                        file, keyFrames < 0 ? "failed" : "done", FFMAX(keyFrames, 0),
+                        (*videoFiles)[file].c_str());
+    }
+}
+
+/**
+ * @brief: function to build index files of many videos, one video per
+ *          worker at a time. reading packets is mostly i/o, so workers
+ *          can be more than cpu cores
+ *
+ * @params: videos to index, no of concurrent workers, default = 1
+ *
+ * @return: returns no of failed videos
+ */
+int KeyFrameIndex::buildAll(const vector<string> &videoFiles, int workers)
+{
+    // make ffmpeg safe to use from workers
+    if (Transcoder::initThreading() < 0)
+        return (int)videoFiles.size(); // all failed
+
+    // run start time
+    int64_t startTime = av_gettime_relative();
+
+    atomic<int> nextFile(0);
+    atomic<int> failedFiles(0);
+
+    // start workers, no more than videos
+    vector<thread> threads;
+    int noOfWorkers = FFMIN(FFMAX(workers, 1), (int)videoFiles.size());
+    for (int i = 0; i < noOfWorkers; i++)
+        threads.push_back(thread(&KeyFrameIndex::buildWorker, &videoFiles, &nextFile, &failedFiles));
+
+    // wait for all workers
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    fprintf(stderr, "\x1b[32m" "KeyFrameIndex:: %d of %d videos indexed in %.2f sec\n" "\x1b[0m",
+                    (int)videoFiles.size() - (int)failedFiles, (int)videoFiles.size(),
+                    (av_gettime_relative() - startTime) / 1000000.0);
+
+    return failedFiles;
+}
+
+/**
+ * @brief: function to map index file of a video. index is not loaded if
+ *          it is missing, damaged, stale or was built for another stream
+ *
+ * @params: video filename, index and time base of its video stream
+ *
+ * @return: returns -1 if no index is loaded, no of keyframes on success
+ */
+int KeyFrameIndex::load(const string &videoFile, int streamIndex, int timeBaseNum,
+                        int timeBaseDen)
+{
+    unload();
+
+    int64_t videoSize = 0, videoMtime = 0;
+    if (getVideoStat(videoFile, videoSize, videoMtime) < 0)
+        return -1; // return failure
+
+    // open index file, missing index is not an error
+    string indexFile = getIndexFile(videoFile);
+    int indexFd = open(indexFile.c_str(), O_RDONLY);
+    if (indexFd < 0)
+        return -1; // return failure
+
+    struct stat indexStat;
+    if (fstat(indexFd, &indexStat) != 0 || indexStat.st_size < (off_t)sizeof(KeyFrameIndexHeader))
+    {
+        close(indexFd);
+        return -1; // return failure
+    }
+
+    // map whole index, mapping stays valid once file is closed
+    m_mapSize = (size_t)indexStat.st_size;
+    m_mapData = mmap(NULL, m_mapSize, PROT_READ, MAP_SHARED, indexFd, 0);
+    close(indexFd);
+
+    if (m_mapData == MAP_FAILED)
+    {
+        m_mapData = NULL;
+        m_mapSize = 0;
+        return -1; // return failure
+    }
+
+    const KeyFrameIndexHeader *header = (const KeyFrameIndexHeader *)m_mapData;
+
+    // check layout, entries must fit in file
+    bool valid = memcmp(header->magic, KEY_FRAME_INDEX_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == KEY_FRAME_INDEX_VERSION &&
+                 sizeof(KeyFrameIndexHeader) + (size_t)header->count * sizeof(KeyFrameIndexEntry)
+                                                                            <= m_mapSize;
+
+    // check index belongs to this video and stream
+    if (valid && (header->videoSize != videoSize || header->videoMtime != videoMtime ||
+                  header->streamIndex != streamIndex || header->timeBaseNum != timeBaseNum ||
+                  header->timeBaseDen != timeBaseDen))
+    {
+        fprintf(stderr, "\x1b[33m" "KeyFrameIndex:: Index is stale, not used: %s\n" "\x1b[0m",
+                                                                    indexFile.c_str());
+        valid = false;
+    }
+
+    if (!valid || header->count == 0)
+    {
+        unload();
+        return -1; // return failure
+    }
+
+    m_header = header;
+    m_entries = (const KeyFrameIndexEntry *)(header + 1);
+
+    return (int)m_header->count;
+}
+
+/**
+ * @brief: function to unmap index file
+ */
+void KeyFrameIndex::unload()
+{
+    if (m_mapData)
+        munmap(m_mapData, m_mapSize);
+
+    m_mapData = NULL;
+    m_mapSize = 0;
+    m_header = NULL;
+    m_entries = NULL;
+}
+
+/**
+ * @brief: function to check if an index is loaded
+ *
+ * @return: true if loaded, false otherwise
+ */
+bool KeyFrameIndex::isLoaded()
+{
+    return m_header != NULL;
+}
+
+/**
+ * @brief: function to fetch no of video packets in indexed file
+ *
+ * @return: -1 if no index is loaded, no of video packets otherwise
+ */
+int KeyFrameIndex::getTotalFrames()
+{
+    return m_header ? m_header->totalFrames : -1;
+}
+
+/**
+ * @brief: function to find keyframe at or before the given timestamp, first
+ *          keyframe if timestamp is before it
+ *
+ * @params: timestamp in stream time base, keyframe to fill
+ *
+ * @return: returns -1 if no index is loaded, 0 on success
+ */
+int KeyFrameIndex::findKeyFrame(int64_t pts, KeyFrameInfo &keyFrame)
+{
+    if (!m_header)
+        return -1; // return failure
+
+    // binary search for last keyframe not after timestamp
+    uint32_t low = 0, high = m_header->count;
+    while (high - low > 1)
+    {
+        uint32_t mid = low + (high - low) / 2;
+        if (m_entries[mid].pts <= pts)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    keyFrame.pts = m_entries[low].pts;
+    keyFrame.pos = m_entries[low].pos;
+    keyFrame.frameNumber = m_entries[low].frameNumber;
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to fetch all keyframes of index
+ *
+ * @params: vector to fill keyframes, sorted by timestamp
+ *
+ * @return: returns -1 if no index is loaded, no of keyframes on success
+ */
+int KeyFrameIndex::getKeyFrames(vector<KeyFrameInfo> &keyFrames)
+{
+    keyFrames.clear();
+
+    if (!m_header)
+        return -1; // return failure
+
+    keyFrames.resize(m_header->count);
+    for (uint32_t i = 0; i < m_header->count; i++)
+    {
+        keyFrames[i].pts = m_entries[i].pts;
+        keyFrames[i].pos = m_entries[i].pos;
+        keyFrames[i].frameNumber = m_entries[i].frameNumber;
+    }
+
+    return (int)keyFrames.size();
+}
@@ -0,0 +1,397 @@
+
+/**
+ * Description: LadderTranscoder Class
+ *                  transcode one video into many renditions, decoding it
+ *                  once for all of them
+ */
+
+#include "LadderTranscoder.h"
+
+#include <thread>
+#include <unistd.h>
+
+extern "C" {
+    #include <libavutil/time.h>
+}
+
+using namespace std;
+
+/**
+ * @brief: Parameterized constructor for LadderTranscoder
+ *
+ * @params: max no of decoded frames queued for every rendition
+ */
+LadderTranscoder::LadderTranscoder(int queueSize)
+{
+    // at least one queued frame
+    m_queueSize = queueSize > 0 ? queueSize : 1;
+
+    // abort flag
+    m_abort = false;
+
+    m_decodedFrames = 0;
+}
+
+/**
+ * @brief: destructor, free renditions left after failure
+ */
+LadderTranscoder::~LadderTranscoder()
+{
+    freeRenditions();
+}
+
+/**
+ * @brief: function to start encoder of every rendition. size and frame rate
+ *          not given are taken from input, cpu cores are shared among
+ *          encoders where threads are auto
+ *
+ * @params: output options of every rendition
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int LadderTranscoder::startRenditions(const vector<VideoEncoderContext> &renditions)
+{
+    VideoInfo videoInfo;
+    m_videoDecoder.getVideoInfo(videoInfo);
+
+    AVStream *avStream = m_videoDecoder.getVideoStream();
+
+    // share cpu cores among encoders
+    int cores = FFMAX((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+    int threadsPerRendition = FFMAX(cores / (int)renditions.size(), 1);
+
+    // non reference frames are skipped only if no rendition needs them
+    bool skipNonRef = true;
+
+    for (size_t i = 0; i < renditions.size(); i++)
+    {
+        LadderRendition *rendition = new LadderRendition(m_queueSize);
+        m_renditions.push_back(rendition);
+
+        // output size and frame rate, from input if not given
+        VideoEncoderContext &encoderContext = rendition->encoderContext;
+        encoderContext = renditions[i];
+
+        int outWidth = 0, outHeight = 0;
+        VideoEncoder::getOutputSize(encoderContext, videoInfo.width, videoInfo.height,
+                                                            outWidth, outHeight);
+        encoderContext.width = outWidth;
+        encoderContext.height = outHeight;
+
+        if (encoderContext.frameRate <= 0)
+            encoderContext.frameRate = videoInfo.frameRate > 0 ? videoInfo.frameRate : 15;
+
+        if (encoderContext.threadCount <= 0)
+            encoderContext.threadCount = threadsPerRendition;
+
+        // drop or repeat frames for output frame rate, 0 = every frame passes
+        int frameRate = encoderContext.frameRate == videoInfo.frameRate ? 0 : encoderContext.frameRate;
+        rendition->frameRateFilter.reset(avStream->time_base, frameRate);
+
+        skipNonRef = skipNonRef && frameRate > 0 && videoInfo.frameRate >= 2 * frameRate;
+
+        // start encoder of rendition
+        rendition->videoEncoder = new VideoEncoder(encoderContext);
+
+        if (rendition->videoEncoder->startVideoEncode() < 0 ||
+            rendition->videoEncoder->getFrameFormat(rendition->pixFmt, rendition->width,
+                                                    rendition->height) < 0)
+        {
+            fprintf(stderr, "\x1b[31m" "LadderTranscoder:: Could not start rendition: %s\n" "\x1b[0m",
+                                                        encoderContext.outputVideoFile.c_str());
+            return -1; // return failure
+        }
+
+        // one converted frame at a time
+        if (rendition->framePool.init(rendition->pixFmt, rendition->width, rendition->height, 2) < 0)
+            return -1; // return failure
+
+        fprintf(stderr, "\x1b[32m" "LadderTranscoder:: Rendition %d: %dx%d @ %d fps -> %s\n" "\x1b[0m",
+                    (int)i, encoderContext.width, encoderContext.height, encoderContext.frameRate,
+                    encoderContext.outputVideoFile.c_str());
+    }
+
+    m_videoDecoder.setSkipNonRefFrames(skipNonRef);
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to stop encoders left running and free renditions,
+ *          frames left in queues are released
+ */
+void LadderTranscoder::freeRenditions()
+{
+    for (size_t i = 0; i < m_renditions.size(); i++)
+    {
+        LadderRendition *rendition = m_renditions[i];
+
+        // release decoded frames
+        AVFrame *avFrame = NULL;
+        while (rendition->frameQueue.tryPop(avFrame))
+            FramePool::releaseFrame(avFrame);
+
+        // stop encoder
+        if (rendition->videoEncoder)
+        {
+            rendition->videoEncoder->stopVideoEncode();
+            delete rendition->videoEncoder;
+        }
+
+        delete rendition;
+    }
+
+    m_renditions.clear();
+}
+
+/**
+ * @brief: function to fetch a shell frame, waits while all frames are in
+ *          use. this is the backpressure from the slowest rendition
+ *
+ * @return: frame on success, NULL on abort
+ */
+AVFrame* LadderTranscoder::waitForFrame()
+{
+    for (int retries = 0; !m_abort; retries++)
+    {
+        // fetch free frame
+        AVFrame *avFrame = m_shellPool.getFrame();
+        if (avFrame)
+            return avFrame;
+
+        // wait for a frame to be released
+        if (retries < 64)
+            this_thread::yield();
+        else
+            this_thread::sleep_for(chrono::microseconds(100));
+    }
+
+    return NULL; // aborted
+}
+
+/**
+ * @brief: decode stage, decodes frames into shell frames referencing
+ *          decoder planes and queues a reference to every rendition, NULL
+ *          is queued at end of video
+ */
+void LadderTranscoder::decodeStage()
+{
+    while (!m_abort)
+    {
+        // fetch shell frame
+        AVFrame *avFrame = waitForFrame();
+        if (!avFrame)
+            break; // aborted
+
+        // decode next frame, no copy of pixel data
+        if (m_videoDecoder.getNewFrame(avFrame) <= 0)
+        {
+            FramePool::releaseFrame(avFrame);
+            break; // end of video
+        }
+
+        m_decodedFrames++;
+
+        // one reference per rendition, waits while a rendition is behind
+        for (size_t i = 0; i < m_renditions.size(); i++)
+        {
+            LadderRendition *rendition = m_renditions[i];
+
+            FramePool::refFrame(avFrame);
+            if (!rendition->frameQueue.push(avFrame, m_abort))
+            {
+                FramePool::releaseFrame(avFrame);
+                break; // aborted
+            }
+
+            if (StageStats::isEnabled())
+                rendition->stats.decodeQueue.addSample((int64_t)rendition->frameQueue.size());
+        }
+
+        // release reference of decode stage
+        FramePool::releaseFrame(avFrame);
+    }
+
+    // queue end of video
+    for (size_t i = 0; i < m_renditions.size(); i++)
+    {
+        AVFrame *endOfVideo = NULL;
+        m_renditions[i]->frameQueue.push(endOfVideo, m_abort);
+    }
+}
+
+/**
+ * @brief: encode stage of one rendition, converts every decoded frame
+ *          once to rendition format and encodes it
+ *
+ * @params: rendition to encode
+ */
+void LadderTranscoder::encodeStage(LadderRendition *rendition)
+{
+    AVFrame *inpFrame = NULL;
+
+    // loop until end of video
+    while (rendition->frameQueue.pop(inpFrame, m_abort) && inpFrame)
+    {
+        // no of output frames, dropped frames are not converted
+        int copies = rendition->frameRateFilter.filterFrame(
+                                av_frame_get_best_effort_timestamp(inpFrame));
+
+        AVFrame *outFrame = inpFrame;
+
+        // convert only if format differs from encoder format
+        if (copies > 0 && (inpFrame->format != rendition->pixFmt ||
+                inpFrame->width != rendition->width || inpFrame->height != rendition->height))
+        {
+            outFrame = rendition->framePool.getFrame();
+
+            // convert to encoder format, using cached scale context
+            int64_t stageStart = StageStats::start();
+            if (!outFrame || rendition->frameConverter.convert(inpFrame->data, inpFrame->linesize,
+                        inpFrame->width, inpFrame->height, (::PixelFormat)inpFrame->format,
+                        outFrame->data, outFrame->linesize, rendition->width, rendition->height,
+                        rendition->pixFmt) < 0)
+            {
+                fprintf(stderr, "\x1b[31m" "LadderTranscoder:: Could not convert frame\n" "\x1b[0m");
+                FramePool::releaseFrame(inpFrame);
+                FramePool::releaseFrame(outFrame);
+                rendition->frames = -1;
+                m_abort = true;
+                break;
+            }
+
+            rendition->stats.stages[STAGE_CONVERT].stop(stageStart);
+
+            // copy frame properties
+            outFrame->pts = av_frame_get_best_effort_timestamp(inpFrame);
+            outFrame->key_frame = inpFrame->key_frame;
+            outFrame->pict_type = inpFrame->pict_type;
+        }
+
+        // encode frame, repeated for output frame rate
+        int size = 0;
+        for (int copy = 0; copy < copies && size >= 0; copy++)
+            size = rendition->videoEncoder->addNewFrame(outFrame);
+
+        // give frames back to their pools
+        if (outFrame != inpFrame)
+            FramePool::releaseFrame(outFrame);
+
+        FramePool::releaseFrame(inpFrame);
+
+        // check if encoding was succesful, stop all renditions otherwise
+        if (size < 0)
+        {
+            fprintf(stderr, "\x1b[31m" "LadderTranscoder:: Could not encode frame\n" "\x1b[0m");
+            rendition->frames = -1;
+            m_abort = true;
+            break;
+        }
+
+        rendition->frames += copies;
+    }
+}
+
+/**
+ * @brief: function to transcode one input into all renditions. input range,
+ *          decoder options and memory input are taken from job, output
+ *          options and output file from every rendition
+ *
+ * @params: job with input, output options of every rendition, result of
+ *          every rendition to fill. demux and decode stats are shared and
+ *          reported in first result
+ *
+ * @return: returns -1 on failure, no of decoded frames on success
+ */
+int LadderTranscoder::transcode(const TranscodeJob &job, const vector<VideoEncoderContext> &renditions,
+                                vector<TranscodeResult> &results)
+{
+    // job start time
+    int64_t startTime = av_gettime_relative();
+
+    // one result per rendition, failed until done
+    results.assign(renditions.size(), TranscodeResult());
+    for (size_t i = 0; i < renditions.size(); i++)
+    {
+        results[i].inputFile = job.inputFile;
+        results[i].outputFile = renditions[i].outputVideoFile;
+    }
+
+    if (renditions.empty())
+        return -1; // return failure
+
+    // make ffmpeg safe to use from encode stages
+    if (Transcoder::initThreading() < 0)
+        return -1; // return failure
+
+    // open video once for all renditions
+    m_videoDecoder.setDecoderContext(job.decoderContext);
+
+    if (job.inputData)
+        m_videoDecoder.setInputBuffer(job.inputData, job.inputSize);
+    else if (job.inputCallback)
+        m_videoDecoder.setInputCallback(job.inputCallback);
+
+    int frames = -1;
+
+    if (m_videoDecoder.openVideo(job.inputFile) >= 0 &&
+        (job.startTime <= 0 || m_videoDecoder.seek(job.startTime) >= 0) &&
+        startRenditions(renditions) >= 0)
+    {
+        m_videoDecoder.setEndTime(job.endTime);
+
+        // reset run state
+        m_abort = false;
+        m_decodedFrames = 0;
+
+        // every queued frame is one shell shared by all renditions
+        m_shellPool.initShells(m_queueSize + (int)m_renditions.size() + 2);
+
+        fprintf(stderr, "\x1b[32m" "LadderTranscoder:: Decoding once for %d renditions\n" "\x1b[0m",
+                                                                    (int)m_renditions.size());
+
+        // start stages
+        thread decodeThread(&LadderTranscoder::decodeStage, this);
+
+        vector<thread> encodeThreads;
+        for (size_t i = 0; i < m_renditions.size(); i++)
+            encodeThreads.push_back(thread(&LadderTranscoder::encodeStage, this, m_renditions[i]));
+
+        // wait for all stages to finish
+        decodeThread.join();
+        for (size_t i = 0; i < encodeThreads.size(); i++)
+            encodeThreads[i].join();
+
+        frames = m_abort ? -1 : m_decodedFrames;
+    }
+
+    double elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+
+    // stop encoders and fill results
+    for (size_t i = 0; i < m_renditions.size(); i++)
+    {
+        LadderRendition *rendition = m_renditions[i];
+
+        rendition->videoEncoder->stopVideoEncode();
+
+        results[i].status = frames < 0 || rendition->frames < 0 ? -1 : 0;
+        results[i].frames = FFMAX(rendition->frames, 0);
+        results[i].stats = rendition->stats;
+        results[i].stats.add(rendition->videoEncoder->getStats());
+
+        delete rendition->videoEncoder;
+        rendition->videoEncoder = NULL;
+    }
+
+    for (size_t i = 0; i < results.size(); i++)
+        results[i].elapsedTime = elapsedTime;
+
+    results[0].stats.add(m_videoDecoder.getStats());
+
+    // release queued frames before their decoder
+    freeRenditions();
+
+    m_videoDecoder.closeVideo();
+
+    return frames;
+}
@@ -0,0 +1,349 @@
+
+/**
+ * Description: MemoryIO Class
+ *                  read input from and write output to memory buffers or
+ *                  callbacks instead of files
+ */
+
+#include "MemoryIO.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+extern "C" {
+    #include <libavutil/common.h>
+    #include <libavutil/mem.h>
+}
+
+// size of avio buffer
+#define MEMORY_AVIO_SIZE (32 * 1024)
+
+using namespace std;
+
+/**
+ * @brief: Default constructor for MemoryIO
+ *          nothing is open
+ */
+MemoryIO::MemoryIO()
+{
+    m_inputData = NULL;
+    m_inputSize = 0;
+    m_outputBuffer = NULL;
+    m_position = 0;
+    m_avioCtx = NULL;
+}
+
+/**
+ * @brief: destructor, flush output and free avio context
+ */
+MemoryIO::~MemoryIO()
+{
+    // function call to close
+    close();
+}
+
+/**
+ * @brief: function to allocate avio context with callbacks of current mode
+ *
+ * @params: true for output, true if buffer can seek
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int MemoryIO::allocContext(bool write, bool seekable)
+{
+    m_position = 0;
+
+    // avio context, buffer is owned by context
+    uint8_t *avioBuffer = (uint8_t *)av_malloc(MEMORY_AVIO_SIZE);
+    if (avioBuffer)
+        m_avioCtx = avio_alloc_context(avioBuffer, MEMORY_AVIO_SIZE, write ? 1 : 0, this,
+                                       write ? NULL : &MemoryIO::readPacket,
+                                       write ? &MemoryIO::writePacket : NULL,
+                                       seekable ? &MemoryIO::seek : NULL);
+
+    if (!m_avioCtx)
+    {
+        av_free(avioBuffer);
+        fprintf(stderr, "\x1b[31m" "MemoryIO:: Could not alloc avio context\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to read input from memory buffer, buffer must stay
+ *          valid till close
+ *
+ * @params: input data, size of data
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int MemoryIO::openInput(const uint8_t *data, size_t size)
+{
+    close();
+
+    if (!data || size == 0)
+        return -1; // return failure
+
+    m_inputData = data;
+    m_inputSize = size;
+
+    return allocContext(false, true);
+}
+
+/**
+ * @brief: function to read input from callback, input is streamed so
+ *          formats needing seeks (mp4 with index at end) can not be read
+ *
+ * @params: read callback
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int MemoryIO::openInput(const MemoryReadCallback &readCallback)
+{
+    close();
+
+    if (!readCallback)
+        return -1; // return failure
+
+    m_readCallback = readCallback;
+
+    return allocContext(false, false);
+}
+
+/**
+ * @brief: function to write output to growable buffer, buffer is cleared
+ *          and must stay valid till close
+ *
+ * @params: output buffer
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int MemoryIO::openOutput(vector<uint8_t> *buffer)
+{
+    close();
+
+    if (!buffer)
+        return -1; // return failure
+
+    m_outputBuffer = buffer;
+    m_outputBuffer->clear();
+
+    return allocContext(true, true);
+}
+
+/**
+ * @brief: function to write output to callback, output is streamed so
+ *          formats rewriting headers (mp4) can not be written
+ *
+ * @params: write callback
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int MemoryIO::openOutput(const MemoryWriteCallback &writeCallback)
+{
+    close();
+
+    if (!writeCallback)
+        return -1; // return failure
+
+    m_writeCallback = writeCallback;
+
+    return allocContext(true, false);
+}
+
+/**
+ * @brief: function to flush output and free avio context, demuxer/muxer
+ *          must not use it any more
+ *
+ * @return: returns -1 if any write failed, 0 on success
+ */
+int MemoryIO::close()
+{
+    int status = 0;
+
+    if (m_avioCtx)
+    {
+        // write bytes left in avio buffer
+        if (m_avioCtx->write_flag)
+            avio_flush(m_avioCtx);
+
+        status = m_avioCtx->error < 0 ? -1 : 0;
+
+        av_freep(&m_avioCtx->buffer);
+        av_freep(&m_avioCtx);
+    }
+
+    m_inputData = NULL;
+    m_inputSize = 0;
+    m_readCallback = nullptr;
+    m_outputBuffer = NULL;
+    m_writeCallback = nullptr;
+
+    return status;
+}
+
+/**
+ * @brief: function to check if memoryio is open
+ *
+ * @return: true if open, false otherwise
+ */
+bool MemoryIO::isOpen()
+{
+    return m_avioCtx != NULL;
+}
+
+/**
+ * @brief: avio read callback, from input buffer or read callback
+ *
+ * @params: memoryio, buffer to fill, size of buffer
+ *
+ * @return: no of bytes read, AVERROR_EOF at end of input, AVERROR on failure
+ */
+int MemoryIO::readPacket(void *opaque, uint8_t *buf, int bufSize)
+{
+    MemoryIO *memoryIO = (MemoryIO *)opaque;
+
+    // streamed input
+    if (memoryIO->m_readCallback)
+    {
+        int bytes = memoryIO->m_readCallback(buf, bufSize);
+        if (bytes == 0)
+            return AVERROR_EOF;
+
+        return bytes < 0 ? AVERROR(EIO) : bytes;
+    }
+
+    // input buffer
+    if (memoryIO->m_position >= (int64_t)memoryIO->m_inputSize)
+        return AVERROR_EOF;
+
+    int bytes = (int)FFMIN((int64_t)bufSize, (int64_t)memoryIO->m_inputSize - memoryIO->m_position);
+    memcpy(buf, memoryIO->m_inputData + memoryIO->m_position, bytes);
+    memoryIO->m_position += bytes;
+
+    return bytes;
+}
+
+/**
+ * @brief: avio write callback, to output buffer or write callback. buffer
+ *          grows to hold bytes written after its end
+ *
+ * @params: memoryio, bytes to write, no of bytes
+ *
+ * @return: no of bytes written, AVERROR on failure
+ */
+int MemoryIO::writePacket(void *opaque, uint8_t *buf, int bufSize)
+{
+    MemoryIO *memoryIO = (MemoryIO *)opaque;
+
+    // streamed output
+    if (memoryIO->m_writeCallback)
+        return memoryIO->m_writeCallback(buf, bufSize) < 0 ? AVERROR(EIO) : bufSize;
+
+    // output buffer
+    vector<uint8_t> &outputBuffer = *memoryIO->m_outputBuffer;
+
+    size_t endPos = (size_t)memoryIO->m_position + bufSize;
+    if (endPos > outputBuffer.size())
+        outputBuffer.resize(endPos);
+
+    memcpy(&outputBuffer[(size_t)memoryIO->m_position], buf, bufSize);
+    memoryIO->m_position += bufSize;
+
+    return bufSize;
+}
+
+/**
+ * @brief: avio seek callback, buffers only
+ *
+ * @params: memoryio, offset, whence (SEEK_SET/SEEK_CUR/SEEK_END/AVSEEK_SIZE)
+ *
+ * @return: new position, buffer size for AVSEEK_SIZE, AVERROR on failure
+ */
+int64_t MemoryIO::seek(void *opaque, int64_t offset, int whence)
+{
+    MemoryIO *memoryIO = (MemoryIO *)opaque;
+
+    int64_t size = memoryIO->m_outputBuffer ? (int64_t)memoryIO->m_outputBuffer->size() :
+                                              (int64_t)memoryIO->m_inputSize;
+
+    whence &= ~AVSEEK_FORCE;
+
+    if (whence == AVSEEK_SIZE)
+        return size;
+
+    // target position
+    int64_t position = offset;
+    if (whence == SEEK_CUR)
+        position += memoryIO->m_position;
+    else if (whence == SEEK_END)
+        position += size;
+    else if (whence != SEEK_SET)
+        return AVERROR(EINVAL);
+
+    if (position < 0)
+        return AVERROR(EINVAL);
+
+    memoryIO->m_position = position;
+
+    return position;
+}
+
+/**
+ * @brief: function to fetch avio context for demuxer/muxer
+ *
+ * @return: avio context, NULL if nothing is open
+ */
+AVIOContext* MemoryIO::getAVIOContext()
+{
+    return m_avioCtx;
+}
+
+/**
+ * @brief: read callback of stdin, for piped input ("-i -")
+ *
+ * @params: buffer to fill, size of buffer
+ *
+ * @return: no of bytes read, 0 at end of input, -1 on failure
+ */
+int MemoryIO::readStdin(uint8_t *buf, int size)
+{
+    ssize_t bytes;
+
+    // retry if interrupted by signal
+    do
+        bytes = read(STDIN_FILENO, buf, size);
+    while (bytes < 0 && errno == EINTR);
+
+    return bytes < 0 ? -1 : (int)bytes;
+}
+
+/**
+ * @brief: write callback of stdout, for piped output ("-o -"). pipes take
+ *          partial writes, so bytes are written till all are done
+ *
+ * @params: bytes to write, no of bytes
+ *
+ * @return: -1 on failure (reader closed pipe), 0 on success
+ */
+int MemoryIO::writeStdout(const uint8_t *buf, int size)
+{
+    while (size > 0)
+    {
+        ssize_t bytes = write(STDOUT_FILENO, buf, size);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+
+        if (bytes <= 0)
+            return -1; // return failure
+
+        buf += bytes;
+        size -= (int)bytes;
+    }
+
+    return 0; // return success
+}
@@ -0,0 +1,394 @@
+
+/**
+ * Description: ReadaheadIO Class
+ *                  read input file through a ring buffer filled ahead of
+ *                  the demuxer by a background thread
+ */
+
+#include "ReadaheadIO.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+    #include <libavutil/common.h>
+    #include <libavutil/mem.h>
+}
+
+// size of one file read of readahead thread
+#define READAHEAD_BLOCK_SIZE (1024 * 1024)
+
+// size of avio buffer, demuxer reads are served from ring buffer
+#define READAHEAD_AVIO_SIZE (64 * 1024)
+
+using namespace std;
+
+/**
+ * @brief: Default constructor for ReadaheadIO
+ *          no input is open
+ */
+ReadaheadIO::ReadaheadIO()
+{
+    m_fd = -1;
+    m_fileSize = 0;
+    m_readPos = 0;
+    m_readOffset = 0;
+    m_filled = 0;
+    m_endOfFile = false;
+    m_error = 0;
+    m_stop = false;
+    m_generation = 0;
+    m_avioCtx = NULL;
+    m_bytesRead = 0;
+    m_stalls = 0;
+    m_seeks = 0;
+    m_bufferedSeeks = 0;
+}
+
+/**
+ * @brief: destructor, stop readahead and close input
+ */
+ReadaheadIO::~ReadaheadIO()
+{
+    // function call to close input
+    close();
+}
+
+/**
+ * @brief: function to open input file and start readahead. kernel is told
+ *          the file is read sequentially, so it reads ahead as well
+ *
+ * @params: input filename, size of ring buffer (bytes)
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int ReadaheadIO::open(const string &inputFile, int bufferSize)
+{
+    close();
+
+    m_fd = ::open(inputFile.c_str(), O_RDONLY);
+    if (m_fd < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "ReadaheadIO:: Could not open file: %s\n" "\x1b[0m",
+                                                                    inputFile.c_str());
+        return -1; // return failure
+    }
+
+    struct stat fileStat;
+    if (fstat(m_fd, &fileStat) != 0)
+    {
+        close();
+        return -1; // return failure
+    }
+
+    m_fileSize = (int64_t)fileStat.st_size;
+
+    // sequential access, larger kernel readahead
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // ring buffer, at least two blocks
+    m_buffer.assign((size_t)FFMAX(bufferSize, 2 * READAHEAD_BLOCK_SIZE), 0);
+
+    // avio context, buffer is owned by context
+    uint8_t *avioBuffer = (uint8_t *)av_malloc(READAHEAD_AVIO_SIZE);
+    if (avioBuffer)
+        m_avioCtx = avio_alloc_context(avioBuffer, READAHEAD_AVIO_SIZE, 0, this,
+                                       &ReadaheadIO::readPacket, NULL, &ReadaheadIO::seek);
+
+    if (!m_avioCtx)
+    {
+        av_free(avioBuffer);
+        close();
+        return -1; // return failure
+    }
+
+    // reset read state and counters
+    m_readPos = 0;
+    m_readOffset = 0;
+    m_filled = 0;
+    m_endOfFile = false;
+    m_error = 0;
+    m_stop = false;
+    m_waitStats.reset();
+    m_bytesRead = 0;
+    m_stalls = 0;
+    m_seeks = 0;
+    m_bufferedSeeks = 0;
+
+    // start filling buffer
+    m_thread = thread(&ReadaheadIO::readaheadThread, this);
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to stop readahead and close input file, avio context
+ *          must not be used by demuxer any more
+ */
+void ReadaheadIO::close()
+{
+    // stop readahead thread
+    if (m_thread.joinable())
+    {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_spaceReady.notify_all();
+        m_thread.join();
+    }
+
+    // free avio context and its buffer
+    if (m_avioCtx)
+    {
+        av_freep(&m_avioCtx->buffer);
+        av_freep(&m_avioCtx);
+    }
+
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+    // release ring buffer
+    vector<uint8_t>().swap(m_buffer);
+}
+
+/**
+ * @brief: function to check if input is open
+ *
+ * @return: true if open, false otherwise
+ */
+bool ReadaheadIO::isOpen()
+{
+    return m_avioCtx != NULL;
+}
+
+/**
+ * @brief: readahead thread, reads blocks into free space of ring buffer
+ *          after buffered data. file is read without lock, demuxer only
+ *          reads buffered data, so both never touch the same bytes
+ */
+void ReadaheadIO::readaheadThread()
+{
+    unique_lock<mutex> lock(m_mutex);
+
+    while (!m_stop)
+    {
+        size_t bufferSize = m_buffer.size();
+
+        // wait for free space or a seek
+        if (m_endOfFile || m_filled >= bufferSize)
+        {
+            m_spaceReady.wait(lock);
+            continue;
+        }
+
+        // next free block, up to end of ring
+        size_t writeOffset = (m_readOffset + m_filled) % bufferSize;
+        size_t blockSize = FFMIN(bufferSize - m_filled, bufferSize - writeOffset);
+        blockSize = FFMIN(blockSize, (size_t)READAHEAD_BLOCK_SIZE);
+
+        int64_t filePos = m_readPos + (int64_t)m_filled;
+        uint64_t generation = m_generation;
+
+        // read without lock
+        lock.unlock();
+        ssize_t bytes = pread(m_fd, &m_buffer[writeOffset], blockSize, (off_t)filePos);
+        int readError = bytes < 0 ? errno : 0;
+        lock.lock();
+
+        // seek happened during read, data is for old position
+        if (generation != m_generation)
+            continue;
+
+        if (bytes < 0 && readError == EINTR)
+            continue;
+
+        if (bytes <= 0)
+        {
+            m_endOfFile = true;
+            m_error = bytes < 0 ? AVERROR(readError) : 0;
+        }
+        else
+        {
+            m_filled += (size_t)bytes;
+        }
+
+        m_dataReady.notify_one();
+    }
+}
+
+/**
+ * @brief: avio read callback, copies buffered data, waits only if readahead
+ *          is behind demuxer
+ *
+ * @params: readaheadio, buffer to fill, size of buffer
+ *
+ * @return: no of bytes read, AVERROR_EOF at end of file, AVERROR on failure
+ */
+int ReadaheadIO::readPacket(void *opaque, uint8_t *buf, int bufSize)
+{
+    ReadaheadIO *readaheadIO = (ReadaheadIO *)opaque;
+
+    unique_lock<mutex> lock(readaheadIO->m_mutex);
+
+    // wait for data, time of wait is the i/o stall of demuxer
+    int64_t waitTime = 0;
+    if (readaheadIO->m_filled == 0 && !readaheadIO->m_endOfFile)
+    {
+        int64_t startTime = av_gettime_relative();
+        while (readaheadIO->m_filled == 0 && !readaheadIO->m_endOfFile && !readaheadIO->m_stop)
+            readaheadIO->m_dataReady.wait(lock);
+
+        waitTime = av_gettime_relative() - startTime;
+        readaheadIO->m_stalls++;
+    }
+
+    readaheadIO->m_waitStats.addSample(waitTime);
+
+    if (readaheadIO->m_filled == 0)
+        return readaheadIO->m_error < 0 ? readaheadIO->m_error : AVERROR_EOF;
+
+    // buffered data, up to end of ring
+    size_t bufferSize = readaheadIO->m_buffer.size();
+    size_t readOffset = readaheadIO->m_readOffset;
+    size_t bytes = FFMIN((size_t)bufSize, readaheadIO->m_filled);
+    bytes = FFMIN(bytes, bufferSize - readOffset);
+
+    // copy without lock, readahead thread does not write buffered data
+    lock.unlock();
+    memcpy(buf, &readaheadIO->m_buffer[readOffset], bytes);
+    lock.lock();
+
+    // free copied data
+    readaheadIO->m_readOffset = (readOffset + bytes) % bufferSize;
+    readaheadIO->m_filled -= bytes;
+    readaheadIO->m_readPos += (int64_t)bytes;
+    readaheadIO->m_bytesRead += (int64_t)bytes;
+
+    readaheadIO->m_spaceReady.notify_one();
+
+    return (int)bytes;
+}
+
+/**
+ * @brief: avio seek callback. seeks forward inside buffered data drop
+ *          the skipped bytes, other seeks restart readahead at new position
+ *
+ * @params: readaheadio, offset, whence (SEEK_SET/SEEK_CUR/SEEK_END/AVSEEK_SIZE)
+ *
+ * @return: new position, file size for AVSEEK_SIZE, AVERROR on failure
+ */
+int64_t ReadaheadIO::seek(void *opaque, int64_t offset, int whence)
+{
+    ReadaheadIO *readaheadIO = (ReadaheadIO *)opaque;
+
+    whence &= ~AVSEEK_FORCE;
+
+    if (whence == AVSEEK_SIZE)
+        return readaheadIO->m_fileSize;
+
+    lock_guard<mutex> lock(readaheadIO->m_mutex);
+
+    // target position
+    int64_t position = offset;
+    if (whence == SEEK_CUR)
+        position += readaheadIO->m_readPos;
+    else if (whence == SEEK_END)
+        position += readaheadIO->m_fileSize;
+    else if (whence != SEEK_SET)
+        return AVERROR(EINVAL);
+
+    if (position < 0)
+        return AVERROR(EINVAL);
+
+    readaheadIO->m_seeks++;
+
+    int64_t skip = position - readaheadIO->m_readPos;
+    if (skip >= 0 && skip <= (int64_t)readaheadIO->m_filled)
+    {
+        // inside buffered data, drop skipped bytes
+        readaheadIO->m_readOffset = (readaheadIO->m_readOffset + (size_t)skip) %
+                                                            readaheadIO->m_buffer.size();
+        readaheadIO->m_filled -= (size_t)skip;
+        readaheadIO->m_bufferedSeeks++;
+    }
+    else
+    {
+        // restart readahead at new position, block being read is dropped
+        readaheadIO->m_readOffset = 0;
+        readaheadIO->m_filled = 0;
+        readaheadIO->m_endOfFile = false;
+        readaheadIO->m_error = 0;
+        readaheadIO->m_generation++;
+
+        // kernel starts reading new position too
+        posix_fadvise(readaheadIO->m_fd, (off_t)position, (off_t)readaheadIO->m_buffer.size(),
+                                                                    POSIX_FADV_WILLNEED);
+    }
+
+    readaheadIO->m_readPos = position;
+    readaheadIO->m_spaceReady.notify_one();
+
+    return position;
+}
+
+/**
+ * @brief: function to fetch avio context for demuxer
+ *
+ * @return: avio context, NULL if no input is open
+ */
+AVIOContext* ReadaheadIO::getAVIOContext()
+{
+    return m_avioCtx;
+}
+
+/**
+ * @brief: function to fetch time demuxer waited for data, one sample per
+ *          read, 0 if data was buffered
+ *
+ * @return: wait stats (micro seconds)
+ */
+const StageStats& ReadaheadIO::getWaitStats()
+{
+    return m_waitStats;
+}
+
+/**
+ * @brief: function to fetch no of bytes handed to demuxer
+ */
+int64_t ReadaheadIO::getBytesRead()
+{
+    return m_bytesRead;
+}
+
+/**
+ * @brief: function to fetch no of reads that waited for data
+ */
+int ReadaheadIO::getStalls()
+{
+    return m_stalls;
+}
+
+/**
+ * @brief: function to fetch no of seeks
+ */
+int ReadaheadIO::getSeeks()
+{
+    return m_seeks;
+}
+
+/**
+ * @brief: function to fetch no of seeks inside buffered data
+ */
+int ReadaheadIO::getBufferedSeeks()
+{
+    return m_bufferedSeeks;
+}
@@ -0,0 +1,453 @@
+
+/**
+ * Description: SegmentTranscoder Class
+ *                  transcode one long video in keyframe aligned segments
+ *                  on parallel workers
+ */
+
+#include "SegmentTranscoder.h"
+#include "FrameRateFilter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+
+extern "C" {
+    #include <libavutil/time.h>
+}
+
+using namespace std;
+
+/**
+ * @brief: function to compare keyframes by timestamp
+ */
+static bool compareKeyFrames(const KeyFrameInfo &first, const KeyFrameInfo &second)
+{
+    return first.pts < second.pts;
+}
+
+/**
+ * @brief: Parameterized constructor for SegmentTranscoder
+ *
+ * @params: no of segments encoded in parallel, default = 1
+ */
+SegmentTranscoder::SegmentTranscoder(int segments)
+{
+    // at least one segment
+    m_segments = segments > 0 ? segments : 1;
+}
+
+/**
+ * @brief: function to choose split points. input is split at the keyframes
+ *          nearest to equal parts of its duration, so every segment can be
+ *          decoded on its own
+ *
+ * @return: returns -1 on failure, no of segments on success
+ */
+int SegmentTranscoder::findSplitPoints()
+{
+    m_splitPoints.clear();
+
+    // open video to read keyframes
+    VideoDecoder videoDecoder;
+    videoDecoder.setDecoderContext(m_job.decoderContext);
+
+    if (videoDecoder.openVideo(m_job.inputFile) < 0)
+        return -1; // return failure
+
+    // find keyframes, no decoding
+    vector<KeyFrameInfo> keyFrames;
+    if (videoDecoder.probeKeyFrames(keyFrames) < 0)
+    {
+        videoDecoder.closeVideo();
+        return -1; // return failure
+    }
+
+    // output frame rate, input frame rate if not given
+    VideoInfo videoInfo;
+    videoDecoder.getVideoInfo(videoInfo);
+
+    if (m_job.encoderContext.frameRate <= 0)
+        m_job.encoderContext.frameRate = videoInfo.frameRate > 0 ? videoInfo.frameRate : 15;
+
+    // end of video, in stream time base
+    AVStream *avStream = videoDecoder.getVideoStream();
+    int64_t endPts = AV_NOPTS_VALUE;
+    if (avStream->duration != AV_NOPTS_VALUE)
+        endPts = avStream->duration + (avStream->start_time != AV_NOPTS_VALUE ?
+                                                        avStream->start_time : 0);
+
+    // range of video to transcode
+    int64_t rangeStartPts = m_job.startTime > 0 ? videoDecoder.getTimestamp(m_job.startTime) : 
+                                                                            AV_NOPTS_VALUE;
+    if (m_job.endTime > 0)
+        endPts = videoDecoder.getTimestamp(m_job.endTime);
+
+    videoDecoder.closeVideo();
+
+    // drop keyframes without timestamp or outside range, sort by timestamp
+    for (size_t i = 0; i < keyFrames.size(); )
+    {
+        if (keyFrames[i].pts == AV_NOPTS_VALUE ||
+            (rangeStartPts != AV_NOPTS_VALUE && keyFrames[i].pts <= rangeStartPts) ||
+            (m_job.endTime > 0 && keyFrames[i].pts >= endPts))
+            keyFrames.erase(keyFrames.begin() + i);
+        else
+            i++;
+    }
+
+    sort(keyFrames.begin(), keyFrames.end(), compareKeyFrames);
+
+    // first keyframe starts video, every keyframe after start of range can split
+    size_t keyFrame = rangeStartPts != AV_NOPTS_VALUE ? 0 : 1;
+
+    // at least one keyframe is needed to split
+    if (keyFrames.size() < keyFrame + 1)
+        return 1;
+
+    int64_t startPts = rangeStartPts != AV_NOPTS_VALUE ? rangeStartPts : keyFrames.front().pts;
+    if (endPts == AV_NOPTS_VALUE || endPts <= keyFrames.back().pts)
+        endPts = keyFrames.back().pts + 1;
+
+    // first segment starts at start of video, or of range
+    m_splitPoints.push_back(INT64_MIN);
+
+    // pick keyframe nearest to every equal part
+    for (int segment = 1; segment < m_segments; segment++)
+    {
+        int64_t targetPts = startPts + (endPts - startPts) * segment / m_segments;
+
+        // advance while next keyframe is nearer to target
+        while (keyFrame + 1 < keyFrames.size() &&
+                llabs(keyFrames[keyFrame + 1].pts - targetPts) <=
+                llabs(keyFrames[keyFrame].pts - targetPts))
+            keyFrame++;
+
+        // no keyframe left to split at
+        if (keyFrame >= keyFrames.size())
+            break;
+
+        m_splitPoints.push_back(keyFrames[keyFrame].pts);
+        keyFrame++;
+    }
+
+    // last segment ends at end of video, or of range
+    m_splitPoints.push_back(INT64_MAX);
+
+    return (int)m_splitPoints.size() - 1;
+}
+
+/**
+ * @brief: worker thread, decodes frames of one segment and encodes them
+ *          into temporary output video of segment
+ *
+ * @params: index of segment
+ */
+void SegmentTranscoder::runSegment(int segment)
+{
+    m_segmentFrames[segment] = -1;
+
+    // set encoder context, size is resolved from input
+    VideoEncoderContext encoderContext = m_job.encoderContext;
+    encoderContext.outputVideoFile = m_segmentFiles[segment];
+
+    // segments are plain files, only joined output is segmented
+    encoderContext.segmentFormat = SEGMENT_FORMAT_NONE;
+
+    // open video for decoding
+    VideoDecoder videoDecoder;
+
+    if (Transcoder::openInput(videoDecoder, m_job.inputFile, m_job.decoderContext, 
+                                                            encoderContext) < 0)
+        return; // return failure
+
+    int64_t startPts = m_splitPoints[segment];
+    int64_t endPts = m_splitPoints[segment + 1];
+
+    // seek to keyframe starting segment, first segment to start of range
+    if ((segment > 0 && videoDecoder.seekToKeyFrame(startPts) < 0) ||
+        (segment == 0 && m_job.startTime > 0 && videoDecoder.seek(m_job.startTime) < 0))
+    {
+        videoDecoder.closeVideo();
+        return; // return failure
+    }
+
+    // last segment ends at end of range
+    videoDecoder.setEndTime(m_job.endTime);
+
+    // start video encoding
+    VideoEncoder videoEncoder(encoderContext);
+
+    if (videoEncoder.startVideoEncode() < 0)
+    {
+        videoDecoder.closeVideo();
+        return; // return failure
+    }
+
+    int frames = 0;
+
+    // decoded frame, references decoder planes
+    AVFrame *decodedFrame = av_frame_alloc();
+
+    // selects decoded frames for output frame rate, from start of segment
+    FrameRateFilter frameRateFilter;
+    frameRateFilter.init(videoDecoder, encoderContext.frameRate, 
+                         segment > 0 ? startPts : AV_NOPTS_VALUE);
+
+    // get a new frame from the video, until end of segment
+    while (decodedFrame && videoDecoder.getNewFrame(decodedFrame) > 0)
+    {
+        int64_t pts = av_frame_get_best_effort_timestamp(decodedFrame);
+
+        // frame belongs to next segment
+        if (pts != AV_NOPTS_VALUE && pts >= endPts)
+        {
+            av_frame_unref(decodedFrame);
+            break;
+        }
+
+        // frame belongs to previous segment
+        if (pts != AV_NOPTS_VALUE && pts < startPts)
+        {
+            av_frame_unref(decodedFrame);
+            continue;
+        }
+
+        // no of output frames, dropped frames are not converted
+        int copies = frameRateFilter.filterFrame(pts);
+
+        // add frame to output video, converted only if needed
+        int size = 0;
+        for (int copy = 0; copy < copies && size >= 0; copy++)
+            size = videoEncoder.addNewFrame(decodedFrame);
+
+        // release decoded frame
+        av_frame_unref(decodedFrame);
+
+        // check if encoding was succesful
+        if (size < 0)
+        {
+            frames = -1;
+            break;
+        }
+
+        frames += copies;
+    }
+
+    av_frame_free(&decodedFrame);
+
+    // stop video encoding and decoding
+    videoEncoder.stopVideoEncode();
+
+    m_segmentStats[segment] = videoDecoder.getStats();
+    m_segmentStats[segment].add(videoEncoder.getStats());
+
+    videoDecoder.closeVideo();
+
+    m_segmentFrames[segment] = frames;
+}
+
+/**
+ * @brief: function to join encoded segments into output video, packets
+ *          are copied with timestamps shifted by frames of earlier segments
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int SegmentTranscoder::joinSegments()
+{
+    VideoEncoderContext encoderContext = m_job.encoderContext;
+    encoderContext.outputVideoFile = m_job.outputFile;
+
+    VideoEncoder videoEncoder(encoderContext);
+
+    // time base of one frame
+    AVRational frameTimeBase = {1, FFMAX(encoderContext.frameRate, 1)};
+
+    // no of frames in earlier segments
+    int64_t frameOffset = 0;
+
+    for (size_t segment = 0; segment < m_segmentFiles.size(); segment++)
+    {
+        // open encoded segment
+        VideoDecoder videoDecoder;
+        if (videoDecoder.openVideo(m_segmentFiles[segment]) < 0)
+        {
+            videoEncoder.stopVideoEncode();
+            return -1; // return failure
+        }
+
+        AVStream *avStream = videoDecoder.getVideoStream();
+
+        // start output video with codec parameters of first segment
+        if (segment == 0 && videoEncoder.startStreamCopy(avStream) < 0)
+        {
+            videoDecoder.closeVideo();
+            return -1; // return failure
+        }
+
+        // timestamp shift, in segment time base
+        int64_t ptsOffset = av_rescale_q(frameOffset, frameTimeBase, avStream->time_base);
+
+        AVPacket avPkt;
+        av_init_packet(&avPkt);
+        avPkt.data = NULL;
+        avPkt.size = 0;
+
+        // copy all packets of segment
+        int retStatus = 0;
+        while (retStatus >= 0 && videoDecoder.readPacket(&avPkt) >= 0)
+        {
+            if (avPkt.pts != AV_NOPTS_VALUE)
+                avPkt.pts += ptsOffset;
+
+            if (avPkt.dts != AV_NOPTS_VALUE)
+                avPkt.dts += ptsOffset;
+
+            retStatus = videoEncoder.addPacket(&avPkt, avStream->time_base);
+
+            av_free_packet(&avPkt);
+        }
+
+        m_joinStats.add(videoDecoder.getStats());
+        videoDecoder.closeVideo();
+
+        if (retStatus < 0)
+        {
+            videoEncoder.stopVideoEncode();
+            return -1; // return failure
+        }
+
+        frameOffset += m_segmentFrames[segment];
+    }
+
+    videoEncoder.stopVideoEncode();
+    m_joinStats.add(videoEncoder.getStats());
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to run one transcoding job in segments. input without
+ *          enough keyframes is transcoded as a whole
+ *
+ * @params: job to run, result to fill
+ *
+ * @return: returns -1 on failure, no of encoded frames on success
+ */
+int SegmentTranscoder::transcode(const TranscodeJob &job, TranscodeResult &result)
+{
+    // one segment, nothing to split
+    if (m_segments <= 1)
+        return Transcoder::transcode(job, result);
+
+    // job start time
+    int64_t startTime = av_gettime_relative();
+
+    // fill job files
+    result.inputFile = job.inputFile;
+    result.outputFile = job.outputFile;
+    result.status = -1;
+    result.frames = 0;
+
+    // make ffmpeg safe to use from workers
+    if (Transcoder::initThreading() < 0)
+        return -1; // return failure
+
+    m_job = job;
+
+    // choose split points
+    int segments = findSplitPoints();
+    if (segments < 0)
+    {
+        result.elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+        return -1; // return failure
+    }
+
+    // can not split, transcode as a whole
+    if (segments <= 1)
+        return Transcoder::transcode(job, result);
+
+    fprintf(stderr, "\x1b[32m" "SegmentTranscoder:: Transcoding in %d segments\n" "\x1b[0m",
+                                                                                segments);
+
+    // share cpu cores among segments, where threads are auto
+    int cores = FFMAX((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+    int threadsPerSegment = FFMAX(cores / segments, 1);
+
+    if (m_job.decoderContext.threadCount <= 0)
+        m_job.decoderContext.threadCount = threadsPerSegment;
+
+    if (m_job.encoderContext.threadCount <= 0)
+        m_job.encoderContext.threadCount = threadsPerSegment;
+
+    // temporary output of every segment, same container as output
+    string baseName = job.outputFile;
+    string extension = "";
+    size_t pos = baseName.find_last_of("./");
+    if (pos != string::npos && baseName[pos] == '.')
+    {
+        extension = baseName.substr(pos);
+        baseName = baseName.substr(0, pos);
+    }
+
+    // segmented output, temporary segments in container of its segments
+    if (m_job.encoderContext.segmentFormat == SEGMENT_FORMAT_HLS)
+        extension = ".ts";
+    else if (m_job.encoderContext.segmentFormat == SEGMENT_FORMAT_DASH)
+        extension = ".mp4";
+
+    m_segmentFiles.clear();
+    for (int segment = 0; segment < segments; segment++)
+        m_segmentFiles.push_back(baseName + ".seg" + to_string(segment) + extension);
+
+    m_segmentFrames.assign(segments, -1);
+    m_segmentStats.assign(segments, TranscodeStats());
+    m_joinStats.reset();
+
+    // transcode segments in parallel
+    vector<thread> workers;
+    for (int segment = 0; segment < segments; segment++)
+        workers.push_back(thread(&SegmentTranscoder::runSegment, this, segment));
+
+    // wait for all segments
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    // count encoded frames, check for failed segment
+    int frames = 0;
+    for (int segment = 0; segment < segments && frames >= 0; segment++)
+    {
+        if (m_segmentFrames[segment] < 0)
+        {
+            fprintf(stderr, "\x1b[31m" "SegmentTranscoder:: Segment %d failed\n" "\x1b[0m", segment);
+            frames = -1;
+        }
+        else
+        {
+            frames += m_segmentFrames[segment];
+        }
+    }
+
+    // join segments into output video
+    if (frames >= 0 && joinSegments() < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "SegmentTranscoder:: Could not join segments\n" "\x1b[0m");
+        frames = -1;
+    }
+
+    // remove temporary outputs
+    for (size_t i = 0; i < m_segmentFiles.size(); i++)
+        unlink(m_segmentFiles[i].c_str());
+
+    // fill job result, stats of all segments and joining
+    result.status = frames < 0 ? -1 : 0;
+    result.frames = frames < 0 ? 0 : frames;
+    result.elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+
+    result.stats = m_joinStats;
+    for (size_t i = 0; i < m_segmentStats.size(); i++)
+        result.stats.add(m_segmentStats[i]);
+
+    return frames;
+}
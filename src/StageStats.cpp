@@ -0,0 +1,310 @@
+
+/**
+ * Description: StageStats Class
+ *                  count time, bytes and latency histogram of transcoding
+ *                  stages
+ */
+
+#include "StageStats.h"
+
+#include <cstring>
+
+extern "C" {
+    #include <libavutil/common.h>
+}
+
+using namespace std;
+
+// stats are disabled until enabled
+atomic<bool> StageStats::s_enabled(false);
+
+// names of stages in json
+static const char *stageNames[TRANSCODE_STAGES] = {
+    "demux", "decode", "convert", "encode", "write"
+};
+
+/**
+ * @brief: Default constructor for StageStats
+ *          no samples
+ */
+StageStats::StageStats()
+{
+    reset();
+}
+
+/**
+ * @brief: function to enable or disable timing of all stages, stages are
+ *          timed by all decoders and encoders once enabled
+ *
+ * @params: true to enable
+ */
+void StageStats::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled, memory_order_relaxed);
+}
+
+/**
+ * @brief: function to find bucket of a sample. samples below 8 have a
+ *          bucket each, above 8 every power of 2 is split in 4 buckets
+ *
+ * @params: sample
+ *
+ * @return: bucket index
+ */
+int StageStats::getBucket(int64_t value)
+{
+    if (value < 8)
+        return value > 0 ? (int)value : 0;
+
+    // highest set bit, >= 3
+    int exponent = 63 - __builtin_clzll((unsigned long long)value);
+
+    // next two bits
+    int quarter = (int)((value >> (exponent - 2)) & 3);
+
+    int bucket = 8 + (exponent - 3) * 4 + quarter;
+    return bucket < STAGE_STATS_BUCKETS ? bucket : STAGE_STATS_BUCKETS - 1;
+}
+
+/**
+ * @brief: function to find middle sample of a bucket
+ *
+ * @params: bucket index
+ *
+ * @return: middle sample of bucket
+ */
+int64_t StageStats::getBucketValue(int bucket)
+{
+    if (bucket < 8)
+        return bucket;
+
+    int exponent = (bucket - 8) / 4 + 3;
+    int quarter = (bucket - 8) % 4;
+
+    // bucket is 2^(exponent-2) wide
+    int64_t width = (int64_t)1 << (exponent - 2);
+
+    return (4 + quarter) * width + width / 2;
+}
+
+/**
+ * @brief: function to add one sample
+ *
+ * @params: sample, bytes processed by stage
+ */
+void StageStats::addSample(int64_t value, int64_t bytes)
+{
+    m_count++;
+    m_total += value;
+    m_bytes += bytes;
+
+    if (value > m_max)
+        m_max = value;
+
+    m_histogram[getBucket(value)]++;
+}
+
+/**
+ * @brief: function to add samples of other stats
+ *
+ * @params: stats to add
+ */
+void StageStats::add(const StageStats &stageStats)
+{
+    m_count += stageStats.m_count;
+    m_total += stageStats.m_total;
+    m_bytes += stageStats.m_bytes;
+
+    if (stageStats.m_max > m_max)
+        m_max = stageStats.m_max;
+
+    for (int i = 0; i < STAGE_STATS_BUCKETS; i++)
+        m_histogram[i] += stageStats.m_histogram[i];
+}
+
+/**
+ * @brief: function to clear all samples
+ */
+void StageStats::reset()
+{
+    m_count = 0;
+    m_total = 0;
+    m_max = 0;
+    m_bytes = 0;
+
+    memset(m_histogram, 0, sizeof(m_histogram));
+}
+
+/**
+ * @brief: function to fetch no of samples
+ */
+int64_t StageStats::getCount() const
+{
+    return m_count;
+}
+
+/**
+ * @brief: function to fetch sum of samples
+ */
+int64_t StageStats::getTotal() const
+{
+    return m_total;
+}
+
+/**
+ * @brief: function to fetch max sample
+ */
+int64_t StageStats::getMax() const
+{
+    return m_max;
+}
+
+/**
+ * @brief: function to fetch bytes processed by stage
+ */
+int64_t StageStats::getBytes() const
+{
+    return m_bytes;
+}
+
+/**
+ * @brief: function to fetch average sample
+ *
+ * @return: average, 0 if there are no samples
+ */
+double StageStats::getAverage() const
+{
+    return m_count > 0 ? (double)m_total / m_count : 0.0;
+}
+
+/**
+ * @brief: function to fetch sample at a percentile, from histogram. value
+ *          is middle of its bucket, within 12.5% of the real sample
+ *
+ * @params: percentile (0..100)
+ *
+ * @return: sample at percentile, 0 if there are no samples
+ */
+int64_t StageStats::getPercentile(double percentile) const
+{
+    if (m_count <= 0)
+        return 0;
+
+    // rank of sample, 1 based
+    int64_t rank = (int64_t)(percentile / 100.0 * m_count + 0.5);
+    rank = FFMIN(FFMAX(rank, 1), m_count);
+
+    int64_t seen = 0;
+    for (int i = 0; i < STAGE_STATS_BUCKETS; i++)
+    {
+        seen += m_histogram[i];
+        if (seen >= rank)
+            return FFMIN(getBucketValue(i), m_max);
+    }
+
+    return m_max;
+}
+
+/**
+ * @brief: function to add stats of other job part
+ *
+ * @params: stats to add
+ */
+void TranscodeStats::add(const TranscodeStats &transcodeStats)
+{
+    for (int i = 0; i < TRANSCODE_STAGES; i++)
+        stages[i].add(transcodeStats.stages[i]);
+
+    decodeQueue.add(transcodeStats.decodeQueue);
+    encodeQueue.add(transcodeStats.encodeQueue);
+    inputWait.add(transcodeStats.inputWait);
+    outputWait.add(transcodeStats.outputWait);
+    encodeLatency.add(transcodeStats.encodeLatency);
+    encodeDelay.add(transcodeStats.encodeDelay);
+}
+
+/**
+ * @brief: function to clear all stats
+ */
+void TranscodeStats::reset()
+{
+    for (int i = 0; i < TRANSCODE_STAGES; i++)
+        stages[i].reset();
+
+    decodeQueue.reset();
+    encodeQueue.reset();
+    inputWait.reset();
+    outputWait.reset();
+    encodeLatency.reset();
+    encodeDelay.reset();
+}
+
+/**
+ * @brief: function to write stats as json object, stage times in micro
+ *          seconds, queue depths in frames
+ *
+ * @params: output file, indent of object members
+ */
+void TranscodeStats::writeJson(FILE *jsonFp, const char *indent) const
+{
+    fprintf(jsonFp, "{\n%s\"stages\": {\n", indent);
+
+    for (int i = 0; i < TRANSCODE_STAGES; i++)
+    {
+        const StageStats &stage = stages[i];
+
+        fprintf(jsonFp, "%s  \"%s\": {\"count\": %lld, \"bytes\": %lld, \"total_ms\": %.3f, "
+                        "\"avg_us\": %.2f, \"p50_us\": %lld, \"p99_us\": %lld, \"max_us\": %lld}%s\n",
+                        indent, stageNames[i], (long long)stage.getCount(),
+                        (long long)stage.getBytes(), stage.getTotal() / 1000.0, stage.getAverage(),
+                        (long long)stage.getPercentile(50), (long long)stage.getPercentile(99),
+                        (long long)stage.getMax(), i + 1 < TRANSCODE_STAGES ? "," : "");
+    }
+
+    fprintf(jsonFp, "%s},\n%s\"queues\": {\n", indent, indent);
+
+    const StageStats *queues[2] = {&decodeQueue, &encodeQueue};
+    const char *queueNames[2] = {"decode", "encode"};
+
+    for (int i = 0; i < 2; i++)
+    {
+        fprintf(jsonFp, "%s  \"%s\": {\"samples\": %lld, \"avg\": %.2f, \"p50\": %lld, "
+                        "\"p99\": %lld, \"max\": %lld}%s\n",
+                        indent, queueNames[i], (long long)queues[i]->getCount(),
+                        queues[i]->getAverage(), (long long)queues[i]->getPercentile(50),
+                        (long long)queues[i]->getPercentile(99), (long long)queues[i]->getMax(),
+                        i + 1 < 2 ? "," : "");
+    }
+
+    // i/o waits, only counted with readahead input and async writer output
+    fprintf(jsonFp, "%s},\n%s\"io\": {\n", indent, indent);
+
+    const StageStats *waits[2] = {&inputWait, &outputWait};
+    const char *waitNames[2] = {"input_wait", "output_wait"};
+
+    for (int i = 0; i < 2; i++)
+    {
+        fprintf(jsonFp, "%s  \"%s\": {\"calls\": %lld, \"total_ms\": %.3f, \"avg_us\": %.2f, "
+                        "\"p99_us\": %lld, \"max_us\": %lld}%s\n",
+                        indent, waitNames[i], (long long)waits[i]->getCount(),
+                        waits[i]->getTotal() / 1000.0, waits[i]->getAverage(),
+                        (long long)waits[i]->getPercentile(99), (long long)waits[i]->getMax(),
+                        i + 1 < 2 ? "," : "");
+    }
+
+    // encoder latency, only measured in low latency mode or while stages are timed
+    fprintf(jsonFp, "%s},\n%s\"latency\": {\n", indent, indent);
+    fprintf(jsonFp, "%s  \"encode_us\": {\"frames\": %lld, \"avg\": %.2f, \"p50\": %lld, "
+                    "\"p99\": %lld, \"max\": %lld},\n",
+                    indent, (long long)encodeLatency.getCount(), encodeLatency.getAverage(),
+                    (long long)encodeLatency.getPercentile(50),
+                    (long long)encodeLatency.getPercentile(99), (long long)encodeLatency.getMax());
+    fprintf(jsonFp, "%s  \"encode_frames\": {\"frames\": %lld, \"avg\": %.2f, \"p99\": %lld, "
+                    "\"max\": %lld}\n",
+                    indent, (long long)encodeDelay.getCount(), encodeDelay.getAverage(),
+                    (long long)encodeDelay.getPercentile(99), (long long)encodeDelay.getMax());
+
+    // closing brace at indent of enclosing member
+    size_t indentLen = strlen(indent);
+    fprintf(jsonFp, "%s}\n%.*s}", indent, (int)(indentLen >= 2 ? indentLen - 2 : 0), indent);
+}
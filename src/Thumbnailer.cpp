@@ -0,0 +1,301 @@
+
+/**
+ * Description: Thumbnailer Class
+ *                  sample frames of a video into images or a contact sheet
+ */
+
+#include "Thumbnailer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+extern "C" {
+    #include <libavutil/imgutils.h>
+    #include <libavutil/time.h>
+}
+
+// max width of index in filename pattern, e.g. %04d
+#define MAX_INDEX_WIDTH 16
+
+using namespace std;
+
+/**
+ * @brief: Parameterized constructor for Thumbnailer
+ *
+ * @params: thumbnail options
+ */
+Thumbnailer::Thumbnailer(const ThumbnailContext &thumbnailContext)
+    : m_imageWriter(thumbnailContext.quality)
+{
+    m_thumbnailContext = thumbnailContext;
+}
+
+/**
+ * @brief: function to find sample times of video, evenly spread if a
+ *          count is given, every interval otherwise
+ *
+ * @params: input video info, vector to fill sample times (seconds)
+ *
+ * @return: returns -1 on failure, no of samples on success
+ */
+int Thumbnailer::getSampleTimes(const VideoInfo &videoInfo, vector<double> &sampleTimes)
+{
+    sampleTimes.clear();
+
+    // duration of video, from frames if container has none
+    double duration = videoInfo.duration;
+    if (duration <= 0 && videoInfo.totalFrame > 0 && videoInfo.frameRate > 0)
+        duration = (double)videoInfo.totalFrame / videoInfo.frameRate;
+
+    if (duration <= 0)
+    {
+        fprintf(stderr, "\x1b[31m" "Thumbnailer:: Video duration not known\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    if (m_thumbnailContext.count > 0)
+    {
+        // middle of equal parts
+        for (int i = 0; i < m_thumbnailContext.count; i++)
+            sampleTimes.push_back(duration * (i + 0.5) / m_thumbnailContext.count);
+    }
+    else
+    {
+        // every interval from start
+        double interval = m_thumbnailContext.interval > 0 ? m_thumbnailContext.interval : 10.0;
+        for (double time = 0.0; time < duration; time += interval)
+            sampleTimes.push_back(time);
+    }
+
+    return (int)sampleTimes.size();
+}
+
+/**
+ * @brief: function to replace index tokens of filename pattern. %d, %Nd
+ *          and %0Nd are replaced by index, %% by %, anything else is
+ *          copied as is. pattern is never used as printf format
+ *
+ * @params: filename pattern, index, string to fill filename
+ *
+ * @return: no of index tokens replaced
+ */
+static int expandIndex(const string &pattern, int index, string &imageFile)
+{
+    int tokens = 0;
+    imageFile = "";
+
+    // replace tokens of pattern
+    for (size_t i = 0; i < pattern.size(); i++)
+    {
+        if (pattern[i] == '%' && i + 1 < pattern.size())
+        {
+            // escaped %
+            if (pattern[i + 1] == '%')
+            {
+                imageFile += '%';
+                i++;
+                continue;
+            }
+
+            // optional zero padding and width
+            size_t pos = i + 1;
+            bool zeroPad = pattern[pos] == '0';
+            if (zeroPad)
+                pos++;
+
+            int width = 0;
+            while (pos < pattern.size() && isdigit((unsigned char)pattern[pos]))
+            {
+                width = min(width * 10 + (pattern[pos] - '0'), MAX_INDEX_WIDTH);
+                pos++;
+            }
+
+            // index token
+            if (pos < pattern.size() && pattern[pos] == 'd')
+            {
+                string number = to_string(index);
+                if ((int)number.size() < width)
+                    number.insert(0, width - number.size(), zeroPad ? '0' : ' ');
+
+                imageFile += number;
+                tokens++;
+                i = pos;
+                continue;
+            }
+        }
+
+        imageFile += pattern[i];
+    }
+
+    return tokens;
+}
+
+/**
+ * @brief: function to make image filename of a sample, index is inserted
+ *          at %d of output pattern, or before extension if there is none
+ *
+ * @params: index of sample
+ *
+ * @return: image filename
+ */
+string Thumbnailer::getImageName(int index)
+{
+    string pattern = m_thumbnailContext.outputFile;
+    string imageFile;
+
+    // index in pattern
+    if (expandIndex(pattern, index, imageFile) > 0)
+        return imageFile;
+
+    // no index in pattern, insert before extension
+    string number;
+    expandIndex("_%04d", index, number);
+
+    size_t pos = imageFile.find_last_of("./");
+    if (pos != string::npos && imageFile[pos] == '.')
+        imageFile.insert(pos, number);
+    else
+        imageFile += number;
+
+    return imageFile;
+}
+
+/**
+ * @brief: function to sample frames of a video and write them as images,
+ *          or as tiles of one contact sheet. every sample is found by
+ *          seeking, frames between samples are not decoded
+ *
+ * @params: input video filename, video decoder options
+ *
+ * @return: returns -1 on failure, no of sampled frames on success
+ */
+int Thumbnailer::extract(const string &inputFile, const VideoDecoderContext &decoderContext)
+{
+    // run start time
+    int64_t startTime = av_gettime_relative();
+
+    // slice threads, frame threads delay every sample by thread count frames
+    VideoDecoderContext sampleContext = decoderContext;
+    sampleContext.threadType = FF_THREAD_SLICE;
+
+    VideoDecoder videoDecoder;
+    videoDecoder.setDecoderContext(sampleContext);
+
+    if (videoDecoder.openVideo(inputFile) < 0)
+        return -1; // return failure
+
+    VideoInfo videoInfo;
+    videoDecoder.getVideoInfo(videoInfo);
+
+    vector<double> sampleTimes;
+    if (getSampleTimes(videoInfo, sampleTimes) <= 0)
+    {
+        videoDecoder.closeVideo();
+        return -1; // return failure
+    }
+
+    // image size, keeping aspect ratio
+    int width = m_thumbnailContext.width > 0 ? m_thumbnailContext.width : videoInfo.width;
+    int height = (int)av_rescale(width, videoInfo.height, videoInfo.width);
+    width = FFMAX(width & ~1, 2);
+    height = FFMAX(height & ~1, 2);
+
+    // contact sheet, rgb24 tiles in a grid
+    int columns = m_thumbnailContext.columns;
+    int rows = 0;
+    uint8_t *sheetData[4] = {NULL};
+    int sheetLinesize[4] = {0};
+
+    if (columns > 0)
+    {
+        rows = ((int)sampleTimes.size() + columns - 1) / columns;
+
+        if (av_image_alloc(sheetData, sheetLinesize, columns * width, rows * height,
+                                                            PIX_FMT_RGB24, 64) < 0)
+        {
+            videoDecoder.closeVideo();
+            return -1; // return failure
+        }
+
+        // black background
+        memset(sheetData[0], 0, (size_t)sheetLinesize[0] * rows * height);
+    }
+
+    // frame referencing decoder planes
+    AVFrame *avFrame = av_frame_alloc();
+
+    FrameConverter frameConverter;
+
+    int samples = 0;
+    int64_t lastPts = AV_NOPTS_VALUE;
+
+    // sample every time
+    for (size_t i = 0; avFrame && i < sampleTimes.size(); i++)
+    {
+        if (videoDecoder.getFrameAt(sampleTimes[i], avFrame, m_thumbnailContext.keyFrameOnly) < 0)
+            continue;
+
+        // same keyframe as last sample, interval is shorter than gop
+        int64_t pts = av_frame_get_best_effort_timestamp(avFrame);
+        if (pts != AV_NOPTS_VALUE && pts == lastPts)
+        {
+            av_frame_unref(avFrame);
+            continue;
+        }
+
+        lastPts = pts;
+
+        int retStatus = -1;
+
+        if (columns > 0)
+        {
+            // scale and convert into tile of sheet
+            int x = (samples % columns) * width;
+            int y = (samples / columns) * height;
+            uint8_t *tileData[4] = {sheetData[0] + y * sheetLinesize[0] + x * 3, NULL, NULL, NULL};
+
+            retStatus = frameConverter.convert(avFrame->data, avFrame->linesize, avFrame->width,
+                            avFrame->height, (::PixelFormat)avFrame->format, tileData,
+                            sheetLinesize, width, height, PIX_FMT_RGB24);
+        }
+        else
+        {
+            // one image per sample
+            retStatus = m_imageWriter.writeImage(getImageName(samples), avFrame->data,
+                            avFrame->linesize, avFrame->width, avFrame->height,
+                            (::PixelFormat)avFrame->format, width, height);
+        }
+
+        av_frame_unref(avFrame);
+
+        if (retStatus < 0)
+        {
+            fprintf(stderr, "\x1b[31m" "Thumbnailer:: Could not write sample at %.2f sec\n" "\x1b[0m",
+                                                                            sampleTimes[i]);
+            continue;
+        }
+
+        samples++;
+    }
+
+    av_frame_free(&avFrame);
+    videoDecoder.closeVideo();
+
+    // write contact sheet, rows of samples only
+    if (columns > 0)
+    {
+        rows = (samples + columns - 1) / columns;
+
+        if (samples > 0 && m_imageWriter.writeImage(m_thumbnailContext.outputFile, sheetData,
+                        sheetLinesize, columns * width, rows * height, PIX_FMT_RGB24) < 0)
+            samples = -1;
+
+        av_freep(&sheetData[0]);
+    }
+
+    fprintf(stderr, "\x1b[32m" "Thumbnailer:: %d samples in %.2f sec\n" "\x1b[0m", samples,
+                                        (av_gettime_relative() - startTime) / 1000000.0);
+
+    return samples;
+}
@@ -0,0 +1,302 @@
+
+/**
+ * Description: TranscodePipeline Class
+ *                  decode, convert and encode on separate threads
+ */
+
+#include "TranscodePipeline.h"
+
+#include <thread>
+
+extern "C" {
+    #include <libavutil/time.h>
+}
+
+using namespace std;
+
+/**
+ * @brief: Parameterized constructor for TranscodePipeline
+ *
+ * @params: opened video decoder, started video encoder,
+ *          max no of frames queued between two stages
+ */
+TranscodePipeline::TranscodePipeline(VideoDecoder &videoDecoder, VideoEncoder &videoEncoder,
+                                     int queueSize)
+    : m_decodeQueue(queueSize), m_encodeQueue(queueSize)
+{
+    // decoder and encoder
+    m_videoDecoder = &videoDecoder;
+    m_videoEncoder = &videoEncoder;
+
+    // encoder frame format
+    m_pixFmt = PIX_FMT_NONE;
+    m_width = -1;
+    m_height = -1;
+
+    // abort flag
+    m_abort = false;
+}
+
+/**
+ * @brief: function to run all stages until end of video
+ *
+ * @return: returns -1 on failure, no of encoded frames on success
+ */
+int TranscodePipeline::run()
+{
+    // fetch format of frames encoded without conversion
+    if (m_videoEncoder->getFrameFormat(m_pixFmt, m_width, m_height) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "TranscodePipeline:: Encoder not started!!\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    // reset run state
+    m_abort = false;
+    m_stats = PipelineStats();
+
+    // frames in flight are capped by queue sizes, this caps memory too
+    int queuedFrames = (int)(m_decodeQueue.capacity() + m_encodeQueue.capacity());
+    m_shellPool.initShells(queuedFrames + 3);
+
+    if (m_framePool.init(m_pixFmt, m_width, m_height, (int)m_encodeQueue.capacity() + 2) < 0)
+        return -1; // return failure
+
+    // drop frames for output frame rate before they are queued
+    if (m_frameRateFilter.init(*m_videoDecoder, m_videoEncoder->getFrameRate()) < 0)
+        return -1; // return failure
+
+    // run start time
+    int64_t startTime = av_gettime_relative();
+
+    // start stages
+    thread decodeThread(&TranscodePipeline::decodeStage, this);
+    thread convertThread(&TranscodePipeline::convertStage, this);
+    thread encodeThread(&TranscodePipeline::encodeStage, this);
+
+    // wait for all stages to finish
+    decodeThread.join();
+    convertThread.join();
+    encodeThread.join();
+
+    // release frames left after abort
+    drainQueues();
+
+    // update run statistics
+    m_stats.maxDecodeQueue = (int)m_decodeQueue.maxDepth();
+    m_stats.maxEncodeQueue = (int)m_encodeQueue.maxDepth();
+    m_stats.elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+
+    // check if any stage failed
+    if (m_abort)
+        return -1; // return failure
+
+    return m_stats.encodedFrames;
+}
+
+/**
+ * @brief: function to fetch statistics of last run
+ *
+ * @return: pipeline statistics
+ */
+PipelineStats TranscodePipeline::getStats()
+{
+    return m_stats;
+}
+
+/**
+ * @brief: function to fetch a frame from pool, waits while all frames are
+ *          in use. this is the backpressure on the producing stage
+ *
+ * @params: pool to fetch frame from
+ *
+ * @return: frame on success, NULL on abort
+ */
+AVFrame* TranscodePipeline::waitForFrame(FramePool &framePool)
+{
+    for (int retries = 0; !m_abort; retries++)
+    {
+        // fetch free frame
+        AVFrame *avFrame = framePool.getFrame();
+        if (avFrame)
+            return avFrame;
+
+        // wait for a frame to be released
+        if (retries < 64)
+            this_thread::yield();
+        else
+            this_thread::sleep_for(chrono::microseconds(100));
+    }
+
+    return NULL; // aborted
+}
+
+/**
+ * @brief: function to release frames left in queues
+ */
+void TranscodePipeline::drainQueues()
+{
+    AVFrame *avFrame = NULL;
+
+    // release decoded frames
+    while (m_decodeQueue.tryPop(avFrame))
+        FramePool::releaseFrame(avFrame);
+
+    // release converted frames
+    while (m_encodeQueue.tryPop(avFrame))
+        FramePool::releaseFrame(avFrame);
+}
+
+/**
+ * @brief: decode stage, reads and decodes frames into shell frames
+ *          referencing decoder planes, NULL is queued at end of video
+ */
+void TranscodePipeline::decodeStage()
+{
+    while (!m_abort)
+    {
+        // fetch shell frame
+        AVFrame *avFrame = waitForFrame(m_shellPool);
+        if (!avFrame)
+            break; // aborted
+
+        // decode next frame, no copy of pixel data
+        if (m_videoDecoder->getNewFrame(avFrame) <= 0)
+        {
+            FramePool::releaseFrame(avFrame);
+            break; // end of video
+        }
+
+        m_stats.decodedFrames++;
+
+        // no of output frames, dropped frames never reach conversion
+        int copies = m_frameRateFilter.filterFrame(av_frame_get_best_effort_timestamp(avFrame));
+        if (copies == 0)
+        {
+            m_stats.droppedFrames++;
+            FramePool::releaseFrame(avFrame);
+            continue;
+        }
+
+        // one reference per queued copy
+        for (int copy = 1; copy < copies; copy++)
+            FramePool::refFrame(avFrame);
+
+        // queue decoded frame, waits while convert stage is behind
+        int queued = 0;
+        while (queued < copies && m_decodeQueue.push(avFrame, m_abort))
+        {
+            queued++;
+
+            if (StageStats::isEnabled())
+                m_stats.stageStats.decodeQueue.addSample((int64_t)m_decodeQueue.size());
+        }
+
+        // release references not queued
+        if (queued < copies)
+        {
+            for (; queued < copies; queued++)
+                FramePool::releaseFrame(avFrame);
+            break; // aborted
+        }
+    }
+
+    // queue end of video
+    AVFrame *endOfVideo = NULL;
+    m_decodeQueue.push(endOfVideo, m_abort);
+}
+
+/**
+ * @brief: convert stage, converts decoded frames to encoder format.
+ *          frames already in encoder format are passed as they are
+ */
+void TranscodePipeline::convertStage()
+{
+    AVFrame *inpFrame = NULL;
+
+    // loop until end of video
+    while (m_decodeQueue.pop(inpFrame, m_abort) && inpFrame)
+    {
+        AVFrame *outFrame = inpFrame;
+
+        // convert only if format differs from encoder format
+        if (inpFrame->format != m_pixFmt || inpFrame->width != m_width ||
+                                            inpFrame->height != m_height)
+        {
+            // fetch frame in encoder format
+            outFrame = waitForFrame(m_framePool);
+            if (!outFrame)
+            {
+                FramePool::releaseFrame(inpFrame);
+                break; // aborted
+            }
+
+            // convert to encoder format, using cached scale context
+            int64_t stageStart = StageStats::start();
+            if (m_frameConverter.convert(inpFrame->data, inpFrame->linesize, inpFrame->width,
+                        inpFrame->height, (::PixelFormat)inpFrame->format, outFrame->data,
+                        outFrame->linesize, m_width, m_height, m_pixFmt) < 0)
+            {
+                fprintf(stderr, "\x1b[31m" "TranscodePipeline:: Could not convert frame\n" "\x1b[0m");
+                FramePool::releaseFrame(inpFrame);
+                FramePool::releaseFrame(outFrame);
+                m_abort = true;
+                break;
+            }
+
+            m_stats.stageStats.stages[STAGE_CONVERT].stop(stageStart);
+
+            // copy frame properties
+            outFrame->pts = av_frame_get_best_effort_timestamp(inpFrame);
+            outFrame->key_frame = inpFrame->key_frame;
+            outFrame->pict_type = inpFrame->pict_type;
+
+            // release decoded frame
+            FramePool::releaseFrame(inpFrame);
+
+            m_stats.convertedFrames++;
+        }
+
+        // queue frame, waits while encode stage is behind
+        if (!m_encodeQueue.push(outFrame, m_abort))
+        {
+            FramePool::releaseFrame(outFrame);
+            break; // aborted
+        }
+
+        if (StageStats::isEnabled())
+            m_stats.stageStats.encodeQueue.addSample((int64_t)m_encodeQueue.size());
+    }
+
+    // queue end of video
+    AVFrame *endOfVideo = NULL;
+    m_encodeQueue.push(endOfVideo, m_abort);
+}
+
+/**
+ * @brief: encode stage, encodes and writes frames to output video
+ */
+void TranscodePipeline::encodeStage()
+{
+    AVFrame *avFrame = NULL;
+
+    // loop until end of video
+    while (m_encodeQueue.pop(avFrame, m_abort) && avFrame)
+    {
+        // encode frame in encoder format
+        int size = m_videoEncoder->addNewFrame(avFrame);
+
+        // give frame back to its pool
+        FramePool::releaseFrame(avFrame);
+
+        // check if encoding was succesful, stop all stages otherwise
+        if (size < 0)
+        {
+            fprintf(stderr, "\x1b[31m" "TranscodePipeline:: Could not encode frame\n" "\x1b[0m");
+            m_abort = true;
+            break;
+        }
+
+        m_stats.encodedFrames++;
+    }
+}
@@ -0,0 +1,883 @@
+
+/**
+ * Description: TranscodeServer Class
+ *                  long running transcode daemon on a unix domain socket,
+ *                  jobs from local clients run on a pool of worker threads
+ */
+
+#include "TranscodeServer.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+extern "C" {
+    #include <libavutil/common.h>
+    #include <libavutil/time.h>
+}
+
+// max no of pending connections
+#define SERVER_BACKLOG 64
+
+// size of socket reads
+#define SERVER_READ_SIZE 4096
+
+// max length of one request line, longer requests are refused
+#define SERVER_MAX_LINE (64 * 1024)
+
+using namespace std;
+
+/**
+ * @brief: function to fill socket address of a path
+ *
+ * @params: socket path, address to fill
+ *
+ * @return: returns -1 if path is too long, 0 on success
+ */
+static int getSocketAddress(const string &socketPath, struct sockaddr_un &sockAddr)
+{
+    memset(&sockAddr, 0, sizeof(sockAddr));
+    sockAddr.sun_family = AF_UNIX;
+
+    if (socketPath.empty() || socketPath.size() >= sizeof(sockAddr.sun_path))
+    {
+        fprintf(stderr, "\x1b[31m" "TranscodeServer:: Invalid socket path: %s\n" "\x1b[0m",
+                                                                socketPath.c_str());
+        return -1; // return failure
+    }
+
+    strncpy(sockAddr.sun_path, socketPath.c_str(), sizeof(sockAddr.sun_path) - 1);
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to send all bytes of a buffer, socket takes partial
+ *          writes. closed peer fails the send instead of raising SIGPIPE
+ *
+ * @params: socket, bytes to send
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+static int sendAll(int fd, const string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t bytes = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+
+        if (bytes <= 0)
+            return -1; // return failure
+
+        sent += bytes;
+    }
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to split line into tab separated fields
+ *
+ * @params: line, fields to fill
+ */
+static void splitFields(const string &line, vector<string> &fields)
+{
+    fields.clear();
+
+    size_t start = 0;
+    while (start <= line.size())
+    {
+        size_t end = line.find('\t', start);
+        if (end == string::npos)
+            end = line.size();
+
+        if (end > start)
+            fields.push_back(line.substr(start, end - start));
+
+        start = end + 1;
+    }
+}
+
+/**
+ * @brief: function to check if a value can be sent in a request field
+ *
+ * @params: value
+ *
+ * @return: true if value has no tab or line break
+ */
+static bool isFieldValue(const string &value)
+{
+    return value.find_first_of("\t\r\n") == string::npos;
+}
+
+/**
+ * @brief: Parameterized constructor for ServerConnection
+ *
+ * @params: connected socket, owned by connection
+ */
+ServerConnection::ServerConnection(int connFd)
+{
+    fd = connFd;
+}
+
+/**
+ * @brief: destructor, closes socket
+ */
+ServerConnection::~ServerConnection()
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+/**
+ * @brief: function to send one reply line, replies of reader and workers
+ *          are not mixed
+ *
+ * @params: line without line break
+ *
+ * @return: returns -1 on failure (client gone), 0 on success
+ */
+int ServerConnection::sendLine(const string &line)
+{
+    lock_guard<mutex> lock(writeMutex);
+
+    return sendAll(fd, line + "\n");
+}
+
+/**
+ * @brief: Parameterized constructor for TranscodeServer
+ *
+ * @params: no of worker threads (0 = half of cpu cores)
+ */
+TranscodeServer::TranscodeServer(int workers)
+{
+    // at least one worker
+    int cores = FFMAX((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+    m_workers = workers > 0 ? workers : FFMAX(cores / 2, 1);
+
+    // not started
+    m_listenFd = -1;
+    m_running = false;
+    m_activeReaders = 0;
+
+    // job ids and counters
+    m_nextJobId = 1;
+    m_doneJobs = 0;
+    m_failedJobs = 0;
+}
+
+/**
+ * @brief: destructor, stops server if running
+ */
+TranscodeServer::~TranscodeServer()
+{
+    // function call to stop
+    stop();
+}
+
+/**
+ * @brief: function to listen on socket and start workers. ffmpeg is
+ *          initialized once here, so jobs do not pay startup costs
+ *
+ * @params: socket path, stale socket file is replaced, other files are not
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int TranscodeServer::start(const string &socketPath)
+{
+    if (m_listenFd >= 0)
+        return -1; // already started
+
+    // make ffmpeg safe to use from workers
+    if (Transcoder::initThreading() < 0)
+        return -1; // return failure
+
+    struct sockaddr_un sockAddr;
+    if (getSocketAddress(socketPath, sockAddr) < 0)
+        return -1; // return failure
+
+    // socket file of earlier run is removed, any other file is kept
+    struct stat fileStat;
+    if (lstat(socketPath.c_str(), &fileStat) == 0)
+    {
+        if (!S_ISSOCK(fileStat.st_mode))
+        {
+            fprintf(stderr, "\x1b[31m" "TranscodeServer:: %s exists and is not a socket\n" "\x1b[0m",
+                                                                socketPath.c_str());
+            return -1; // return failure
+        }
+
+        unlink(socketPath.c_str());
+    }
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listenFd < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "TranscodeServer:: Could not create socket: %s\n" "\x1b[0m",
+                                                                strerror(errno));
+        return -1; // return failure
+    }
+
+    if (bind(m_listenFd, (struct sockaddr *)&sockAddr, sizeof(sockAddr)) < 0 ||
+        listen(m_listenFd, SERVER_BACKLOG) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "TranscodeServer:: Could not listen on %s: %s\n" "\x1b[0m",
+                                                    socketPath.c_str(), strerror(errno));
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        return -1; // return failure
+    }
+
+    m_socketPath = socketPath;
+    m_running = true;
+
+    // start workers, they live as long as server
+    for (int i = 0; i < m_workers; i++)
+        m_workerThreads.push_back(thread(&TranscodeServer::runWorker, this));
+
+    fprintf(stderr, "\x1b[32m" "TranscodeServer:: Listening on %s with %d workers\n" "\x1b[0m",
+                                                    socketPath.c_str(), m_workers);
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to accept clients until stopped, every client is read
+ *          on its own thread
+ *
+ * @return: returns -1 on failure, 0 if stopped or interrupted by signal
+ */
+int TranscodeServer::run()
+{
+    while (m_running)
+    {
+        int connFd = accept(m_listenFd, NULL, NULL);
+        if (connFd < 0)
+        {
+            // signal, caller checks its stop condition
+            if (errno == EINTR)
+                return 0;
+
+            if (!m_running)
+                break;
+
+            if (errno == ECONNABORTED)
+                continue;
+
+            fprintf(stderr, "\x1b[31m" "TranscodeServer:: Could not accept client: %s\n" "\x1b[0m",
+                                                                    strerror(errno));
+            return -1; // return failure
+        }
+
+        shared_ptr<ServerConnection> connection(new ServerConnection(connFd));
+
+        {
+            lock_guard<mutex> lock(m_connMutex);
+
+            // forget closed connections
+            for (size_t i = 0; i < m_connections.size(); )
+            {
+                if (m_connections[i].expired())
+                {
+                    m_connections[i] = m_connections.back();
+                    m_connections.pop_back();
+                }
+                else
+                    i++;
+            }
+
+            m_connections.push_back(connection);
+            m_activeReaders++;
+        }
+
+        // reader is detached, stop waits for its count
+        thread(&TranscodeServer::runConnection, this, connection).detach();
+    }
+
+    return 0;
+}
+
+/**
+ * @brief: function to stop accepting clients. queued and running jobs are
+ *          finished and answered before workers stop
+ */
+void TranscodeServer::stop()
+{
+    if (m_listenFd < 0)
+        return;
+
+    // stop flag is set under queue lock, workers and readers check it
+    // under the same lock, so no wakeup is lost and no job is queued late
+    {
+        lock_guard<mutex> lock(m_queueMutex);
+        m_running = false;
+    }
+
+    // wake accept
+    shutdown(m_listenFd, SHUT_RDWR);
+
+    // wake readers, no more jobs are read
+    {
+        unique_lock<mutex> lock(m_connMutex);
+
+        for (size_t i = 0; i < m_connections.size(); i++)
+        {
+            shared_ptr<ServerConnection> connection = m_connections[i].lock();
+            if (connection)
+                shutdown(connection->fd, SHUT_RD);
+        }
+
+        m_connCond.wait(lock, [this]() { return m_activeReaders == 0; });
+        m_connections.clear();
+    }
+
+    // workers drain queue and stop
+    {
+        lock_guard<mutex> lock(m_queueMutex);
+        m_queueCond.notify_all();
+    }
+
+    for (size_t i = 0; i < m_workerThreads.size(); i++)
+        m_workerThreads[i].join();
+
+    m_workerThreads.clear();
+
+    ::close(m_listenFd);
+    m_listenFd = -1;
+    unlink(m_socketPath.c_str());
+
+    fprintf(stderr, "\x1b[32m" "TranscodeServer:: Stopped, %d jobs done, %d failed\n" "\x1b[0m",
+                                    m_doneJobs.load(), m_failedJobs.load());
+}
+
+/**
+ * @brief: connection thread, reads request lines of one client until it
+ *          closes its side or server stops. connection stays open till its
+ *          last job is answered
+ *
+ * @params: connection to read
+ */
+void TranscodeServer::runConnection(shared_ptr<ServerConnection> connection)
+{
+    string readBuffer;
+    char data[SERVER_READ_SIZE];
+
+    while (true)
+    {
+        ssize_t bytes = recv(connection->fd, data, sizeof(data), 0);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+
+        if (bytes <= 0)
+            break;
+
+        readBuffer.append(data, bytes);
+
+        // handle all complete lines
+        size_t pos;
+        while ((pos = readBuffer.find('\n')) != string::npos)
+        {
+            handleRequest(connection, readBuffer.substr(0, pos));
+            readBuffer.erase(0, pos + 1);
+        }
+
+        // line without end, client is not read any more
+        if (readBuffer.size() > SERVER_MAX_LINE)
+        {
+            fprintf(stderr, "\x1b[31m" "TranscodeServer:: Request too long, closing connection\n" "\x1b[0m");
+            connection->sendLine("ERROR request too long");
+            shutdown(connection->fd, SHUT_RD);
+            break;
+        }
+    }
+
+    // drop reference before stop is woken, socket closes with last job
+    connection.reset();
+
+    lock_guard<mutex> lock(m_connMutex);
+    m_activeReaders--;
+    m_connCond.notify_all();
+}
+
+/**
+ * @brief: function to parse one request line, queue its job and reply
+ *
+ * @params: connection of request, request line
+ */
+void TranscodeServer::handleRequest(const shared_ptr<ServerConnection> &connection,
+                                    const string &line)
+{
+    string request = line;
+    if (!request.empty() && request[request.size() - 1] == '\r')
+        request.erase(request.size() - 1);
+
+    if (request.empty())
+        return;
+
+    // status of server
+    if (request == "STATS")
+    {
+        size_t queuedJobs = 0;
+        {
+            lock_guard<mutex> lock(m_queueMutex);
+            queuedJobs = m_jobQueue.size();
+        }
+
+        connection->sendLine("STATS\tworkers=" + to_string(m_workers) + "\tqueued=" +
+                             to_string(queuedJobs) + "\tdone=" + to_string(m_doneJobs.load()) +
+                             "\tfailed=" + to_string(m_failedJobs.load()));
+        return;
+    }
+
+    if (request != "JOB" && request.compare(0, 4, "JOB\t") != 0)
+    {
+        connection->sendLine("ERROR unknown request");
+        return;
+    }
+
+    ServerJob serverJob;
+    if (parseJob(request.substr(3), serverJob.job) < 0)
+    {
+        connection->sendLine("ERROR invalid job");
+        return;
+    }
+
+    // stdin/stdout of daemon belong to no client
+    if (serverJob.job.inputFile == "-" || serverJob.job.outputFile == "-")
+    {
+        connection->sendLine("ERROR piped input/output not supported");
+        return;
+    }
+
+    // share cpu cores among workers, where threads are auto
+    int cores = FFMAX((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+    int threadsPerJob = FFMAX(cores / m_workers, 1);
+
+    if (serverJob.job.decoderContext.threadCount <= 0)
+        serverJob.job.decoderContext.threadCount = threadsPerJob;
+
+    if (serverJob.job.encoderContext.threadCount <= 0)
+        serverJob.job.encoderContext.threadCount = threadsPerJob;
+
+    serverJob.id = m_nextJobId++;
+    serverJob.connection = connection;
+
+    {
+        // replies are held, so job is accepted before a worker reports it
+        lock_guard<mutex> writeLock(connection->writeMutex);
+
+        // no new jobs once workers may have stopped
+        bool queued = false;
+        {
+            lock_guard<mutex> lock(m_queueMutex);
+            if (m_running)
+            {
+                m_jobQueue.push_back(serverJob);
+                queued = true;
+            }
+        }
+
+        if (!queued)
+        {
+            sendAll(connection->fd, "ERROR server stopping\n");
+            return;
+        }
+
+        sendAll(connection->fd, "ACCEPTED " + to_string(serverJob.id) + "\n");
+    }
+
+    m_queueCond.notify_one();
+}
+
+/**
+ * @brief: worker thread, runs queued jobs until server stops and queue
+ *          is empty
+ */
+void TranscodeServer::runWorker()
+{
+    while (true)
+    {
+        ServerJob serverJob;
+
+        {
+            unique_lock<mutex> lock(m_queueMutex);
+            m_queueCond.wait(lock, [this]() { return !m_jobQueue.empty() || !m_running; });
+
+            if (m_jobQueue.empty())
+                return;
+
+            serverJob = m_jobQueue.front();
+            m_jobQueue.pop_front();
+        }
+
+        serverJob.connection->sendLine("STARTED " + to_string(serverJob.id));
+
+        TranscodeResult result;
+        Transcoder::transcode(serverJob.job, result);
+
+        if (result.status == 0)
+            m_doneJobs++;
+        else
+            m_failedJobs++;
+
+        fprintf(stderr, "\x1b[32m" "TranscodeServer:: Job %d %s: %s\n" "\x1b[0m", serverJob.id,
+                result.status == 0 ? "done" : "failed", serverJob.job.inputFile.c_str());
+
+        char fields[128];
+        snprintf(fields, sizeof(fields), "\tstatus=%d\tframes=%d\ttime=%.3f", result.status,
+                                                    result.frames, result.elapsedTime);
+
+        // client may be gone, job is done anyway
+        serverJob.connection->sendLine("DONE " + to_string(serverJob.id) + fields);
+    }
+}
+
+/**
+ * @brief: function to write job as request line, tab separated key=value
+ *          fields of files and options
+ *
+ * @params: job
+ *
+ * @return: request line without line break, empty if a value can not be sent
+ */
+string TranscodeServer::formatJob(const TranscodeJob &job)
+{
+    const VideoEncoderContext &encCtx = job.encoderContext;
+    const VideoDecoderContext &decCtx = job.decoderContext;
+
+    if (!isFieldValue(job.inputFile) || !isFieldValue(job.outputFile) ||
+        !isFieldValue(encCtx.codecStr) || !isFieldValue(encCtx.containerFormat) ||
+        !isFieldValue(encCtx.preset) || !isFieldValue(encCtx.tune))
+        return "";
+
+    const char *rateControls[] = {"default", "cqp", "crf", "abr"};
+    const char *segmentFormats[] = {"none", "hls", "dash"};
+
+    char numbers[512];
+    snprintf(numbers, sizeof(numbers),
+             "\twidth=%d\theight=%d\tscale=%s\tfps=%d\tquality=%d\tthreads=%d"
+             "\trc=%s\tcrf=%d\tbitrate=%d\tgop=%d\tsegment=%s\tsegtime=%.3f"
+             "\tlowlatency=%d\tintrarefresh=%d\twritebuffer=%d"
+             "\tdthreads=%d\tdthreadtype=%d\tlowres=%d\treadahead=%d"
+             "\tpipeline=%d\tcopy=%d\tss=%.3f\tto=%.3f",
+             encCtx.width, encCtx.height, encCtx.scaleMode == SCALE_MODE_FIT ? "fit" : "stretch",
+             encCtx.frameRate, encCtx.quality, encCtx.threadCount,
+             rateControls[encCtx.rateControl], encCtx.crf, encCtx.bitRate, encCtx.gopSize,
+             segmentFormats[encCtx.segmentFormat], encCtx.segmentTime,
+             encCtx.lowLatency ? 1 : 0, encCtx.intraRefresh ? 1 : 0, encCtx.writeBufferSize,
+             decCtx.threadCount, decCtx.threadType, decCtx.lowres, decCtx.readaheadSize,
+             job.pipelineQueue, job.streamCopy, job.startTime, job.endTime);
+
+    return "JOB\tinput=" + job.inputFile + "\toutput=" + job.outputFile +
+           "\tcodec=" + encCtx.codecStr + "\tcontainer=" + encCtx.containerFormat +
+           "\tpreset=" + encCtx.preset + "\ttune=" + encCtx.tune + numbers;
+}
+
+/**
+ * @brief: function to parse request fields into job, missing options keep
+ *          their defaults
+ *
+ * @params: tab separated key=value fields, job to fill
+ *
+ * @return: returns -1 on unknown field or missing input/output, 0 on success
+ */
+int TranscodeServer::parseJob(const string &line, TranscodeJob &job)
+{
+    VideoEncoderContext &encCtx = job.encoderContext;
+    VideoDecoderContext &decCtx = job.decoderContext;
+
+    vector<string> fields;
+    splitFields(line, fields);
+
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+        size_t pos = fields[i].find('=');
+        if (pos == string::npos)
+            return -1; // return failure
+
+        string key = fields[i].substr(0, pos);
+        string value = fields[i].substr(pos + 1);
+        const char *str = value.c_str();
+
+        if (key == "input")
+            job.inputFile = value;
+        else if (key == "output")
+            job.outputFile = value;
+        else if (key == "codec")
+            encCtx.codecStr = value;
+        else if (key == "container")
+            encCtx.containerFormat = value;
+        else if (key == "preset")
+            encCtx.preset = value;
+        else if (key == "tune")
+            encCtx.tune = value;
+        else if (key == "width")
+            encCtx.width = atoi(str);
+        else if (key == "height")
+            encCtx.height = atoi(str);
+        else if (key == "scale")
+            encCtx.scaleMode = value == "fit" ? SCALE_MODE_FIT : SCALE_MODE_STRETCH;
+        else if (key == "fps")
+            encCtx.frameRate = atoi(str);
+        else if (key == "quality")
+            encCtx.quality = atoi(str);
+        else if (key == "threads")
+            encCtx.threadCount = atoi(str);
+        else if (key == "rc")
+        {
+            if (value == "cqp")
+                encCtx.rateControl = RATE_CONTROL_CQP;
+            else if (value == "crf")
+                encCtx.rateControl = RATE_CONTROL_CRF;
+            else if (value == "abr")
+                encCtx.rateControl = RATE_CONTROL_ABR;
+            else
+                encCtx.rateControl = RATE_CONTROL_DEFAULT;
+        }
+        else if (key == "crf")
+            encCtx.crf = atoi(str);
+        else if (key == "bitrate")
+            encCtx.bitRate = atoi(str);
+        else if (key == "gop")
+            encCtx.gopSize = atoi(str);
+        else if (key == "segment")
+        {
+            if (value == "hls")
+                encCtx.segmentFormat = SEGMENT_FORMAT_HLS;
+            else if (value == "dash")
+                encCtx.segmentFormat = SEGMENT_FORMAT_DASH;
+            else
+                encCtx.segmentFormat = SEGMENT_FORMAT_NONE;
+        }
+        else if (key == "segtime")
+            encCtx.segmentTime = atof(str);
+        else if (key == "lowlatency")
+            encCtx.lowLatency = atoi(str) != 0;
+        else if (key == "intrarefresh")
+            encCtx.intraRefresh = atoi(str) != 0;
+        else if (key == "writebuffer")
+            encCtx.writeBufferSize = atoi(str);
+        else if (key == "dthreads")
+            decCtx.threadCount = atoi(str);
+        else if (key == "dthreadtype")
+            decCtx.threadType = atoi(str);
+        else if (key == "lowres")
+            decCtx.lowres = atoi(str);
+        else if (key == "readahead")
+            decCtx.readaheadSize = atoi(str);
+        else if (key == "pipeline")
+            job.pipelineQueue = atoi(str);
+        else if (key == "copy")
+            job.streamCopy = atoi(str);
+        else if (key == "ss")
+            job.startTime = atof(str);
+        else if (key == "to")
+            job.endTime = atof(str);
+        else
+            return -1; // unknown field
+    }
+
+    if (job.inputFile.empty() || job.outputFile.empty())
+        return -1; // return failure
+
+    return 0; // return success
+}
+
+/**
+ * @brief: Default constructor for TranscodeClient
+ *          not connected
+ */
+TranscodeClient::TranscodeClient()
+{
+    m_fd = -1;
+}
+
+/**
+ * @brief: destructor, closes connection
+ */
+TranscodeClient::~TranscodeClient()
+{
+    // function call to close
+    close();
+}
+
+/**
+ * @brief: function to connect to server socket
+ *
+ * @params: socket path of server
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int TranscodeClient::connect(const string &socketPath)
+{
+    close();
+
+    struct sockaddr_un sockAddr;
+    if (getSocketAddress(socketPath, sockAddr) < 0)
+        return -1; // return failure
+
+    m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_fd < 0 || ::connect(m_fd, (struct sockaddr *)&sockAddr, sizeof(sockAddr)) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "TranscodeClient:: Could not connect to %s: %s\n" "\x1b[0m",
+                                                    socketPath.c_str(), strerror(errno));
+        close();
+        return -1; // return failure
+    }
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to close connection
+ */
+void TranscodeClient::close()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+
+    m_fd = -1;
+    m_readBuffer.clear();
+}
+
+/**
+ * @brief: function to send one job, server answers ACCEPTED or ERROR
+ *
+ * @params: job to send
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int TranscodeClient::submit(const TranscodeJob &job)
+{
+    string request = TranscodeServer::formatJob(job);
+    if (m_fd < 0 || request.empty())
+        return -1; // return failure
+
+    return sendAll(m_fd, request + "\n");
+}
+
+/**
+ * @brief: function to read next reply line of server
+ *
+ * @params: reply to fill, without line break
+ *
+ * @return: returns -1 if connection is closed, 0 on success
+ */
+int TranscodeClient::readReply(string &reply)
+{
+    if (m_fd < 0)
+        return -1; // return failure
+
+    size_t pos;
+    while ((pos = m_readBuffer.find('\n')) == string::npos)
+    {
+        char data[SERVER_READ_SIZE];
+        ssize_t bytes = recv(m_fd, data, sizeof(data), 0);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+
+        if (bytes <= 0)
+            return -1; // return failure
+
+        m_readBuffer.append(data, bytes);
+    }
+
+    reply = m_readBuffer.substr(0, pos);
+    m_readBuffer.erase(0, pos + 1);
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to run jobs on server and wait for all results. jobs
+ *          are sent at once, server runs them concurrently on its workers
+ *
+ * @params: jobs to run, results to fill in same order
+ *
+ * @return: returns no of failed jobs, -1 if server could not be reached
+ */
+int TranscodeClient::run(const vector<TranscodeJob> &jobs, vector<TranscodeResult> &results)
+{
+    results.assign(jobs.size(), TranscodeResult());
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        results[i].inputFile = jobs[i].inputFile;
+        results[i].outputFile = jobs[i].outputFile;
+    }
+
+    for (size_t i = 0; i < jobs.size(); i++)
+        if (submit(jobs[i]) < 0)
+            return -1; // return failure
+
+    // no more jobs, server closes connection after last answer
+    shutdown(m_fd, SHUT_WR);
+
+    // server job id to index of job, in order of ACCEPTED/ERROR replies
+    map<int, size_t> jobIndex;
+    size_t answeredJobs = 0;
+    size_t finishedJobs = 0;
+
+    string reply;
+    while (finishedJobs < jobs.size() && readReply(reply) == 0)
+    {
+        vector<string> fields;
+        splitFields(reply, fields);
+        if (fields.empty())
+            continue;
+
+        int jobId = atoi(fields[0].c_str() + fields[0].find(' ') + 1);
+
+        if (fields[0].compare(0, 8, "ACCEPTED") == 0)
+        {
+            jobIndex[jobId] = answeredJobs++;
+        }
+        else if (fields[0].compare(0, 5, "ERROR") == 0 && answeredJobs < jobs.size())
+        {
+            fprintf(stderr, "\x1b[31m" "TranscodeClient:: Job %s: %s\n" "\x1b[0m",
+                        jobs[answeredJobs].inputFile.c_str(), fields[0].c_str());
+            answeredJobs++;
+            finishedJobs++;
+        }
+        else if (fields[0].compare(0, 7, "STARTED") == 0 && jobIndex.count(jobId))
+        {
+            fprintf(stderr, "\x1b[33m" "TranscodeClient:: Job %d started: %s\n" "\x1b[0m",
+                        jobId, jobs[jobIndex[jobId]].inputFile.c_str());
+        }
+        else if (fields[0].compare(0, 4, "DONE") == 0 && jobIndex.count(jobId))
+        {
+            TranscodeResult &result = results[jobIndex[jobId]];
+
+            for (size_t i = 1; i < fields.size(); i++)
+            {
+                if (fields[i].compare(0, 7, "status=") == 0)
+                    result.status = atoi(fields[i].c_str() + 7);
+                else if (fields[i].compare(0, 7, "frames=") == 0)
+                    result.frames = atoi(fields[i].c_str() + 7);
+                else if (fields[i].compare(0, 5, "time=") == 0)
+                    result.elapsedTime = atof(fields[i].c_str() + 5);
+            }
+
+            fprintf(stderr, "\x1b[32m" "TranscodeClient:: Job %d %s: %s (%d frames, %.2f sec)\n"
+                            "\x1b[0m", jobId, result.status == 0 ? "done" : "failed",
+                            result.outputFile.c_str(), result.frames, result.elapsedTime);
+            finishedJobs++;
+        }
+    }
+
+    // count failed jobs, unanswered jobs failed
+    int failedJobs = 0;
+    for (size_t i = 0; i < results.size(); i++)
+        if (results[i].status != 0)
+            failedJobs++;
+
+    return failedJobs;
+}
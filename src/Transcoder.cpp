@@ -0,0 +1,637 @@
+
+/**
+ * Description: Transcoder Class
+ *                  transcode one input video into one output video
+ */
+
+#include "Transcoder.h"
+#include "TranscodePipeline.h"
+#include "FrameRateFilter.h"
+
+#include <mutex>
+#include <new>
+
+#include <sys/stat.h>
+
+extern "C" {
+    #include <libavutil/time.h>
+}
+
+using namespace std;
+
+/**
+ * @brief: lock manager for ffmpeg, guards codec open/close across threads
+ *
+ * @params: lock to operate on, lock operation
+ *
+ * @return: returns 1 on failure, 0 on success
+ */
+static int lockManager(void **lock, enum AVLockOp lockOp)
+{
+    switch (lockOp)
+    {
+        case AV_LOCK_CREATE:
+            *lock = new (std::nothrow) mutex;
+            return *lock ? 0 : 1;
+
+        case AV_LOCK_OBTAIN:
+            ((mutex *)*lock)->lock();
+            return 0;
+
+        case AV_LOCK_RELEASE:
+            ((mutex *)*lock)->unlock();
+            return 0;
+
+        case AV_LOCK_DESTROY:
+            delete (mutex *)*lock;
+            *lock = NULL;
+            return 0;
+    }
+
+    return 1; // unknown operation
+}
+
+/**
+ * @brief: function to estimate output size of a job, to reserve file space
+ *          for async writer. copied output is a part of input file, encoded
+ *          output is known only for average bit rate
+ *
+ * @params: opened input video, job, encoder context, true if packets are copied
+ *
+ * @return: expected output size (bytes), 0 if unknown
+ */
+static int64_t estimateOutputSize(VideoDecoder &videoDecoder, const TranscodeJob &job,
+                                  const VideoEncoderContext &encoderContext, bool streamCopy)
+{
+    VideoInfo videoInfo;
+    videoDecoder.getVideoInfo(videoInfo);
+
+    if (videoInfo.duration <= 0)
+        return 0;
+
+    // seconds of input in output
+    double endTime = job.endTime > 0 ? FFMIN(job.endTime, videoInfo.duration) : videoInfo.duration;
+    double duration = endTime - FFMAX(job.startTime, 0.0);
+    if (duration <= 0)
+        return 0;
+
+    // part of input file
+    if (streamCopy)
+    {
+        int64_t inputSize = (int64_t)job.inputSize;
+
+        struct stat fileStat;
+        if (!job.inputData)
+            inputSize = stat(job.inputFile.c_str(), &fileStat) == 0 ? (int64_t)fileStat.st_size : 0;
+
+        return (int64_t)(inputSize * FFMIN(duration / videoInfo.duration, 1.0));
+    }
+
+    // average bit rate, with some container overhead
+    if (encoderContext.rateControl == RATE_CONTROL_ABR && encoderContext.bitRate > 0)
+        return (int64_t)(encoderContext.bitRate / 8.0 * duration * 1.02);
+
+    return 0;
+}
+
+/**
+ * @brief: function to set memory input of a job, if any
+ *
+ * @params: job, decoder to set
+ */
+static void setMemoryInput(const TranscodeJob &job, VideoDecoder &videoDecoder)
+{
+    if (job.inputData)
+        videoDecoder.setInputBuffer(job.inputData, job.inputSize);
+    else if (job.inputCallback)
+        videoDecoder.setInputCallback(job.inputCallback);
+}
+
+/**
+ * @brief: function to set memory output of a job, if any
+ *
+ * @params: job, encoder to set
+ */
+static void setMemoryOutput(const TranscodeJob &job, VideoEncoder &videoEncoder)
+{
+    if (job.outputBuffer)
+        videoEncoder.setOutputBuffer(job.outputBuffer);
+    else if (job.outputCallback)
+        videoEncoder.setOutputCallback(job.outputCallback);
+}
+
+/**
+ * @brief: function to check if input codec is one of output video format.
+ *          output format names a family, encoder picks one codec of it, so
+ *          encoder codec id is not used here
+ *
+ * @params: codec id of input, output video format (H264 or MPEG-4)
+ *
+ * @return: true if input codec belongs to output format
+ */
+static bool isFormatCodec(int codecId, const string &codecStr)
+{
+    if (codecStr == "H264")
+        return codecId == CODEC_ID_H264;
+    else if (codecStr == "MPEG-4")
+        return codecId == CODEC_ID_MPEG4 || codecId == CODEC_ID_MSMPEG4V2;
+
+    return false;
+}
+
+/**
+ * @brief: function to make ffmpeg safe to use from many threads,
+ *          must be called before any decoder/encoder is created on a worker
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int Transcoder::initThreading()
+{
+    static once_flag initFlag;
+    static int initStatus = 0;
+
+    // initialize only once, any later call returns first status
+    call_once(initFlag, []()
+    {
+        // register all the resources required from ffmpeg
+        av_register_all();
+
+        // register lock manager
+        if (av_lockmgr_register(lockManager) != 0)
+        {
+            fprintf(stderr, "\x1b[31m" "Transcoder:: Could not register lock manager\n" "\x1b[0m");
+            initStatus = -1; // return failure
+        }
+    });
+
+    return initStatus;
+}
+
+/**
+ * @brief: function to open input video and resolve output size and frame
+ *          rate from it. if output is smaller than input and codec supports
+ *          it, video is reopened to decode at reduced resolution, so the
+ *          downscale is mostly done by the decoder
+ *
+ * @params: decoder to open, input filename, decoder options,
+ *          output options, width/height/frameRate are filled
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int Transcoder::openInput(VideoDecoder &videoDecoder, const string &inputFile,
+                          VideoDecoderContext decoderContext, VideoEncoderContext &encoderContext)
+{
+    // open at full size
+    int lowres = decoderContext.lowres;
+    decoderContext.lowres = 0;
+    videoDecoder.setDecoderContext(decoderContext);
+
+    if (videoDecoder.openVideo(inputFile) < 0)
+        return -1; // return failure
+
+    // get input video info
+    VideoInfo videoInfo;
+    videoDecoder.getVideoInfo(videoInfo);
+
+    // output size, input size if not given
+    int outWidth = 0, outHeight = 0;
+    VideoEncoder::getOutputSize(encoderContext, videoInfo.width, videoInfo.height, 
+                                                            outWidth, outHeight);
+    encoderContext.width = outWidth;
+    encoderContext.height = outHeight;
+
+    // output frame rate, input frame rate if not given
+    if (encoderContext.frameRate <= 0)
+        encoderContext.frameRate = videoInfo.frameRate > 0 ? videoInfo.frameRate : 15;
+
+    // decode at reduced size, if output is small enough and not set by caller
+    if (lowres <= 0 && videoDecoder.getMaxLowres() > 0)
+        lowres = VideoDecoder::getLowresForSize(videoInfo.width, videoInfo.height, 
+                                                            outWidth, outHeight);
+
+    // streamed input can not be reopened
+    if (lowres > 0 && videoDecoder.getMaxLowres() > 0 && videoDecoder.canReopen())
+    {
+        videoDecoder.closeVideo();
+
+        decoderContext.lowres = lowres;
+        videoDecoder.setDecoderContext(decoderContext);
+
+        if (videoDecoder.openVideo(inputFile) < 0)
+            return -1; // return failure
+    }
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to run one transcoding job
+ *
+ * @params: job to run, result to fill
+ *
+ * @return: returns -1 on failure, no of encoded frames on success
+ */
+int Transcoder::transcode(const TranscodeJob &job, TranscodeResult &result)
+{
+    // job start time
+    int64_t startTime = av_gettime_relative();
+
+    // fill job files
+    result.inputFile = job.inputFile;
+    result.outputFile = job.outputFile;
+    result.status = -1;
+    result.frames = 0;
+
+    // set encoder context, size and frame rate are resolved from input
+    VideoEncoderContext encoderContext = job.encoderContext;
+    encoderContext.outputVideoFile = job.outputFile;
+
+    // open video for decoding
+    VideoDecoder videoDecoder;
+    setMemoryInput(job, videoDecoder);
+
+    if (openInput(videoDecoder, job.inputFile, job.decoderContext, encoderContext) < 0)
+    {
+        result.elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+        return -1; // return failure
+    }
+
+    // input already matches output, copy packets instead. input is opened
+    // again, so streamed input is always re-encoded
+    if (videoDecoder.canReopen() && canRemux(videoDecoder, encoderContext, job.streamCopy))
+    {
+        videoDecoder.closeVideo();
+        return remux(job, result);
+    }
+
+    // transcode range of video only, frame accurate
+    if (job.startTime > 0 && videoDecoder.seek(job.startTime) < 0)
+    {
+        videoDecoder.closeVideo();
+        result.elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+        return -1; // return failure
+    }
+
+    videoDecoder.setEndTime(job.endTime);
+
+    // reserve output file space for async writer
+    if (encoderContext.writeBufferSize > 0 && encoderContext.preallocSize <= 0)
+        encoderContext.preallocSize = estimateOutputSize(videoDecoder, job, encoderContext, false);
+
+    // start video encoding
+    VideoEncoder videoEncoder(encoderContext);
+    setMemoryOutput(job, videoEncoder);
+
+    if (videoEncoder.startVideoEncode() < 0)
+    {
+        videoDecoder.closeVideo();
+        result.elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+        return -1; // return failure
+    }
+
+    int frames = 0;
+
+    // stats of pipeline stages and queues
+    result.stats.reset();
+
+    // decode, convert and encode on separate threads
+    if (job.pipelineQueue > 0)
+    {
+        TranscodePipeline pipeline(videoDecoder, videoEncoder, job.pipelineQueue);
+        frames = pipeline.run();
+        result.stats.add(pipeline.getStats().stageStats);
+    }
+    else
+    {
+        // decoded frame, references decoder planes
+        AVFrame *decodedFrame = av_frame_alloc();
+
+        // selects decoded frames for output frame rate
+        FrameRateFilter frameRateFilter;
+        frameRateFilter.init(videoDecoder, encoderContext.frameRate);
+
+        // get a new frame from the video, in decoder pixel format
+        while (decodedFrame && videoDecoder.getNewFrame(decodedFrame) > 0)
+        {
+            // no of output frames, dropped frames are not converted
+            int copies = frameRateFilter.filterFrame(
+                                av_frame_get_best_effort_timestamp(decodedFrame));
+
+            // add frame to output video, converted only if needed
+            int size = 0;
+            for (int copy = 0; copy < copies && size >= 0; copy++)
+                size = videoEncoder.addNewFrame(decodedFrame);
+
+            // release decoded frame
+            av_frame_unref(decodedFrame);
+
+            // check if encoding was succesful
+            if (size < 0)
+            {
+                frames = -1;
+                break;
+            }
+
+            frames += copies;
+        }
+
+        av_frame_free(&decodedFrame);
+    }
+
+    // stop video encoding and decoding
+    videoEncoder.stopVideoEncode();
+
+    result.stats.add(videoDecoder.getStats());
+    result.stats.add(videoEncoder.getStats());
+
+    videoDecoder.closeVideo();
+
+    // fill job result
+    result.status = frames < 0 ? -1 : 0;
+    result.frames = frames < 0 ? 0 : frames;
+    result.elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+
+    return frames;
+}
+
+/**
+ * @brief: function to check if encode options of output differ from
+ *          defaults, a copy would silently ignore them
+ *
+ * @params: output video options
+ *
+ * @return: true if any encode option is given
+ */
+static bool hasEncodeOptions(const VideoEncoderContext &encoderContext)
+{
+    VideoEncoderContext defaultContext;
+
+    return encoderContext.quality != defaultContext.quality ||
+           encoderContext.preset != defaultContext.preset ||
+           encoderContext.tune != defaultContext.tune ||
+           encoderContext.rateControl != defaultContext.rateControl ||
+           encoderContext.crf != defaultContext.crf ||
+           encoderContext.bitRate != defaultContext.bitRate ||
+           encoderContext.gopSize != defaultContext.gopSize ||
+           encoderContext.segmentFormat != defaultContext.segmentFormat ||
+           encoderContext.lowLatency != defaultContext.lowLatency ||
+           encoderContext.intraRefresh != defaultContext.intraRefresh;
+}
+
+/**
+ * @brief: function to check if opened input can be written to output
+ *          without re-encoding. codec must match output format, size and
+ *          frame rate must match if given, and bitstream must be valid for
+ *          output container. in auto mode encode options must not be given
+ *
+ * @params: opened video decoder, output video options, stream copy mode
+ *
+ * @return: true if packets can be copied, false otherwise
+ */
+bool Transcoder::canRemux(VideoDecoder &videoDecoder, const VideoEncoderContext &encoderContext,
+                          int streamCopy)
+{
+    // re-encode if asked to, or if encode options would be ignored
+    if (streamCopy == STREAM_COPY_NONE ||
+        (streamCopy == STREAM_COPY_AUTO && hasEncodeOptions(encoderContext)))
+        return false;
+
+    AVStream *avStream = videoDecoder.getVideoStream();
+    if (!avStream)
+        return false;
+
+    AVCodecContext *avCodecCtx = avStream->codec;
+
+    // codec of input must be codec of output format, MPEG-4 part 2 too
+    if (!isFormatCodec(avCodecCtx->codec_id, encoderContext.codecStr))
+        return false;
+
+    VideoInfo videoInfo;
+    if (videoDecoder.getVideoInfo(videoInfo) < 0)
+        return false;
+
+    // requested size must be input size
+    int outWidth = 0, outHeight = 0;
+    VideoEncoder::getOutputSize(encoderContext, videoInfo.width, videoInfo.height, 
+                                                            outWidth, outHeight);
+    if (outWidth != videoInfo.width || outHeight != videoInfo.height)
+        return false;
+
+    // requested frame rate must be input frame rate
+    if (encoderContext.frameRate > 0 && encoderContext.frameRate != videoInfo.frameRate)
+        return false;
+
+    // H264 in mp4 style (avcC) can only go to containers with global header,
+    // container is found as encoder finds it, -fmt wins over file extension
+    AVOutputFormat *avOutFmt = VideoEncoder::guessOutputFormat(encoderContext,
+                                            encoderContext.outputVideoFile.c_str());
+    if (!avOutFmt)
+        return false;
+
+    if (avCodecCtx->codec_id == CODEC_ID_H264 && avCodecCtx->extradata_size > 0 &&
+        avCodecCtx->extradata[0] == 1 && !(avOutFmt->flags & AVFMT_GLOBALHEADER))
+        return false;
+
+    return true;
+}
+
+/**
+ * @brief: function to run one job by copying packets of input video stream
+ *          to output container, timestamps are rescaled to output stream.
+ *          a range starts at keyframe at or before start time, packets
+ *          can not be cut between keyframes
+ *
+ * @params: job to run, result to fill
+ *
+ * @return: returns -1 on failure, no of copied packets on success
+ */
+int Transcoder::remux(const TranscodeJob &job, TranscodeResult &result)
+{
+    // job start time
+    int64_t startTime = av_gettime_relative();
+
+    // fill job files
+    result.inputFile = job.inputFile;
+    result.outputFile = job.outputFile;
+    result.status = -1;
+    result.frames = 0;
+
+    // open video, packets are read without decoding
+    VideoDecoder videoDecoder;
+    VideoDecoderContext decoderContext = job.decoderContext;
+    decoderContext.threadCount = 1;
+    videoDecoder.setDecoderContext(decoderContext);
+    setMemoryInput(job, videoDecoder);
+
+    if (videoDecoder.openVideo(job.inputFile) < 0)
+    {
+        result.elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+        return -1; // return failure
+    }
+
+    AVStream *avStream = videoDecoder.getVideoStream();
+
+    // start output video with codec parameters of input
+    VideoEncoderContext encoderContext = job.encoderContext;
+    encoderContext.outputVideoFile = job.outputFile;
+
+    // reserve output file space for async writer
+    if (encoderContext.writeBufferSize > 0 && encoderContext.preallocSize <= 0)
+        encoderContext.preallocSize = estimateOutputSize(videoDecoder, job, encoderContext, true);
+
+    VideoEncoder videoEncoder(encoderContext);
+    setMemoryOutput(job, videoEncoder);
+
+    if (videoEncoder.startStreamCopy(avStream) < 0)
+    {
+        videoDecoder.closeVideo();
+        result.elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+        return -1; // return failure
+    }
+
+    fprintf(stderr, "\x1b[32m" "Transcoder:: Copying %s without re-encoding\n" "\x1b[0m",
+                                                                    job.inputFile.c_str());
+
+    // copy from keyframe at or before start time, packets can not be cut
+    if (job.startTime > 0 && videoDecoder.seekToKeyFrame(videoDecoder.getTimestamp(job.startTime)) < 0)
+    {
+        videoEncoder.stopVideoEncode();
+        videoDecoder.closeVideo();
+        result.elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+        return -1; // return failure
+    }
+
+    // packets from end time on are not copied
+    int64_t endPts = job.endTime > 0 ? videoDecoder.getTimestamp(job.endTime) : AV_NOPTS_VALUE;
+
+    // output starts at 0, from start of stream or from first copied packet
+    int64_t startPts = AV_NOPTS_VALUE;
+    if (job.startTime <= 0)
+        startPts = avStream->start_time != AV_NOPTS_VALUE ? avStream->start_time : 0;
+
+    AVPacket avPkt;
+    av_init_packet(&avPkt);
+    avPkt.data = NULL;
+    avPkt.size = 0;
+
+    // copy all packets of video stream
+    int packets = 0;
+    while (videoDecoder.readPacket(&avPkt) >= 0)
+    {
+        // end of range
+        if (endPts != AV_NOPTS_VALUE && avPkt.pts != AV_NOPTS_VALUE && avPkt.pts >= endPts)
+        {
+            av_free_packet(&avPkt);
+            break;
+        }
+
+        // first packet after seek is a keyframe, its dts is the earliest timestamp
+        if (startPts == AV_NOPTS_VALUE)
+            startPts = avPkt.dts != AV_NOPTS_VALUE ? avPkt.dts : 
+                       avPkt.pts != AV_NOPTS_VALUE ? avPkt.pts : 0;
+
+        if (avPkt.pts != AV_NOPTS_VALUE)
+            avPkt.pts -= startPts;
+
+        if (avPkt.dts != AV_NOPTS_VALUE)
+            avPkt.dts -= startPts;
+
+        int retStatus = videoEncoder.addPacket(&avPkt, avStream->time_base);
+
+        av_free_packet(&avPkt);
+
+        if (retStatus < 0)
+        {
+            packets = -1;
+            break;
+        }
+
+        packets++;
+    }
+
+    // stop output video and input video
+    videoEncoder.stopVideoEncode();
+
+    result.stats = videoDecoder.getStats();
+    result.stats.add(videoEncoder.getStats());
+
+    videoDecoder.closeVideo();
+
+    // fill job result
+    result.status = packets < 0 ? -1 : 0;
+    result.frames = packets < 0 ? 0 : packets;
+    result.elapsedTime = (av_gettime_relative() - startTime) / 1000000.0;
+
+    return packets;
+}
+
+/**
+ * @brief: function to write a json string, quotes, backslashes and control
+ *          characters are escaped
+ *
+ * @params: output file, string to write
+ */
+static void writeJsonString(FILE *jsonFp, const string &str)
+{
+    fputc('"', jsonFp);
+
+    for (size_t i = 0; i < str.size(); i++)
+    {
+        unsigned char c = (unsigned char)str[i];
+
+        if (c == '"' || c == '\\')
+            fprintf(jsonFp, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(jsonFp, "\\u%04x", c);
+        else
+            fputc(c, jsonFp);
+    }
+
+    fputc('"', jsonFp);
+}
+
+/**
+ * @brief: function to write results of jobs as json report, one object per
+ *          job with its stage stats
+ *
+ * @params: report filename, "-" = stdout, results of jobs
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int Transcoder::writeReport(const string &reportFile, const vector<TranscodeResult> &results)
+{
+    FILE *jsonFp = reportFile == "-" ? stdout : fopen(reportFile.c_str(), "w");
+    if (!jsonFp)
+    {
+        fprintf(stderr, "\x1b[31m" "Transcoder:: Could not open file: %s\n" "\x1b[0m",
+                                                                    reportFile.c_str());
+        return -1; // return failure
+    }
+
+    fprintf(jsonFp, "{\n  \"jobs\": [\n");
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const TranscodeResult &result = results[i];
+
+        fprintf(jsonFp, "    {\n      \"input\": ");
+        writeJsonString(jsonFp, result.inputFile);
+        fprintf(jsonFp, ",\n      \"output\": ");
+        writeJsonString(jsonFp, result.outputFile);
+        fprintf(jsonFp, ",\n      \"status\": \"%s\",\n      \"frames\": %d,\n"
+                        "      \"elapsed_sec\": %.3f,\n      \"fps\": %.2f,\n      \"stats\": ",
+                        result.status == 0 ? "ok" : "failed", result.frames, result.elapsedTime,
+                        result.elapsedTime > 0 ? result.frames / result.elapsedTime : 0.0);
+
+        result.stats.writeJson(jsonFp, "        ");
+
+        fprintf(jsonFp, "\n    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(jsonFp, "  ]\n}\n");
+
+    if (jsonFp != stdout)
+        fclose(jsonFp);
+
+    return 0; // return success
+}
@@ -10,6 +10,15 @@
 
 #include "VideoDecoder.h"
 
+extern "C" {
+    #include <libavutil/imgutils.h>
+}
+
+#include <unistd.h>
+
+// max no of decoding threads chosen automatically
+#define MAX_AUTO_THREADS 16
+
 using namespace std;
 
 /**
@@ -49,7 +58,11 @@ VideoDecoder::~VideoDecoder()
     // free frames if any
     if (m_avFrame)
     {
+#ifdef FFMPEG_2_7_6
+        av_frame_free(&m_avFrame);
+#else
         av_free(m_avFrame);
+#endif
         m_avFrame = NULL;
     }
 
@@ -72,6 +85,20 @@ int VideoDecoder::getVideoInfo(VideoInfo &videoInfo)
 
     // fill input vidio height
     videoInfo.height = m_height;
+
+    // check if video was opened
+    if (m_avStream == NULL)
+        return -1; // return failure
+
+    // fill input video codec name
+    videoInfo.videoCodecName = m_avCodec ? m_avCodec->name : "none";
+
+    // fill total frames, frame rate and duration
+    videoInfo.totalFrame = m_totalFrames;
+    videoInfo.frameRate = m_frameRate;
+    videoInfo.duration = m_totalDuration > 0 ? (double)m_totalDuration / AV_TIME_BASE : 0.0;
+
+    return 0; // return success
 }
 
 /**
@@ -94,63 +121,596 @@ int VideoDecoder::getNewFrame(unsigned char *frameArray)
         m_avFrameRGB.data[0] = (unsigned char *)frameArray;
         m_avFrameRGB.linesize[0] = m_width * 3;
 
-        // initialize swsScale struct for rgb conversion
-        struct SwsContext *swsContext = sws_getContext(m_width, m_height,
-                           m_avStream->codec->pix_fmt, m_width, m_height,
-                           PIX_FMT_RGB24, SWS_BICUBIC, NULL, NULL, NULL);
-
-        // if initalization was success
-        if (!swsContext)
-            return -1; // initialization failed
-
-        // input format to rgb24 conversion
-        sws_scale(swsContext, m_avFrame->data, m_avFrame->linesize, 0,
-                    m_avStream->codec->height, m_avFrameRGB.data, m_avFrameRGB.linesize);
-       
-        // free swscontext 
-        if (swsContext)
-           sws_freeContext(swsContext);
+        // input format to rgb24 conversion, using cached scale context
+        int64_t stageStart = StageStats::start();
+        if (m_frameConverter.convert(m_avFrame->data, m_avFrame->linesize, m_avFrame->width,
+                    m_avFrame->height, (::PixelFormat)m_avFrame->format,
+                    m_avFrameRGB.data, m_avFrameRGB.linesize,
+                    m_width, m_height, PIX_FMT_RGB24) < 0)
+            return -1; // conversion failed
+
+        m_stats.stages[STAGE_CONVERT].stop(stageStart);
     }
 
-    // return read frame size
-    return m_avPkt.size;
+    // return decoded frame size, packet may be empty for delayed frames
+    return avpicture_get_size(m_avCodecCtx->pix_fmt, m_width, m_height);
 }
 
+#ifdef FFMPEG_2_7_6
 /**
- * @brief: function to read and decode frame
+ * @brief: function to fetch a new frame from the video, without conversion
+ *          the frame references the decoder planes in decoder pixel format,
+ *          caller must av_frame_unref() it once done
  *
- * @params: none
+ * @params: frame to reference decoded planes
  *
- * @return: return -1 on failure, 0 on success 
+ * @return: returns -1 on failure, frame size on success
  */
-int VideoDecoder::readAndDecodeFrame()
+int VideoDecoder::getNewFrame(AVFrame *avFrame)
+{
+    // check for valid frame pointer
+    if (!avFrame)
+        return -1; // invalid frame
+
+    // function call to read and decoded frame
+    if (readAndDecodeFrame() < 0)
+        return -1; // read and decode failed
+
+    // keep caller's opaque, frame may belong to a frame pool
+    void *opaque = avFrame->opaque;
+
+    // reference decoded planes, no copy of pixel data
+    int refStatus = av_frame_ref(avFrame, m_avFrame);
+
+    // restore caller's opaque
+    avFrame->opaque = opaque;
+
+    // check if reference was success
+    if (refStatus < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoDecoder:: Could not reference frame\n" "\x1b[0m");
+        return -1; // reference failed
+    }
+
+    // return decoded frame size, packet may be empty for delayed frames
+    return avpicture_get_size(m_avCodecCtx->pix_fmt, m_width, m_height);
+}
+
+/**
+ * @brief: function to fetch a new frame from the video into a pooled frame,
+ *          frame is copied if pixel format matches, else converted.
+ *          caller must FramePool::releaseFrame() it once done
+ *
+ * @params: pixel format of pooled frame, PIX_FMT_NONE = decoder format
+ *
+ * @return: pooled frame on success, NULL on failure
+ */
+AVFrame* VideoDecoder::getNewPooledFrame(PixelFormat pixFmt)
+{
+    // function call to read and decoded frame
+    if (readAndDecodeFrame() < 0)
+        return NULL; // read and decode failed
+
+    // use decoder pixel format if not given
+    if (pixFmt == PIX_FMT_NONE)
+        pixFmt = (::PixelFormat)m_avFrame->format;
+
+    // initialize pool for video geometry, if changed
+    if (!m_framePool.matches(pixFmt, m_width, m_height))
+    {
+        if (m_framePool.init(pixFmt, m_width, m_height) < 0)
+            return NULL; // pool initialization failed
+    }
+
+    // fetch a recycled frame from pool
+    AVFrame *avFrame = m_framePool.getFrame();
+
+    // check if frame was fetched
+    if (!avFrame)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoDecoder:: Could not fetch pooled frame\n" "\x1b[0m");
+        return NULL; // return failure
+    }
+
+    int64_t stageStart = StageStats::start();
+
+    // same format and size, plain copy of planes
+    if (m_avFrame->format == pixFmt && m_avFrame->width == m_width && 
+                                       m_avFrame->height == m_height)
+    {
+        av_image_copy(avFrame->data, avFrame->linesize, (const uint8_t **)m_avFrame->data,
+                      m_avFrame->linesize, pixFmt, m_width, m_height);
+    }
+    // convert to required format, using cached scale context
+    else if (m_frameConverter.convert(m_avFrame->data, m_avFrame->linesize, m_avFrame->width,
+                    m_avFrame->height, (::PixelFormat)m_avFrame->format, avFrame->data,
+                    avFrame->linesize, m_width, m_height, pixFmt) < 0)
+    {
+        FramePool::releaseFrame(avFrame);
+        return NULL; // conversion failed
+    }
+
+    m_stats.stages[STAGE_CONVERT].stop(stageStart);
+
+    // copy frame properties
+    avFrame->pts = av_frame_get_best_effort_timestamp(m_avFrame);
+    avFrame->pkt_dts = m_avFrame->pkt_dts;
+    avFrame->key_frame = m_avFrame->key_frame;
+    avFrame->pict_type = m_avFrame->pict_type;
+
+    return avFrame;
+}
+
+/**
+ * @brief: function to fetch the frame at a time of the video. video is
+ *          seeked to keyframe at or before the time, only keyframes are
+ *          decoded if keyframe is enough, otherwise frames are decoded
+ *          until the time is reached
+ *
+ * @params: time from start of video (seconds), frame to reference decoded
+ *          planes, true to return keyframe before time (much faster)
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int VideoDecoder::getFrameAt(double seconds, AVFrame *avFrame, bool keyFrameOnly)
+{
+    // check for valid stream and frame
+    if (m_avStream == NULL || avFrame == NULL)
+        return -1; // return failure
+
+    // time in stream time base
+    int64_t ts = getTimestamp(seconds);
+
+    // seek to keyframe at or before time
+    if (seekToKeyFrame(ts) < 0)
+        return -1; // return failure
+
+    // decode keyframes only
+    enum AVDiscard skipFrame = m_avCodecCtx->skip_frame;
+    if (keyFrameOnly)
+        m_avCodecCtx->skip_frame = AVDISCARD_NONKEY;
+
+    int retStatus = -1;
+
+    // decode until frame at time
+    while (getNewFrame(avFrame) > 0)
+    {
+        int64_t pts = av_frame_get_best_effort_timestamp(avFrame);
+        if (keyFrameOnly || pts == AV_NOPTS_VALUE || pts >= ts)
+        {
+            retStatus = 0;
+            break;
+        }
+
+        av_frame_unref(avFrame);
+    }
+
+    // restore decoding of all frames
+    m_avCodecCtx->skip_frame = skipFrame;
+
+    return retStatus;
+}
+#endif
+
+/**
+ * @brief: function to fetch average conversion time per frame
+ *
+ * @return: time in micro seconds
+ */
+double VideoDecoder::getAvgConvertTime()
+{
+    return m_frameConverter.getAvgConvertTime();
+}
+
+/**
+ * @brief: function to find all keyframes of video stream. keyframes come
+ *          from keyframe index if loaded, else packets are read without
+ *          decoding and video is rewound to start once done
+ *
+ * @params: vector to fill keyframes, in file order
+ *
+ * @return: returns -1 on failure, no of keyframes on success
+ */
+int VideoDecoder::probeKeyFrames(vector<KeyFrameInfo> &keyFrames)
 {
     // check for valid stream 
     if (m_avStream == NULL)
         return -1; // return failure
 
-    // check for valid frame data and free if already filled
-    if (m_avPkt.data != NULL)
+    // keyframes from index, video is not read
+    if (m_keyFrameIndex.isLoaded())
+        return m_keyFrameIndex.getKeyFrames(keyFrames);
+
+    keyFrames.clear();
+
+    // packet to read
+    AVPacket avPkt;
+    av_init_packet(&avPkt);
+    avPkt.data = NULL;
+    avPkt.size = 0;
+
+    // no of video packets read
+    int frameNumber = 0;
+
+    // loop for all packets, no decoding
+    while (av_read_frame(m_avFmtCtx, &avPkt) >= 0)
     {
+        // check for video stream
+        if (avPkt.stream_index == m_streamIndex)
+        {
+            // record keyframe
+            if (avPkt.flags & AV_PKT_FLAG_KEY)
+            {
+                KeyFrameInfo keyFrame;
+                keyFrame.pts = avPkt.pts != AV_NOPTS_VALUE ? avPkt.pts : avPkt.dts;
+                keyFrame.pos = avPkt.pos;
+                keyFrame.frameNumber = frameNumber;
+                keyFrames.push_back(keyFrame);
+            }
+
+            frameNumber++;
+        }
+
         // free packet
+        av_free_packet(&avPkt);
+    }
+
+    // set total no of frames, if not known from header
+    if (m_totalFrames <= 0)
+        m_totalFrames = frameNumber;
+
+    // rewind to start of video
+    int64_t startPts = keyFrames.empty() ? 0 : keyFrames[0].pts;
+    if (seekToKeyFrame(startPts) < 0)
+        return -1; // return failure
+
+    return (int)keyFrames.size();
+}
+
+/**
+ * @brief: function to seek to keyframe at or before the given timestamp.
+ *          with a keyframe index, containers that would search by reading
+ *          are seeked straight to byte position of keyframe. frames delayed
+ *          in decoder are dropped
+ *
+ * @params: timestamp, in stream time base
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int VideoDecoder::seekToKeyFrame(int64_t pts)
+{
+    // check for valid stream 
+    if (m_avStream == NULL)
+        return -1; // return failure
+
+    int seekStatus = -1;
+
+    // keyframe from index
+    KeyFrameInfo keyFrame;
+    if (m_keyFrameIndex.findKeyFrame(pts, keyFrame) >= 0)
+    {
+        // byte seek, only where demuxer keeps no index of its own
+        if (keyFrame.pos >= 0 && m_avStream->nb_index_entries == 0 &&
+            !(m_avFmtCtx->iformat->flags & AVFMT_NO_BYTE_SEEK))
+            seekStatus = av_seek_frame(m_avFmtCtx, m_streamIndex, keyFrame.pos, AVSEEK_FLAG_BYTE);
+
+        // exact timestamp of keyframe
+        pts = keyFrame.pts;
+    }
+
+    // seek to keyframe at or before timestamp
+    if (seekStatus < 0 && av_seek_frame(m_avFmtCtx, m_streamIndex, pts, AVSEEK_FLAG_BACKWARD) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoDecoder:: Could not seek to %lld\n" "\x1b[0m", 
+                                                                (long long)pts);
+        return -1; // return failure
+    }
+
+    // drop frames delayed in decoder
+    avcodec_flush_buffers(m_avCodecCtx);
+
+    // free packet if any
+    if (m_avPkt.data)
+    {
         av_free_packet(&m_avPkt);
         m_avPkt.data = NULL;
     }
 
+#ifdef FFMPEG_2_7_6
+    // release decoded frame
+    av_frame_unref(m_avFrame);
+#endif
+
+    // packets can be read again
+    m_endOfVideo = 0;
+
+    // frames from keyframe on are returned
+    m_rangeStartTs = AV_NOPTS_VALUE;
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to seek to a time of the video, frame accurate. video
+ *          is seeked to keyframe at or before the time, frames before the
+ *          time are decoded but not returned
+ *
+ * @params: time from start of video (seconds)
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int VideoDecoder::seek(double seconds)
+{
+    // check for valid stream 
+    if (m_avStream == NULL)
+        return -1; // return failure
+
+    int64_t ts = getTimestamp(seconds);
+
+    // seek to keyframe at or before time
+    if (seekToKeyFrame(ts) < 0)
+        return -1; // return failure
+
+    // skip frames before time
+    m_rangeStartTs = ts;
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to end video at a time, frames from the time on are not
+ *          returned and no more packets are read
+ *
+ * @params: time from start of video (seconds), <= 0 = end of video
+ */
+void VideoDecoder::setEndTime(double seconds)
+{
+    m_rangeEndTs = (m_avStream && seconds > 0) ? getTimestamp(seconds) : AV_NOPTS_VALUE;
+}
+
+/**
+ * @brief: function to convert time from start of video to timestamp
+ *
+ * @params: time from start of video (seconds)
+ *
+ * @return: AV_NOPTS_VALUE if no video is open, timestamp in stream time base otherwise
+ */
+int64_t VideoDecoder::getTimestamp(double seconds)
+{
+    // check for valid stream 
+    if (m_avStream == NULL)
+        return AV_NOPTS_VALUE;
+
+    AVRational timeBase = {1, AV_TIME_BASE};
+    int64_t ts = av_rescale_q((int64_t)(seconds * AV_TIME_BASE), timeBase, m_avStream->time_base);
+
+    // timestamps start at start time of stream
+    if (m_avStream->start_time != AV_NOPTS_VALUE)
+        ts += m_avStream->start_time;
+
+    return ts;
+}
+
+/**
+ * @brief: function to read one packet of video stream, without decoding.
+ *          caller must av_free_packet() it once done
+ *
+ * @params: packet to fill
+ *
+ * @return: returns -1 on end of video, packet size on success
+ */
+int VideoDecoder::readPacket(AVPacket *avPkt)
+{
+    // check for valid stream and packet
+    if (m_avStream == NULL || avPkt == NULL)
+        return -1; // return failure
+
+    // loop until a packet of video stream is read
+    int64_t stageStart = StageStats::start();
+    while (av_read_frame(m_avFmtCtx, avPkt) >= 0)
+    {
+        m_stats.stages[STAGE_DEMUX].stop(stageStart, avPkt->size);
+
+        if (avPkt->stream_index == m_streamIndex)
+            return avPkt->size;
+
+        stageStart = StageStats::start();
+
+        // free packet of other stream
+        av_free_packet(avPkt);
+    }
+
+    return -1; // end of video
+}
+
+/**
+ * @brief: function to fetch stage stats of opened video, stages are timed
+ *          only while StageStats is enabled
+ *
+ * @return: demux, decode and convert stats
+ */
+const TranscodeStats& VideoDecoder::getStats()
+{
+    // time demuxer waited for readahead data
+    if (m_readaheadIO.isOpen())
+        m_stats.inputWait = m_readaheadIO.getWaitStats();
+
+    return m_stats;
+}
+
+/**
+ * @brief: function to fetch video stream of input video
+ *
+ * @return: stream if video was opened, NULL otherwise
+ */
+AVStream* VideoDecoder::getVideoStream()
+{
+    return m_avStream;
+}
+
+/**
+ * @brief: function to skip decoding of non reference frames, frames
+ *          nothing else is predicted from are not returned at all
+ *
+ * @params: true to skip non reference frames, false to decode all
+ */
+void VideoDecoder::setSkipNonRefFrames(bool skip)
+{
+    if (m_avCodecCtx)
+        m_avCodecCtx->skip_frame = skip ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+}
+
+/**
+ * @brief: function to fetch highest lowres level supported by codec
+ *
+ * @return: lowres level, 0 if codec decodes at full size only
+ */
+int VideoDecoder::getMaxLowres()
+{
+    return m_avCodec ? m_avCodec->max_lowres : 0;
+}
+
+/**
+ * @brief: function to find highest lowres level, max 3, whose decoded
+ *          size is still at least the given output size
+ *
+ * @params: input width and height, output width and height
+ *
+ * @return: lowres level, 0 = full size
+ */
+int VideoDecoder::getLowresForSize(int inpWidth, int inpHeight, int outWidth, int outHeight)
+{
+    int lowres = 0;
+
+    // each level halves width and height
+    while (lowres < 3 && (inpWidth >> (lowres + 1)) >= outWidth &&
+                         (inpHeight >> (lowres + 1)) >= outHeight)
+        lowres++;
+
+    return lowres;
+}
+
+/**
+ * @brief: function to read and decode frame within range of video,
+ *          frames before range start are skipped, video ends at range end
+ *
+ * @params: none
+ *
+ * @return: return -1 on failure/end of range, 0 on success 
+ */
+int VideoDecoder::readAndDecodeFrame()
+{
+    // loop until a frame within range is decoded
+    while (decodeFrame() >= 0)
+    {
+#ifdef FFMPEG_2_7_6
+        int64_t ts = av_frame_get_best_effort_timestamp(m_avFrame);
+
+        // frame before range start, decoded only as reference
+        if (m_rangeStartTs != AV_NOPTS_VALUE && ts != AV_NOPTS_VALUE && ts < m_rangeStartTs)
+            continue;
+
+        // frame at range end, no more packets are read
+        if (m_rangeEndTs != AV_NOPTS_VALUE && ts != AV_NOPTS_VALUE && ts >= m_rangeEndTs)
+        {
+            av_frame_unref(m_avFrame);
+            m_endOfVideo = 1;
+            return -1; // end of range
+        }
+#endif
+        return 0; // return success
+    }
+
+    return -1; // end of video
+}
+
+/**
+ * @brief: function to read and decode frame
+ *          frames delayed by the decoder (frame threading, b-frames) are
+ *          drained once all packets are read
+ *
+ * @params: none
+ *
+ * @return: return -1 on failure, 0 on success 
+ */
+int VideoDecoder::decodeFrame()
+{
+    // check for valid stream 
+    if (m_avStream == NULL)
+        return -1; // return failure
+
+#ifdef FFMPEG_2_7_6
+    // release previous decoded frame
+    av_frame_unref(m_avFrame);
+#endif
+
     // flag to check if a complete frame is read
     int frameFinished = 0;
 
     // loop until a complete frame is read
-    while (!frameFinished && (av_read_frame(m_avFmtCtx, &m_avPkt) >= 0))
+    while (!frameFinished)
     {
+        // check for valid frame data and free if already filled
+        if (m_avPkt.data != NULL)
+        {
+            // free packet
+            av_free_packet(&m_avPkt);
+            m_avPkt.data = NULL;
+        }
+
+        // read next packet
+        int readStatus = -1;
+        if (!m_endOfVideo)
+        {
+            int64_t stageStart = StageStats::start();
+            readStatus = av_read_frame(m_avFmtCtx, &m_avPkt);
+
+            if (readStatus >= 0)
+                m_stats.stages[STAGE_DEMUX].stop(stageStart, m_avPkt.size);
+        }
+
+        // all packets read, drain frames delayed in decoder
+        if (readStatus < 0)
+        {
+            // set end of video flag
+            m_endOfVideo = 1;
+
+            // empty packet, to fetch delayed frames
+            av_init_packet(&m_avPkt);
+            m_avPkt.data = NULL;
+            m_avPkt.size = 0;
+
+#ifdef FFMPEG_2_7_6
+            // decode delayed frame
+            int64_t stageStart = StageStats::start();
+            avcodec_decode_video2(m_avCodecCtx, m_avFrame, &frameFinished, &m_avPkt);
+            m_stats.stages[STAGE_DECODE].stop(stageStart);
+#else
+            // decode delayed frame
+            avcodec_decode_video(m_avCodecCtx, m_avFrame, &frameFinished, NULL, 0);
+#endif
+            // no more delayed frames
+            if (!frameFinished)
+                return -1; // end of video
+
+            break;
+        }
+
         // check for valid stream index to decode frame
         if (m_avPkt.stream_index == m_streamIndex)
         {
 #ifdef FFMPEG_2_7_6
 
-            // decode read frame
-            avcodec_decode_video2(m_avCodecCtx, m_avFrame, &frameFinished, 
-                                    &m_avPkt);
+            // decode read frame, corrupt packets are skipped
+            int64_t stageStart = StageStats::start();
+            if (avcodec_decode_video2(m_avCodecCtx, m_avFrame, &frameFinished, 
+                                    &m_avPkt) < 0)
+            {
+                fprintf(stderr, "\x1b[31m" "VideoDecoder:: Error decoding packet, skipped\n" "\x1b[0m");
+                frameFinished = 0;
+            }
+
+            m_stats.stages[STAGE_DECODE].stop(stageStart, m_avPkt.size);
 #else
             // decode read frame
             avcodec_decode_video(m_avCodecCtx, m_avFrame, &frameFinished, 
@@ -208,6 +768,68 @@ void VideoDecoder::initLocals()
 
     // total duration of video
     m_totalDuration = -1;
+
+    // end of video flag
+    m_endOfVideo = 0;
+
+    // no range
+    m_rangeStartTs = AV_NOPTS_VALUE;
+    m_rangeEndTs = AV_NOPTS_VALUE;
+
+    // input from file
+    m_inputData = NULL;
+    m_inputSize = 0;
+}
+
+/**
+ * @brief: function to set decoder context, applied on next openVideo
+ *
+ * @params: VideoDecoderContext
+ */
+void VideoDecoder::setDecoderContext(const VideoDecoderContext &decoderContext)
+{
+    // setting decoder context
+    m_decoderContext = decoderContext;
+}
+
+/**
+ * @brief: function to read input video from memory buffer instead of file,
+ *          applied on next openVideo. buffer must stay valid till video is
+ *          closed, filename of openVideo is only used in logs and as a
+ *          format hint
+ *
+ * @params: input video data, size of data (NULL, 0 = read from file)
+ */
+void VideoDecoder::setInputBuffer(const uint8_t *data, size_t size)
+{
+    m_inputData = data;
+    m_inputSize = size;
+    m_inputCallback = nullptr;
+}
+
+/**
+ * @brief: function to read input video from callback instead of file,
+ *          applied on next openVideo. input is streamed, so it can not
+ *          seek and can be opened only once
+ *
+ * @params: read callback (empty = read from file)
+ */
+void VideoDecoder::setInputCallback(const MemoryReadCallback &readCallback)
+{
+    m_inputData = NULL;
+    m_inputSize = 0;
+    m_inputCallback = readCallback;
+}
+
+/**
+ * @brief: function to check if input video can be opened again from start,
+ *          false for callback and stdin input
+ *
+ * @return: true if input can be reopened
+ */
+bool VideoDecoder::canReopen()
+{
+    return !m_inputCallback && m_inpFile != "-";
 }
 
 /**
@@ -229,6 +851,41 @@ int VideoDecoder::openVideo(string inpVideoFilePath)
     fprintf(stderr, "\x1b[33m" "VideoDecoder:: Opening video: %s\n" "\x1b[0m", m_inpFile.c_str());
 #ifdef FFMPEG_2_7_6 
     //AVDictionary *opts = 0;
+
+    // read input from memory buffer or callback, "-" is piped input from stdin
+    if (m_inputData || m_inputCallback || m_inpFile == "-")
+    {
+        int memoryStatus = m_inputData ? m_memoryIO.openInput(m_inputData, m_inputSize) :
+                           m_inputCallback ? m_memoryIO.openInput(m_inputCallback) :
+                                             m_memoryIO.openInput(&MemoryIO::readStdin);
+
+        if (memoryStatus == 0)
+            m_avFmtCtx = avformat_alloc_context();
+
+        if (!m_avFmtCtx)
+        {
+            m_memoryIO.close();
+            fprintf(stderr, "\x1b[31m" "VideoDecoder:: Could not open memory input\n" "\x1b[0m");
+            return -1; // return failure
+        }
+
+        m_avFmtCtx->pb = m_memoryIO.getAVIOContext();
+    }
+    // read input through readahead buffer, ffmpeg file i/o if it fails
+    else if (m_decoderContext.readaheadSize > 0)
+    {
+        if (m_readaheadIO.open(m_inpFile, m_decoderContext.readaheadSize) == 0)
+        {
+            m_avFmtCtx = avformat_alloc_context();
+            if (m_avFmtCtx)
+                m_avFmtCtx->pb = m_readaheadIO.getAVIOContext();
+            else
+                m_readaheadIO.close();
+        }
+
+        if (!m_readaheadIO.isOpen())
+            fprintf(stderr, "\x1b[33m" "VideoDecoder:: Readahead failed, using file i/o\n" "\x1b[0m");
+    }
     
     // if open video with format context and video filename is success
     if (avformat_open_input(&m_avFmtCtx, (char *)m_inpFile.c_str(), NULL, NULL) != 0)
@@ -239,6 +896,10 @@ int VideoDecoder::openVideo(string inpVideoFilePath)
     {
         fprintf(stderr, "\x1b[31m" "VideoDecoder:: Could not open video: %s\n" "\x1b[0m", 
                                                             m_inpFile.c_str());
+
+        // format context is freed on failure
+        m_readaheadIO.close();
+        m_memoryIO.close();
         return -1; // return failure
     }
 
@@ -293,7 +954,21 @@ int VideoDecoder::openVideo(string inpVideoFilePath)
         fprintf(stderr, "\x1b[31m" "VideoDecoder:: Codec not supposted!!" "\x1b[0m");
         return -1; // return failure
     }
+    // set decoding threads, auto = no of cpu cores
+    int threadCount = m_decoderContext.threadCount;
+    if (threadCount <= 0)
+        threadCount = FFMIN(FFMAX((int)sysconf(_SC_NPROCESSORS_ONLN), 1), MAX_AUTO_THREADS);
+
+    m_avCodecCtx->thread_count = threadCount;
+    m_avCodecCtx->thread_type = m_decoderContext.threadType;
+
+    // reduced resolution decoding, only if codec supports it
+    m_avCodecCtx->lowres = FFMIN(FFMAX(m_decoderContext.lowres, 0), (int)m_avCodec->max_lowres);
+
 #ifdef FFMPEG_2_7_6
+    // decoded frames are reference counted, so they can be handed out without copy
+    m_avCodecCtx->refcounted_frames = 1;
+
     // open video with codec context and codec
     if (avcodec_open2(m_avCodecCtx, m_avCodec, NULL) < 0)
 #else
@@ -307,9 +982,37 @@ int VideoDecoder::openVideo(string inpVideoFilePath)
 
     // set total no of frame in video
     m_totalFrames = m_avStream->nb_frames;
+
+    // keyframe index, seeks and keyframe probes without scanning video. memory
+    // input has no index file
+    if (m_decoderContext.keyFrameIndex && !m_memoryIO.isOpen() &&
+            m_keyFrameIndex.load(m_inpFile, m_streamIndex, m_avStream->time_base.num,
+                                 m_avStream->time_base.den) > 0)
+    {
+        if (m_totalFrames <= 0)
+            m_totalFrames = m_keyFrameIndex.getTotalFrames();
+
+        fprintf(stderr, "\x1b[32m" "VideoDecoder:: Using keyframe index: %s\n" "\x1b[0m",
+                                    KeyFrameIndex::getIndexFile(m_inpFile).c_str());
+    }
+
+    // reset end of video flag
+    m_endOfVideo = 0;
+
+    // stats of this video only
+    m_stats.reset();
+
+    // whole video
+    m_rangeStartTs = AV_NOPTS_VALUE;
+    m_rangeEndTs = AV_NOPTS_VALUE;
    
-    // allocate memory to frame 
-    m_avFrame = avcodec_alloc_frame();
+    // allocate memory to frame, if not allocated
+    if (m_avFrame == NULL)
+#ifdef FFMPEG_2_7_6
+        m_avFrame = av_frame_alloc();
+#else
+        m_avFrame = avcodec_alloc_frame();
+#endif
     
     // check if allocation was success
     if (m_avFrame == NULL)
@@ -324,9 +1027,20 @@ int VideoDecoder::openVideo(string inpVideoFilePath)
 
     // set total duration of video
     m_totalDuration = m_avFmtCtx->duration;
+
+#ifdef FFMPEG_2_7_6
+    // set frame rate of video
+    AVRational frameRate = av_guess_frame_rate(m_avFmtCtx, m_avStream, NULL);
+    if (frameRate.num > 0 && frameRate.den > 0)
+        m_frameRate = (int)(av_q2d(frameRate) + 0.5);
+#endif
    
         
-    fprintf(stderr, "\x1b[32m" "VideoDecoder:: Video open success!!\n" "\x1b[0m");
+    fprintf(stderr, "\x1b[32m" "VideoDecoder:: Video open success (%d %s threads, lowres %d)!!\n" "\x1b[0m",
+                m_avCodecCtx->thread_count, 
+                m_avCodecCtx->active_thread_type == FF_THREAD_FRAME ? "frame" :
+                m_avCodecCtx->active_thread_type == FF_THREAD_SLICE ? "slice" : "no",
+                m_avCodecCtx->lowres);
 
     return 0; // return success
 }
@@ -336,6 +1050,19 @@ int VideoDecoder::openVideo(string inpVideoFilePath)
  */
 void VideoDecoder::closeVideo()
 {
+    // free packet if any
+    if (m_avPkt.data)
+    {
+        av_free_packet(&m_avPkt);
+        m_avPkt.data = NULL;
+    }
+
+    // reset stream index, for next video
+    m_streamIndex = -1;
+
+    // unmap keyframe index
+    m_keyFrameIndex.unload();
+
     // close if stream is valid
     if (m_avStream)
     {
@@ -354,4 +1081,22 @@ void VideoDecoder::closeVideo()
         m_avFmtCtx = NULL;
         fprintf(stderr, "\x1b[32m" "VideoDecoder:: Video close success!!\n" "\x1b[0m");
     }
+
+    // memory input, after format context stopped reading it
+    m_memoryIO.close();
+
+    // readahead input, after format context stopped reading it
+    if (m_readaheadIO.isOpen())
+    {
+        const StageStats &waitStats = m_readaheadIO.getWaitStats();
+
+        fprintf(stderr, "\x1b[32m" "VideoDecoder:: Readahead: %.1f MB read, %d/%d seeks buffered, "
+                        "waited %.2f ms in %d of %lld reads\n" "\x1b[0m",
+                        m_readaheadIO.getBytesRead() / (1024.0 * 1024.0),
+                        m_readaheadIO.getBufferedSeeks(), m_readaheadIO.getSeeks(),
+                        waitStats.getTotal() / 1000.0,
+                        m_readaheadIO.getStalls(), (long long)waitStats.getCount());
+
+        m_readaheadIO.close();
+    }
 }
@@ -9,6 +9,16 @@
 
 #include "VideoEncoder.h"
 
+#include <cstring>
+
+#include <unistd.h>
+
+// max no of encoding threads chosen automatically
+#define MAX_AUTO_THREADS 16
+
+// no of frames held in encoder whose latency can be measured
+#define LATENCY_SLOTS 256
+
 /**
  * @brief: Default constructor for video encoder
  *          Initialize all the member data
@@ -35,12 +45,11 @@ VideoEncoder::VideoEncoder(const struct VideoEncoderContext encoderContext)
 
 /**
  * @brief: destructor for video encoder
- *          clean allocated member data
  */
 VideoEncoder::~VideoEncoder()
 {
-    // function call to clean allocated member data
-    cleanEncoder();
+    // free encoder frame, frame pool and converter free their own data
+    av_frame_free(&m_encodeFrame);
 }
 
 /**
@@ -78,6 +87,33 @@ int VideoEncoder::startVideoEncode()
     return initializeVideo();
 }
 
+/**
+ * @brief: function to write output video to growable buffer instead of
+ *          file, applied on next startVideoEncode. buffer is cleared and
+ *          holds whole video after stopVideoEncode, output filename is only
+ *          used to find output format
+ *
+ * @params: output buffer (NULL = write to file)
+ */
+void VideoEncoder::setOutputBuffer(std::vector<uint8_t> *buffer)
+{
+    m_outputBuffer = buffer;
+    m_outputCallback = nullptr;
+}
+
+/**
+ * @brief: function to write output video to callback instead of file,
+ *          applied on next startVideoEncode. output is streamed, so format
+ *          must not rewrite its header (mpegts, mkv instead of mp4)
+ *
+ * @params: write callback (empty = write to file)
+ */
+void VideoEncoder::setOutputCallback(const MemoryWriteCallback &writeCallback)
+{
+    m_outputBuffer = NULL;
+    m_outputCallback = writeCallback;
+}
+
 /**
  * @brief: function to stop video encode
  *
@@ -99,11 +135,8 @@ int VideoEncoder::stopVideoEncode()
  */
 int VideoEncoder::addNewFrame(unsigned char *frameArr) 
 {
-    // allocate memory to frame
-    AVFrame *avFrame = avcodec_alloc_frame();
-
-    // check if allocation was success and stream was initialized
-    if (!avFrame || !m_avStream)
+    // check if stream was initialized
+    if (!frameArr || !m_avStream)
     {
         fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not initialize frame/stream!!\n" "\x1b[0m");
         return -1; // return failure
@@ -113,50 +146,160 @@ int VideoEncoder::addNewFrame(unsigned char *frameArr)
     int width = m_encoderContext.width;
     int height = m_encoderContext.height;
 
-    // fill data to frame
-    avpicture_fill((AVPicture *)avFrame, (unsigned char*)frameArr,
-            PIX_FMT_RGB24, width, height);
+    // point picture planes to frame array, no allocation
+    AVPicture avPicture;
+    avpicture_fill(&avPicture, (unsigned char*)frameArr, PIX_FMT_RGB24, width, height);
+
+    // function to convert and add new frame
+    return convertAndAddFrame(avPicture.data, avPicture.linesize, width, height, 
+                                                                PIX_FMT_RGB24);
+}
+
+/**
+ * @brief: Function to add new planar frame to video
+ *          frame is encoded as it is if pixel format and size match the
+ *          encoder, else it is converted once to encoder format
+ *
+ * @params: frame with planes to add to video
+ *
+ * @return: returns-1 on failure, 0 on success
+ */
+int VideoEncoder::addNewFrame(AVFrame *avFrame) 
+{
+    // check if frame and stream were initialized
+    if (!avFrame || !m_avStream)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not initialize frame/stream!!\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    // frame handed to encoder, start of encoder latency
+    if (m_encoderContext.lowLatency || StageStats::isEnabled())
+        m_inputTime = av_gettime_relative();
+
+    // initialize local codec contex
+    AVCodecContext* avCodecCtx = m_avStream->codec;
+
+    // pixel format and size match, encode planes directly
+    if (avFrame->format == avCodecCtx->pix_fmt && avFrame->width == avCodecCtx->width &&
+                                                 avFrame->height == avCodecCtx->height)
+        return addFrame(avFrame);
+
+    // function to convert and add new frame
+    return convertAndAddFrame(avFrame->data, avFrame->linesize, avFrame->width,
+                              avFrame->height, (::PixelFormat)avFrame->format);
+}
 
-    // check if member frame is initialized
-    if (!m_avFrame) 
-        m_avFrame = allocFrame(); // allocate frame
+/**
+ * @brief: Function to convert planes into a pooled frame of encoder format
+ *          and add it to video
+ *
+ * @params: source planes, linesizes, width, height and pixel format
+ *
+ * @return: returns-1 on failure, 0 on success
+ */
+int VideoEncoder::convertAndAddFrame(const uint8_t *const srcData[], const int srcLinesize[],
+                                     int srcWidth, int srcHeight, PixelFormat srcFormat)
+{
+    // initialize local codec contex
+    AVCodecContext* avCodecCtx = m_avStream->codec;
 
-    // set conversion context for conversion from rgb
-    struct SwsContext* swsContext = sws_getContext(width, height,
-                            (::PixelFormat) PIX_FMT_RGB24, width, height,
-                            (::PixelFormat)m_avStream->codec->pix_fmt, 
-                            SWS_BICUBIC, NULL, NULL, NULL);
+    // fetch a recycled frame from pool
+    AVFrame *avFrame = m_framePool.getFrame();
 
-    // check if sws context was set
-    if (!swsContext) 
+    // check if frame was fetched
+    if (!avFrame)
     {
-        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not get scale context\n" "\x1b[0m");
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not allocate frame\n" "\x1b[0m");
         return -1;
     }
 
-    // convert rgb to required format
-    sws_scale(swsContext, avFrame->data, avFrame->linesize, 0, 
-            m_avStream->codec->height, m_avFrame->data, m_avFrame->linesize);
+    // convert to required format, using cached scale context
+    int64_t stageStart = StageStats::start();
+    if (m_frameConverter.convert(srcData, srcLinesize, srcWidth, srcHeight, srcFormat,
+                avFrame->data, avFrame->linesize, avCodecCtx->width, avCodecCtx->height, 
+                (::PixelFormat)avCodecCtx->pix_fmt) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not convert frame\n" "\x1b[0m");
+        FramePool::releaseFrame(avFrame);
+        return -1;
+    }
 
-    // release conversion context
-    sws_freeContext(swsContext);
+    m_stats.stages[STAGE_CONVERT].stop(stageStart);
 
     // function to add new frame
-    return addFrame();
+    int retStatus = addFrame(avFrame);
+
+    // give frame back to pool
+    FramePool::releaseFrame(avFrame);
+
+    return retStatus;
+}
+
+/**
+ * @brief: function to fetch stage stats of output video, stages are timed
+ *          only while StageStats is enabled
+ *
+ * @return: convert, encode and write stats
+ */
+const TranscodeStats& VideoEncoder::getStats()
+{
+    return m_stats;
+}
+
+/**
+ * @brief: function to clear stage stats, e.g. between inputs of one output
+ */
+void VideoEncoder::resetStats()
+{
+    m_stats.reset();
+}
+
+/**
+ * @brief: function to fetch format of frames accepted without conversion
+ *
+ * @params: pixel format, width and height to fill
+ *
+ * @return: returns -1 if encoding was not started, 0 on success
+ */
+int VideoEncoder::getFrameFormat(PixelFormat &pixFmt, int &width, int &height)
+{
+    // check if stream was initialized
+    if (!m_avStream)
+        return -1; // return failure
+
+    // fill codec format
+    pixFmt = (::PixelFormat)m_avStream->codec->pix_fmt;
+    width = m_avStream->codec->width;
+    height = m_avStream->codec->height;
+
+    return 0; // return success
+}
+
+/**
+ * @brief: function to fetch average conversion time per frame
+ *
+ * @return: time in micro seconds
+ */
+double VideoEncoder::getAvgConvertTime()
+{
+    return m_frameConverter.getAvgConvertTime();
 }
 
 /**
  * @brief: Function to write frames to the video
  *
+ * @params: frame in encoder format to write
+ *
  * @return: return -1 on failure and 0 on success
  */
-int VideoEncoder::addFrame() 
+int VideoEncoder::addFrame(AVFrame *avFrame) 
 {
-    // return status of add frame, failure = -1 and 0, success >= 0
+    // return status of add frame, failure = -1, delayed = 0, success > 0
     int retStatus = -1;
 
     // check if stream and frame are initialized
-    if (!m_avStream || !m_avFrame) 
+    if (!m_avStream || !avFrame) 
     {
         fprintf(stderr, "\x1b[31m" "VideoEncoder:: Video Frame/Stream not initialized!!\n" "\x1b[0m");
         return retStatus; // return failure
@@ -180,7 +323,7 @@ int VideoEncoder::addFrame()
 
         //avPkt.flags |= PKT_FLAG_KEY;
         avPkt.stream_index = m_avStream->index;
-        avPkt.data = (uint8_t *)m_avFrame;
+        avPkt.data = (uint8_t *)avFrame;
         avPkt.size = sizeof(AVPicture);
 
         retStatus = av_write_frame(m_avFmtCtx, &avPkt);
@@ -188,39 +331,42 @@ int VideoEncoder::addFrame()
     else // encode data
     {
         // check if codec contex is initilized and width/height is set
-        if (avCodecCtx && avCodecCtx->width == m_encoderContext.width &&
-                          avCodecCtx->height == m_encoderContext.height) 
+        if (avCodecCtx && m_encodeFrame && avCodecCtx->width == m_encoderContext.width &&
+                                           avCodecCtx->height == m_encoderContext.height) 
         {
+            // encoder frame points to planes of caller's frame, no pixels
+            // are copied. frame properties are set on it, not on caller's
+            // frame, as one decoded frame may go to many encoders at once
+            AVFrame *encFrame = m_encodeFrame;
+            av_frame_unref(encFrame);
+            av_frame_copy_props(encFrame, avFrame);
+            for (int i = 0; i < AV_NUM_DATA_POINTERS; i++)
+            {
+                encFrame->data[i] = avFrame->data[i];
+                encFrame->linesize[i] = avFrame->linesize[i];
+            }
+            encFrame->format = avFrame->format;
+            encFrame->width = avFrame->width;
+            encFrame->height = avFrame->height;
+
             // set frame quality
-            m_avFrame->quality = avCodecCtx->global_quality;
+            encFrame->quality = avCodecCtx->global_quality;
 
-            // encode video into frame
-            int size = avcodec_encode_video(avCodecCtx, m_pictureOutBuf, 
-                                            m_pictureOutBufSize, m_avFrame);
+            // set frame timestamp, in codec time base
+            encFrame->pts = m_frameCount;
 
-            // if encoding was success, write data into video file
-            if (size >= 0) 
-            {
-                // initialize pkt
-                AVPacket avPkt;
-                av_init_packet(&avPkt);
+            // input time of frame, looked up when its packet is muxed
+            m_frameInputTimes[m_frameCount % LATENCY_SLOTS] = m_inputTime;
+            m_inputTime = 0;
 
-                avPkt.stream_index = m_avStream->index;
-                avPkt.data = m_pictureOutBuf;
-                avPkt.size = size;
+            // let encoder choose frame type, decoded frames carry input frame type
+            encFrame->pict_type = AV_PICTURE_TYPE_NONE;
 
-                // write frame
-                retStatus = av_write_frame(m_avFmtCtx, &avPkt);
+            // encode frame and write packet, 0 = frame delayed in encoder
+            retStatus = encodeFrame(encFrame);
 
-                // check if writting was success
-                if (retStatus >= 0)
-                    retStatus = size;
-            } 
-            else // encoding was not successful
-            {
-                fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not encode frame!!\n" "\x1b[0m");
-                retStatus = 0;
-            }
+            // drop side data copied from caller's frame
+            av_frame_unref(encFrame);
         } 
         else
         {
@@ -241,6 +387,311 @@ int VideoEncoder::addFrame()
     return retStatus;
 }
 
+/**
+ * @brief: function to encode a frame and write its packet. packet is
+ *          allocated by encoder, so its size is not limited
+ *
+ * @params: frame to encode, NULL to fetch a frame delayed in encoder
+ *
+ * @return: returns -1 on failure, 0 if no packet is ready, packet size on success
+ */
+int VideoEncoder::encodeFrame(AVFrame *avFrame)
+{
+    AVCodecContext *avCodecCtx = m_avStream->codec;
+
+    // empty packet, data is allocated by encoder
+    AVPacket avPkt;
+    av_init_packet(&avPkt);
+    avPkt.data = NULL;
+    avPkt.size = 0;
+
+    int gotPacket = 0;
+
+    // encode frame, packet may belong to an earlier frame
+    int64_t stageStart = StageStats::start();
+    if (avcodec_encode_video2(avCodecCtx, &avPkt, avFrame, &gotPacket) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not encode frame!!\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    m_stats.stages[STAGE_ENCODE].stop(stageStart, gotPacket ? avPkt.size : 0);
+
+    // frame delayed by lookahead or b-frames
+    if (!gotPacket)
+        return 0;
+
+    int size = avPkt.size;
+
+    // frame of packet, pts in codec time base is its frame count
+    int64_t framePts = avPkt.pts;
+
+    // rescale timestamps from codec to stream time base
+    av_packet_rescale_ts(&avPkt, avCodecCtx->time_base, m_avStream->time_base);
+    avPkt.stream_index = m_avStream->index;
+
+    // write packet, muxer orders packets by dts
+    stageStart = StageStats::start();
+    int retStatus = av_interleaved_write_frame(m_avFmtCtx, &avPkt);
+    m_stats.stages[STAGE_WRITE].stop(stageStart, size);
+
+    av_free_packet(&avPkt);
+
+    // check if writting was success
+    if (retStatus < 0)
+        return -1; // return failure
+
+    // encoder latency of frame, frames drained at end of video are not counted
+    if (avFrame && framePts != AV_NOPTS_VALUE && framePts >= 0 && 
+                                        m_frameCount - framePts < LATENCY_SLOTS)
+    {
+        m_stats.encodeDelay.addSample(m_frameCount - framePts);
+
+        int64_t inputTime = m_frameInputTimes[framePts % LATENCY_SLOTS];
+        if (inputTime)
+            m_stats.encodeLatency.addSample(av_gettime_relative() - inputTime);
+    }
+
+    return size;
+}
+
+/**
+ * @brief: function to write all frames delayed in encoder
+ *
+ * @return: returns -1 on failure, no of written packets on success
+ */
+int VideoEncoder::flushEncoder()
+{
+    // check if stream was encoded
+    if (!m_avStream || (m_avFmtCtx->oformat->flags & AVFMT_RAWPICTURE))
+        return 0;
+
+    // only encoders with delay keep frames, stream copy has no encoder
+    AVCodecContext *avCodecCtx = m_avStream->codec;
+    if (!avCodecCtx || !avCodecCtx->codec || !(avCodecCtx->codec->capabilities & CODEC_CAP_DELAY))
+        return 0;
+
+    int packets = 0;
+    int size = 0;
+
+    // drain until encoder has no frame left
+    while ((size = encodeFrame(NULL)) > 0)
+        packets++;
+
+    if (size < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Error in flushing encoder..\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    return packets;
+}
+
+/**
+ * @brief: function to find output size for an input size. a missing
+ *          dimension keeps aspect ratio of input, sizes are rounded down
+ *          to even as required by yuv420p
+ *
+ * @params: output video options, input width and height,
+ *          output width and height to fill
+ */
+void VideoEncoder::getOutputSize(const struct VideoEncoderContext &encoderCtx, int inpWidth,
+                                 int inpHeight, int &outWidth, int &outHeight)
+{
+    outWidth = encoderCtx.width;
+    outHeight = encoderCtx.height;
+
+    // input size not known, or no scaling
+    if (inpWidth <= 0 || inpHeight <= 0 || (outWidth <= 0 && outHeight <= 0))
+    {
+        outWidth = inpWidth;
+        outHeight = inpHeight;
+        return;
+    }
+
+    if (outWidth <= 0)
+    {
+        // width from height
+        outWidth = (int)av_rescale(outHeight, inpWidth, inpHeight);
+    }
+    else if (outHeight <= 0)
+    {
+        // height from width
+        outHeight = (int)av_rescale(outWidth, inpHeight, inpWidth);
+    }
+    else if (encoderCtx.scaleMode == SCALE_MODE_FIT)
+    {
+        // shrink the dimension which would exceed its limit
+        if ((int64_t)outWidth * inpHeight > (int64_t)outHeight * inpWidth)
+            outWidth = (int)av_rescale(outHeight, inpWidth, inpHeight);
+        else
+            outHeight = (int)av_rescale(outWidth, inpHeight, inpWidth);
+    }
+
+    // even size, at least 2x2
+    outWidth = FFMAX(outWidth & ~1, 2);
+    outHeight = FFMAX(outHeight & ~1, 2);
+}
+
+/**
+ * @brief: function to fetch output frame rate
+ *
+ * @return: output frame rate, frames per second
+ */
+int VideoEncoder::getFrameRate()
+{
+    return m_encoderContext.frameRate;
+}
+
+/**
+ * @brief: function to find codec of output video format
+ *
+ * @params: output video format, H264 or MPEG-4
+ *
+ * @return: codec id, CODEC_ID_NONE if format is not supported
+ */
+int VideoEncoder::getCodecId(const std::string &codecStr)
+{
+    if (codecStr == "H264")
+        return CODEC_ID_H264;
+    else if (codecStr == "MPEG-4")
+        return CODEC_ID_MSMPEG4V2;
+
+    return CODEC_ID_NONE;
+}
+
+/**
+ * @brief: function to start writing packets of an input stream without
+ *          re-encoding. output file and format are taken from encoder context
+ *
+ * @params: input video stream to copy codec parameters from
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int VideoEncoder::startStreamCopy(const AVStream *inpStream)
+{
+    // check for valid input stream
+    if (!inpStream || !inpStream->codec)
+        return -1; // return failure
+
+    // get output filename
+    const char *outputFile = m_encoderContext.outputVideoFile.c_str();
+
+    // encoder started, so reset frame count and stats
+    m_frameCount = 0;
+    m_stats.reset();
+
+    // guess output format
+    m_avOutFmt = guessOutputFormat(m_encoderContext, outputFile);
+    if (!m_avOutFmt) 
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Output Format not initialized!!\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    // allocate format context
+    m_avFmtCtx = avformat_alloc_context();
+    if (!m_avFmtCtx) 
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Format Context not initialized!!\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    m_avFmtCtx->oformat = m_avOutFmt;
+    snprintf(m_avFmtCtx->filename, sizeof(m_avFmtCtx->filename), "%s", outputFile);
+
+    // add stream, no encoder
+    m_avStream = avformat_new_stream(m_avFmtCtx, NULL);
+    if (!m_avStream) 
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Video Stream not initialized!!\n" "\x1b[0m");
+        freeOutput();
+        return -1; // return failure
+    }
+
+    // copy codec parameters and extradata of input stream
+    AVCodecContext *avCodecCtx = m_avStream->codec;
+    if (avcodec_copy_context(avCodecCtx, inpStream->codec) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not copy codec parameters\n" "\x1b[0m");
+        freeOutput();
+        return -1; // return failure
+    }
+
+    // codec tag of input container may not be valid for output container
+    avCodecCtx->codec_tag = 0;
+
+    if (m_avOutFmt->flags & AVFMT_GLOBALHEADER)
+        avCodecCtx->flags |= CODEC_FLAG_GLOBAL_HEADER;
+
+    // stream time base and aspect ratio, as a hint to muxer
+    m_avStream->time_base = inpStream->time_base;
+    m_avStream->sample_aspect_ratio = inpStream->sample_aspect_ratio;
+
+    // output size is input size
+    m_encoderContext.width = avCodecCtx->width;
+    m_encoderContext.height = avCodecCtx->height;
+
+    // open video url
+    if (!(m_avOutFmt->flags & AVFMT_NOFILE) && openOutput(outputFile) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Error in opening url\n" "\x1b[0m");
+        freeOutput();
+        return -1; // return failure
+    }
+
+    // write header information
+    if (writeHeader() < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not write header\n" "\x1b[0m");
+        freeOutput();
+        return -1; // return failure
+    }
+
+    fprintf(stderr, "\x1b[32m" "VideoEncoder:: Stream copy initialize success!!\n" "\x1b[0m");
+    return 0; // return success
+}
+
+/**
+ * @brief: function to write an already encoded packet. packet is written
+ *          interleaved, caller must still av_free_packet() it
+ *
+ * @params: packet to write, time base of packet timestamps
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int VideoEncoder::addPacket(AVPacket *avPkt, AVRational timeBase)
+{
+    // check if stream and packet are initialized
+    if (!m_avStream || !avPkt) 
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Video Packet/Stream not initialized!!\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    // rescale timestamps to output stream
+    av_packet_rescale_ts(avPkt, timeBase, m_avStream->time_base);
+
+    avPkt->stream_index = m_avStream->index;
+    avPkt->pos = -1;
+
+    // write packet
+    int size = avPkt->size;
+    int64_t stageStart = StageStats::start();
+    if (av_interleaved_write_frame(m_avFmtCtx, avPkt) < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Error in writing packet..\n" "\x1b[0m");
+        return -1; // return failure
+    }
+
+    m_stats.stages[STAGE_WRITE].stop(stageStart, size);
+
+    // increament frame count
+    m_frameCount++;
+
+    return 0; // return success
+}
+
 /**
  * @brief: function to initialize all data member
  */
@@ -255,27 +706,28 @@ void VideoEncoder::initLocals()
     // stream
     m_avStream = NULL;
 
-    // frame
-    m_avFrame = NULL;
-
-    // picture input buf
-    m_pictureInpBuf = NULL;
+    // output codec
+    m_codecId = CODEC_ID_NONE;
 
     // frame count
     m_frameCount = 0;
 
-    // stream index
-    m_streamIdx = -1;
+    // no frame in encoder
+    m_inputTime = 0;
+    m_frameInputTimes.assign(LATENCY_SLOTS, 0);
 
-    // picture output buf
-    m_pictureOutBuf = NULL;
+    // frame handed to encoder
+    m_encodeFrame = av_frame_alloc();
 
-    // picture out buf size
-    m_pictureOutBufSize = 0;
+    // stream index
+    m_streamIdx = -1;
 
     // encoder context flag
     m_encoderCtxSet = 0;
 
+    // output to file
+    m_outputBuffer = NULL;
+
     // register ffmpeg resources
     av_register_all();
 
@@ -291,8 +743,11 @@ void VideoEncoder::initLocals()
 AVStream* VideoEncoder::addStream() 
 {
 #ifdef FFMPEG_2_7_6
+    // find encoder, so stream gets encoder specific defaults
+    AVCodec *avCodec = avcodec_find_encoder((AVCodecID)m_codecId);
+
     // allocate stream 
-    AVStream *avStream = avformat_new_stream(m_avFmtCtx, NULL);
+    AVStream *avStream = avformat_new_stream(m_avFmtCtx, avCodec);
 #else
     // allocate stream
     AVStream *avStream = av_new_stream(m_avFmtCtx, 0);
@@ -310,7 +765,7 @@ AVStream* VideoEncoder::addStream()
 
 #ifdef FFMPEG_2_7_6
     // set codec id
-    avCodecCtx->codec_id = (AVCodecID)m_avOutFmt->video_codec;
+    avCodecCtx->codec_id = (AVCodecID)m_codecId;
 
     // set codec type
     avCodecCtx->codec_type = AVMEDIA_TYPE_VIDEO;
@@ -319,7 +774,7 @@ AVStream* VideoEncoder::addStream()
     avCodecCtx->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
 #else
     // set codec id
-    avCodecCtx->codec_id = (CodecID)m_avOutFmt->video_codec;
+    avCodecCtx->codec_id = (CodecID)m_codecId;
 
     // set codec type
     avCodecCtx->codec_type = CODEC_TYPE_VIDEO;
@@ -329,7 +784,7 @@ AVStream* VideoEncoder::addStream()
 #endif
 
     // set bit rate
-    avCodecCtx->bit_rate = 400000;
+    avCodecCtx->bit_rate = m_encoderContext.bitRate;
 
     // set codec context width
     avCodecCtx->width = m_encoderContext.width;
@@ -344,13 +799,54 @@ AVStream* VideoEncoder::addStream()
     avCodecCtx->time_base.num = 1;
 
     // set gop size
-    avCodecCtx->gop_size = 12;   
+    avCodecCtx->gop_size = m_encoderContext.gopSize;   
+
+    // segmented output, keyframe at every segment boundary
+    if (m_encoderContext.segmentFormat != SEGMENT_FORMAT_NONE && m_encoderContext.segmentTime > 0)
+    {
+        int segmentFrames = (int)(m_encoderContext.segmentTime * m_encoderContext.frameRate + 0.5);
+        if (segmentFrames > 0 && (avCodecCtx->gop_size <= 0 || segmentFrames % avCodecCtx->gop_size))
+            avCodecCtx->gop_size = segmentFrames;
+
+        // no extra keyframes on scene changes, they would shift segment boundaries
+        avCodecCtx->scenechange_threshold = 0;
+    }
 
     // set pixel format
     avCodecCtx->pix_fmt = PIX_FMT_YUV420P;
 
+    // set encoding threads, auto = no of cpu cores
+    int threadCount = m_encoderContext.threadCount;
+    if (threadCount <= 0)
+        threadCount = FFMIN(FFMAX((int)sysconf(_SC_NPROCESSORS_ONLN), 1), MAX_AUTO_THREADS);
+
+    avCodecCtx->thread_count = threadCount;
+
+    // low latency, frame threads hold one frame per thread, slices do not.
+    // no b-frames, they are held till next reference frame
+    if (m_encoderContext.lowLatency)
+    {
+        avCodecCtx->thread_type = FF_THREAD_SLICE;
+        avCodecCtx->max_b_frames = 0;
+    }
+
+    // rate control, quantizer and rate factor of H264 are set as codec options
+    int rateControl = m_encoderContext.rateControl;
+
+    // rate factor is supported by H264 only
+    if (rateControl == RATE_CONTROL_CRF && avCodecCtx->codec_id != CODEC_ID_H264)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: CRF not supported by codec, using CQP\n" "\x1b[0m");
+        rateControl = RATE_CONTROL_CQP;
+    }
+
+    // constant quantizer/rate factor, no target bit rate
+    if (rateControl == RATE_CONTROL_CQP || rateControl == RATE_CONTROL_CRF)
+        avCodecCtx->bit_rate = 0;
+
     // set flag for encoder quality
-    if (m_encoderContext.quality) 
+    if (m_encoderContext.quality && (rateControl == RATE_CONTROL_DEFAULT || 
+       (rateControl == RATE_CONTROL_CQP && avCodecCtx->codec_id != CODEC_ID_H264)))
     {
         avCodecCtx->flags |= CODEC_FLAG_QSCALE;
 #ifdef FFMPEG_2_7_6
@@ -364,17 +860,21 @@ AVStream* VideoEncoder::addStream()
     // if codec = H264, set required params
     if (avCodecCtx->codec_id == CODEC_ID_H264)
     {
-        avCodecCtx->i_quant_factor = 0.71;
+        // legacy tuning, when no preset selects it
+        if (m_encoderContext.preset.empty())
+        {
+            avCodecCtx->i_quant_factor = 0.71;
 #ifdef FFMPEG_2_7_6
 #else
-        avCodecCtx->crf = 18; 
+            avCodecCtx->crf = 18; 
 #endif
-        avCodecCtx->trellis = 1;
-        avCodecCtx->qmin = 1;
-        avCodecCtx->qmax = 26;
-        avCodecCtx->max_qdiff = 4;
-        avCodecCtx->max_b_frames = 3;
-        avCodecCtx->me_method = ME_HEX;
+            avCodecCtx->trellis = 1;
+            avCodecCtx->qmin = 1;
+            avCodecCtx->qmax = 26;
+            avCodecCtx->max_qdiff = 4;
+            avCodecCtx->max_b_frames = m_encoderContext.lowLatency ? 0 : 3;
+            avCodecCtx->me_method = ME_HEX;
+        }
         avCodecCtx->flags |= CODEC_FLAG_GLOBAL_HEADER;
         avCodecCtx->flags |= CODEC_FLAG_LOOP_FILTER;
         avCodecCtx->ticks_per_frame = 2;
@@ -409,82 +909,76 @@ int VideoEncoder::openVideo()
         return -1; // return failure
     }
 #ifdef FFMPEG_2_7_6
-    // open video with codec context and codec
-    if (avcodec_open2(avCodecCtx, avCodec, NULL) < 0) 
-#else
-    // open video with codec context and codec
-    if (avcodec_open(avCodecCtx, avCodec) < 0) 
-#endif
+    // codec private options
+    AVDictionary *codecOpts = NULL;
+
+    // x264 preset, tune and rate control
+    if (avCodecCtx->codec_id == CODEC_ID_H264)
     {
-        fprintf(stderr, "Vencoder :: could not open video codec.\n");
-        return -1; //  return failure
-    }
+        char value[32];
 
-    // reset picture output buff
-    m_pictureOutBuf = NULL;
+        if (!m_encoderContext.preset.empty())
+            av_dict_set(&codecOpts, "preset", m_encoderContext.preset.c_str(), 0);
 
-    // check if output format is not RAW
-    if (!(m_avFmtCtx->oformat->flags & AVFMT_RAWPICTURE)) 
-    {
-        // MAX picture out buf size
-        m_pictureOutBufSize = 2000000;
+        // low latency, zerolatency tune turns off lookahead and b-frames and
+        // uses sliced threads, combined with a psy tune if given
+        std::string tune = m_encoderContext.tune;
+        if (m_encoderContext.lowLatency && tune.find("zerolatency") == std::string::npos)
+            tune = tune.empty() ? "zerolatency" : tune + ",zerolatency";
+
+        if (!tune.empty())
+            av_dict_set(&codecOpts, "tune", tune.c_str(), 0);
+
+        // intra refresh column moves over gop frames, instead of keyframes
+        if (m_encoderContext.intraRefresh)
+            av_dict_set(&codecOpts, "intra-refresh", "1", 0);
 
-        // allocat picture buff if not allocated
-        if (!m_pictureOutBuf) 
+        if (m_encoderContext.rateControl == RATE_CONTROL_CRF)
         {
-            m_pictureOutBuf = (uint8_t*)malloc(m_pictureOutBufSize);
+            snprintf(value, sizeof(value), "%d", m_encoderContext.crf);
+            av_dict_set(&codecOpts, "crf", value, 0);
+        }
+        else if (m_encoderContext.rateControl == RATE_CONTROL_CQP)
+        {
+            snprintf(value, sizeof(value), "%d", m_encoderContext.quality);
+            av_dict_set(&codecOpts, "qp", value, 0);
         }
     }
-
-    return 0; // return success
-}
-
-/**
- * @brief: Function to allocate memory to frame
- *
- * @return: Pointer the frame on succes, NULL on failure
- */
-AVFrame* VideoEncoder::allocFrame()
-{
-    // create frame and allocate memory 
-    AVFrame *avFrame = avcodec_alloc_frame();
-
-    // check if initialization was sucess and stream was initialized
-    if (!avFrame || !m_avStream)
+    else if (m_encoderContext.intraRefresh)
     {
-        fprintf(stderr, "Vencoder :: video frame/stream not initalized!!\n");
-        return NULL; // return faiture
+        fprintf(stderr, "\x1b[33m" "VideoEncoder:: Intra refresh not supported by codec, using keyframes\n" "\x1b[0m");
     }
 
-    // getting frame size
-    int size = avpicture_get_size((::PixelFormat)m_avStream->codec->pix_fmt, 
-                                 m_encoderContext.width, m_encoderContext.height);
+    // open video with codec context, codec and options
+    int openStatus = avcodec_open2(avCodecCtx, avCodec, &codecOpts);
+
+    // report options not consumed by codec
+    AVDictionaryEntry *optEntry = NULL;
+    while ((optEntry = av_dict_get(codecOpts, "", optEntry, AV_DICT_IGNORE_SUFFIX)))
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Option %s=%s not supported\n" "\x1b[0m", 
+                                                        optEntry->key, optEntry->value);
+    av_dict_free(&codecOpts);
 
-    // check and clear input picture buf
-    if (m_pictureInpBuf) 
+    // check if codec was opened
+    if (openStatus < 0) 
+#else
+    // open video with codec context and codec
+    if (avcodec_open(avCodecCtx, avCodec) < 0) 
+#endif
     {
-        free(m_pictureInpBuf);
-        m_pictureInpBuf = NULL;
+        fprintf(stderr, "Vencoder :: could not open video codec.\n");
+        return -1; //  return failure
     }
 
-    // allocate memory to picture buf
-    m_pictureInpBuf = (uint8_t*)malloc(size);
-
-    // check if memory was allocated successfully
-    if (!m_pictureInpBuf) 
+    // initialize frame pool for encoder format, frames are recycled per frame
+    if (m_framePool.init((::PixelFormat)avCodecCtx->pix_fmt, avCodecCtx->width, 
+                                                        avCodecCtx->height) < 0)
     {
-        // free frame
-        av_free(avFrame);
-        return NULL; // return failure
+        fprintf(stderr, "Vencoder :: could not initialize frame pool.\n");
+        return -1; //  return failure
     }
 
-    // fill frame 
-    avpicture_fill((AVPicture *)avFrame, m_pictureInpBuf,
-                    (::PixelFormat)m_avStream->codec->pix_fmt,
-                    m_encoderContext.width, m_encoderContext.height);
-
-    // return frame
-    return avFrame;
+    return 0; // return success
 }
 
 /**
@@ -509,22 +1003,15 @@ int VideoEncoder::initializeVideo()
  */
 int VideoEncoder::initEncoder() 
 {
-    // clear allocated spaces in encoder
-    cleanEncoder();
-
     // get output filename
     char *outputFile = (char *)m_encoderContext.outputVideoFile.c_str();
 
-    // encoder started, so reset frame count
+    // encoder started, so reset frame count and stats
     m_frameCount = 0;
+    m_stats.reset();
 
-#ifdef FFMPEG_2_7_6
     // guess encoder format
-    m_avOutFmt = av_guess_format(NULL, outputFile, NULL);
-#else
-    // guess encoder format
-    m_avOutFmt = guess_format(NULL, outputFile, NULL);
-#endif
+    m_avOutFmt = guessOutputFormat(m_encoderContext, outputFile);
 
     // check if output format was initialized
     if (!m_avOutFmt) 
@@ -533,17 +1020,14 @@ int VideoEncoder::initEncoder()
         return -1; // return failure
     }
 
-    // set video codec
-    m_avOutFmt->video_codec = CODEC_ID_NONE;
+    // set video codec, output format is shared by all encoders so it is
+    // not changed
+    m_codecId = getCodecId(m_encoderContext.codecStr);
 
     // check for output video codec. H264 and MPEG-4 are supported
-    if (!strcmp(m_encoderContext.codecStr.c_str(), "H264"))
-        m_avOutFmt->video_codec = CODEC_ID_H264;
-    else if (!strcmp(m_encoderContext.codecStr.c_str(), "MPEG-4"))
-        m_avOutFmt->video_codec = CODEC_ID_MSMPEG4V2;
-    else
+    if (m_codecId == CODEC_ID_NONE)
     {
-        m_avOutFmt->video_codec = CODEC_ID_H264;
+        m_codecId = CODEC_ID_H264;
         fprintf(stderr, "\x1b[31m" "VideoEncoder:: Video Codec not supported, Using H264\n" "\x1b[0m");
     }
 
@@ -565,45 +1049,259 @@ int VideoEncoder::initEncoder()
                                                     outputFile);
 
     // check and add stream to the video
-    if (m_avOutFmt->video_codec != CODEC_ID_NONE) 
+    if (m_codecId != CODEC_ID_NONE) 
     {
         m_avStream = addStream();
     }
 
-    // if stream was set sucess, open video for encoding
-    if (m_avStream) 
-    {
-        // open video for encoding
-        openVideo();
-    } 
-    else // video not opened 
+    // check if stream was set sucess
+    if (!m_avStream) 
     {
         fprintf(stderr, "\x1b[31m" "VideoEncoder:: Video Stream not initialized!!\n" "\x1b[0m");
+        freeOutput();
+        return -1; // return failure
+    }
+
+    // open video for encoding
+    if (openVideo() < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not open video codec\n" "\x1b[0m");
+        freeOutput();
+        return -1; // return failure
     }
 
     // check output format flag and open video url
-    if (!(m_avOutFmt->flags & AVFMT_NOFILE)) 
+    if (!(m_avOutFmt->flags & AVFMT_NOFILE) && openOutput(outputFile) < 0)
     {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Error in opening url\n" "\x1b[0m");
+        freeOutput();
+        return -1; // return failure
+    }
+
+    // write header information
+    if (writeHeader() < 0)
+    {
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not write header\n" "\x1b[0m");
+        freeOutput();
+        return -1; // return failure
+    }
+
+    return 0;
+}
+
+/**
+ * @brief: function to find output format of output file, segment muxer in
+ *          segmented mode, given container otherwise
+ *
+ * @params: output video options, output filename
+ *
+ * @return: output format, NULL if not found
+ */
+AVOutputFormat* VideoEncoder::guessOutputFormat(const VideoEncoderContext &encoderContext,
+                                                const char *outputFile)
+{
 #ifdef FFMPEG_2_7_6
-        // open video url
-        if (avio_open(&m_avFmtCtx->pb, outputFile, AVIO_FLAG_WRITE) < 0)
+    const char *formatName = NULL;
+
+    if (encoderContext.segmentFormat == SEGMENT_FORMAT_HLS)
+        formatName = "hls";
+    else if (encoderContext.segmentFormat == SEGMENT_FORMAT_DASH)
+        formatName = "dash";
+    else if (!encoderContext.containerFormat.empty())
+        formatName = encoderContext.containerFormat.c_str();
+    else if (strcmp(outputFile, "-") == 0)
+        formatName = "mpegts"; // piped output, no filename extension
+
+    return av_guess_format(formatName, outputFile, NULL);
 #else
-        // open video url
-        if (url_fopen(&m_avFmtCtx->pb, outputFile, URL_WRONLY) < 0)
+    return guess_format(NULL, outputFile, NULL);
 #endif
-            fprintf(stderr, "\x1b[31m" "VideoEncoder:: Error in opening url\n" "\x1b[0m");
+}
+
+/**
+ * @brief: function to write header with muxer options. segment muxers keep
+ *          every segment in playlist/manifest and rewrite it after every
+ *          segment, so segments can be served while encoding goes on
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int VideoEncoder::writeHeader()
+{
+#ifdef FFMPEG_2_7_6
+    // muxer private options
+    AVDictionary *muxerOpts = NULL;
+    char value[32];
+
+    if (m_encoderContext.segmentFormat == SEGMENT_FORMAT_HLS)
+    {
+        snprintf(value, sizeof(value), "%.3f", m_encoderContext.segmentTime);
+        av_dict_set(&muxerOpts, "hls_time", value, 0);
+        av_dict_set(&muxerOpts, "hls_list_size", "0", 0);
     }
+    else if (m_encoderContext.segmentFormat == SEGMENT_FORMAT_DASH)
+    {
+        snprintf(value, sizeof(value), "%lld", (long long)(m_encoderContext.segmentTime * AV_TIME_BASE));
+        av_dict_set(&muxerOpts, "min_seg_duration", value, 0);
+        av_dict_set(&muxerOpts, "window_size", "0", 0);
+
+        // segment names from manifest name, renditions of a ladder share directory
+        std::string baseName = m_encoderContext.outputVideoFile;
+        size_t pos = baseName.find_last_of("./");
+        if (pos != std::string::npos && baseName[pos] == '.')
+            baseName = baseName.substr(0, pos);
+
+        pos = baseName.find_last_of('/');
+        if (pos != std::string::npos)
+            baseName = baseName.substr(pos + 1);
+
+        av_dict_set(&muxerOpts, "init_seg_name", (baseName + "-init$RepresentationID$.m4s").c_str(), 0);
+        av_dict_set(&muxerOpts, "media_seg_name", (baseName + "-$RepresentationID$-$Number%05d$.m4s").c_str(), 0);
+    }
+
+    // streamed output can not seek back to header, mp4 is written as
+    // fragments with an empty moov up front
+    bool streamedOutput = m_outputCallback || m_encoderContext.outputVideoFile == "-";
+    if (streamedOutput && (strcmp(m_avOutFmt->name, "mp4") == 0 || strcmp(m_avOutFmt->name, "mov") == 0))
+        av_dict_set(&muxerOpts, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
 
+    // low latency, packets are written out as muxed, not held for interleaving
+    if (m_encoderContext.lowLatency)
+    {
+        m_avFmtCtx->max_delay = 0;
+        m_avFmtCtx->flush_packets = 1;
+    }
+
+    int headerStatus = avformat_write_header(m_avFmtCtx, &muxerOpts);
+
+    // report options not consumed by muxer
+    AVDictionaryEntry *optEntry = NULL;
+    while ((optEntry = av_dict_get(muxerOpts, "", optEntry, AV_DICT_IGNORE_SUFFIX)))
+        fprintf(stderr, "\x1b[31m" "VideoEncoder:: Option %s=%s not supported\n" "\x1b[0m", 
+                                                        optEntry->key, optEntry->value);
+    av_dict_free(&muxerOpts);
+
+    return headerStatus < 0 ? -1 : 0;
+#else
+    return av_write_header(m_avFmtCtx) < 0 ? -1 : 0;
+#endif
+}
+/**
+ * @brief: function to open output file of format context, through async
+ *          writer if enabled, ffmpeg file i/o otherwise
+ *
+ * @params: output filename
+ *
+ * @return: returns -1 on failure, 0 on success
+ */
+int VideoEncoder::openOutput(const char *outputFile)
+{
 #ifdef FFMPEG_2_7_6
-    // write header information
-    avformat_write_header(m_avFmtCtx, NULL);
+    // write output to memory buffer or callback, "-" is piped output to stdout
+    if (m_outputBuffer || m_outputCallback || strcmp(outputFile, "-") == 0)
+    {
+        int memoryStatus = m_outputBuffer ? m_memoryIO.openOutput(m_outputBuffer) :
+                           m_outputCallback ? m_memoryIO.openOutput(m_outputCallback) :
+                                              m_memoryIO.openOutput(&MemoryIO::writeStdout);
+        if (memoryStatus < 0)
+            return -1; // return failure
+
+        m_avFmtCtx->pb = m_memoryIO.getAVIOContext();
+        return 0; // return success
+    }
+
+    // write output through async writer, ffmpeg file i/o if it fails
+    if (m_encoderContext.writeBufferSize > 0)
+    {
+        if (m_writerIO.open(outputFile, m_encoderContext.writeBufferSize,
+                            m_encoderContext.preallocSize) == 0)
+        {
+            m_avFmtCtx->pb = m_writerIO.getAVIOContext();
+            return 0; // return success
+        }
+
+        fprintf(stderr, "\x1b[33m" "VideoEncoder:: Async writer failed, using file i/o\n" "\x1b[0m");
+    }
+
+    // open video url
+    if (avio_open(&m_avFmtCtx->pb, outputFile, AVIO_FLAG_WRITE) < 0)
 #else
-    // write header information
-    av_write_header(m_avFmtCtx);
+    // open video url
+    if (url_fopen(&m_avFmtCtx->pb, outputFile, URL_WRONLY) < 0)
 #endif
+        return -1; // return failure
 
-    return 0;
+    return 0; // return success
+}
+
+/**
+ * @brief: function to close output file of format context, async writer
+ *          writes its buffered bytes first
+ */
+void VideoEncoder::closeOutput()
+{
+    // memory output
+    if (m_memoryIO.isOpen())
+    {
+        if (m_memoryIO.close() < 0)
+            fprintf(stderr, "\x1b[31m" "VideoEncoder:: Could not write memory output\n" "\x1b[0m");
+
+        m_avFmtCtx->pb = NULL;
+        return;
+    }
+
+    // async writer output
+    if (m_writerIO.isOpen())
+    {
+        m_writerIO.close();
+        m_avFmtCtx->pb = NULL;
+
+        // time muxer waited for writer
+        const StageStats &waitStats = m_writerIO.getWaitStats();
+        m_stats.outputWait = waitStats;
+
+        fprintf(stderr, "\x1b[32m" "VideoEncoder:: Async writer: %.1f MB in %d writes, %d seeks, "
+                        "waited %.2f ms\n" "\x1b[0m",
+                        m_writerIO.getBytesWritten() / (1024.0 * 1024.0), m_writerIO.getWrites(),
+                        m_writerIO.getSeeks(), waitStats.getTotal() / 1000.0);
+        return;
+    }
+
+#ifdef FFMPEG_2_7_6
+    avio_close(m_avFmtCtx->pb);
+#else
+    url_fclose(m_avFmtCtx->pb);
+#endif
 }
+
+/**
+ * @brief: function to free output of a failed start, codec is closed,
+ *          output file is closed and format context is freed. nothing is
+ *          written, so video can not be finalized afterwards
+ */
+void VideoEncoder::freeOutput()
+{
+    // check if format context was allocated
+    if (!m_avFmtCtx)
+        return;
+
+    // close codec, stream and its codec context are freed with format context
+    if (m_avStream && m_avStream->codec)
+        avcodec_close(m_avStream->codec);
+
+    // close output url if it was opened
+    if (m_avFmtCtx->pb && !(m_avOutFmt->flags & AVFMT_NOFILE))
+        closeOutput();
+
+#ifdef FFMPEG_2_7_6
+    avformat_free_context(m_avFmtCtx);
+#else
+    av_free(m_avFmtCtx);
+#endif
+
+    m_avFmtCtx = NULL;
+    m_avStream = NULL;
+}
+
 /**
  * @brief: Function to finalize output video
  */
@@ -612,6 +1310,17 @@ void VideoEncoder::finalizeVideo()
     // check if video stream was set successfuly
     if (m_avStream && m_avStream->index == 0 && m_avStream->id == 0) 
     {
+        // write frames delayed in encoder
+        flushEncoder();
+
+        // encoder latency of low latency output
+        if (m_encoderContext.lowLatency && m_stats.encodeLatency.getCount() > 0)
+            fprintf(stderr, "\x1b[32m" "VideoEncoder:: Encoder latency avg %.2f ms, p99 %.2f ms, "
+                            "max %lld frames held\n" "\x1b[0m", 
+                            m_stats.encodeLatency.getAverage() / 1000.0,
+                            m_stats.encodeLatency.getPercentile(99) / 1000.0,
+                            (long long)m_stats.encodeDelay.getMax());
+
         // write trailer
         av_write_trailer(m_avFmtCtx);
 
@@ -649,29 +1358,25 @@ void VideoEncoder::finalizeVideo()
                 av_freep(&m_avFmtCtx->streams[i]);
             }
 
-            // if video url was open, close it
-            if (!(m_avOutFmt->flags & AVFMT_NOFILE)) 
+            // streams are freed, not freed again with format context
+            m_avFmtCtx->nb_streams = 0;
+        }
+
+        // if video url was open, close it
+        if (!(m_avOutFmt->flags & AVFMT_NOFILE)) 
+            closeOutput();
+
+        // free format context, encoder may be started again
 #ifdef FFMPEG_2_7_6
-                 avio_close(m_avFmtCtx->pb);
+        avformat_free_context(m_avFmtCtx);
 #else
-                url_fclose(m_avFmtCtx->pb);
+        av_free(m_avFmtCtx);
 #endif
-        }
+        m_avFmtCtx = NULL;
+
+        // stream is freed, video can not be finalized again
+        m_avStream = NULL;
     }
     
     fprintf(stderr, "\x1b[32m" "VideoEncoder:: Video finalize success!!\n" "\x1b[0m");
 }
-
-/**
- * @brief: Function clean picture buffer
- */
-void VideoEncoder::cleanEncoder() 
-{
-    // if output picture buf was allocated, free and set picture out buffer size to 0
-    if (m_pictureOutBuf) 
-    {
-        av_free(m_pictureOutBuf);
-        m_pictureOutBuf = NULL;
-        m_pictureOutBufSize = 0;
-    }
-}
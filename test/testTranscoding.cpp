@@ -8,12 +8,23 @@
 **/
 
 #include <iostream>
+#include <sstream>
 #include <vector>
 
 #include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
 
 #include "VideoDecoder.h"
 #include "VideoEncoder.h"
+#include "TranscodePipeline.h"
+#include "BatchTranscoder.h"
+#include "SegmentTranscoder.h"
+#include "LadderTranscoder.h"
+#include "FrameRateFilter.h"
+#include "Thumbnailer.h"
+#include "KeyFrameIndex.h"
+#include "TranscodeServer.h"
 
 #define MAJOR_VERSION 1.0
 #define MINOR_VERSION 1.2
@@ -29,6 +40,21 @@ void printHelp();
 // function to get all filenames from directory
 int getAllFiles(const char *rootPath, vector<string> &path, bool searchRec);
 
+// function to parse time as seconds or hh:mm:ss
+double parseTime(const char *timeStr);
+
+// function to make path absolute, relative to current directory
+string getAbsolutePath(const string &path);
+
+// flag set by SIGINT/SIGTERM to stop daemon
+static volatile sig_atomic_t stopDaemon = 0;
+
+// signal handler of daemon mode
+static void onStopSignal(int)
+{
+    stopDaemon = 1;
+}
+
 // main starts here
 int main(int argc, char**argv)
 {
@@ -44,8 +70,8 @@ int main(int argc, char**argv)
     // output video format
     string encodeFormat = "MPEG-4";
 
-    // output video frame rate
-    int frameRate = 15;
+    // output video frame rate, 0 = input frame rate
+    int frameRate = 0;
 
     // output video quality
     int quality = 2;
@@ -53,6 +79,53 @@ int main(int argc, char**argv)
     // flag to control serching of files in directory
     int searchFiles = 0;
 
+    // video decoder options
+    VideoDecoderContext decoderContext;
+
+    // video encoder context object 
+    VideoEncoderContext encoderContext;
+
+    // queue size of pipelined transcoding, 0 = serial
+    int pipelineQueue = 0;
+
+    // no of concurrent batch jobs, 0 = all inputs into one output
+    int batchJobs = 0;
+
+    // output filename template of batch jobs
+    string outputTemplate = "";
+
+    // no of segments encoded in parallel, 0 = no segmenting
+    int segments = 0;
+
+    // renditions of bit rate ladder, height[:kbps] list, empty = no ladder
+    string ladder = "";
+
+    // copy packets when input is already in output format and no encode
+    // option is given, -copy forces or turns off copying
+    int streamCopy = STREAM_COPY_AUTO;
+
+    // range of input to transcode (seconds), <= 0 = whole video
+    double startTime = 0.0;
+    double duration = 0.0;
+    double endTime = 0.0;
+
+    // no of concurrent keyframe index builds, 0 = no indexing
+    int indexJobs = 0;
+
+    // socket path of daemon mode and of its clients, empty = no daemon
+    string daemonSocket = "";
+    string submitSocket = "";
+
+    // json report of stage stats, empty = no report
+    string reportFile = "";
+
+    // thumbnail options, sampling is on if interval or count is given
+    ThumbnailContext thumbnailContext;
+    bool thumbnails = false;
+
+    // decoder thread type given, not chosen for low latency
+    bool decoderThreadType = false;
+
     // vector to store all file names
     vector<string> allFiles;
 
@@ -88,10 +161,140 @@ int main(int argc, char**argv)
             outputFile = argv[i+1];
         else if (i <= argc and strcmp(argv[i], "-f") == 0)
             encodeFormat = argv[i+1];
+        else if (i <= argc and strcmp(argv[i], "-s") == 0)
+        {
+            if (sscanf(argv[i+1], "%dx%d", &encoderContext.width, &encoderContext.height) != 2)
+            {
+                cout << "Output size: " << argv[i+1] << " not supported(WxH, -1 keeps aspect ratio)." << endl;
+                return -1;
+            }
+        }
+        else if (i <= argc and strcmp(argv[i], "-sm") == 0)
+        {
+            if (strcmp(argv[i+1], "stretch") == 0)
+                encoderContext.scaleMode = SCALE_MODE_STRETCH;
+            else if (strcmp(argv[i+1], "fit") == 0)
+                encoderContext.scaleMode = SCALE_MODE_FIT;
+            else
+            {
+                cout << "Scale mode: " << argv[i+1] << " not supported(stretch/fit)." << endl;
+                return -1;
+            }
+        }
+        else if (i <= argc and strcmp(argv[i], "-lowres") == 0)
+            decoderContext.lowres = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-wb") == 0)
+            encoderContext.writeBufferSize = atoi(argv[i+1]) * 1024 * 1024;
+        else if (i <= argc and strcmp(argv[i], "-ll") == 0)
+            encoderContext.lowLatency = atoi(argv[i+1]) != 0;
+        else if (i <= argc and strcmp(argv[i], "-ir") == 0)
+            encoderContext.intraRefresh = atoi(argv[i+1]) != 0;
+        else if (i <= argc and strcmp(argv[i], "-fmt") == 0)
+            encoderContext.containerFormat = argv[i+1];
+        else if (i <= argc and strcmp(argv[i], "-sf") == 0)
+        {
+            if (strcmp(argv[i+1], "hls") == 0)
+                encoderContext.segmentFormat = SEGMENT_FORMAT_HLS;
+            else if (strcmp(argv[i+1], "dash") == 0)
+                encoderContext.segmentFormat = SEGMENT_FORMAT_DASH;
+            else
+            {
+                cout << "Segment format: " << argv[i+1] << " not supported(hls/dash)." << endl;
+                return -1;
+            }
+        }
+        else if (i <= argc and strcmp(argv[i], "-sd") == 0)
+            encoderContext.segmentTime = atof(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-ra") == 0)
+            decoderContext.readaheadSize = atoi(argv[i+1]) * 1024 * 1024;
         else if (i <= argc and strcmp(argv[i], "-r") == 0)
             frameRate = atoi(argv[i+1]);
         else if (i <= argc and strcmp(argv[i], "-q") == 0)
             quality = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-dt") == 0)
+            decoderContext.threadCount = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-dtt") == 0)
+        {
+            decoderThreadType = true;
+
+            if (strcmp(argv[i+1], "frame") == 0)
+                decoderContext.threadType = FF_THREAD_FRAME;
+            else if (strcmp(argv[i+1], "slice") == 0)
+                decoderContext.threadType = FF_THREAD_SLICE;
+            else
+            {
+                cout << "Decoder thread type: " << argv[i+1] << " not supported(frame/slice)." << endl;
+                return -1;
+            }
+        }
+        else if (i <= argc and strcmp(argv[i], "-pl") == 0)
+            pipelineQueue = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-j") == 0)
+            batchJobs = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-daemon") == 0)
+            daemonSocket = argv[i+1];
+        else if (i <= argc and strcmp(argv[i], "-submit") == 0)
+            submitSocket = argv[i+1];
+        else if (i <= argc and strcmp(argv[i], "-ot") == 0)
+            outputTemplate = argv[i+1];
+        else if (i <= argc and strcmp(argv[i], "-seg") == 0)
+            segments = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-ladder") == 0)
+            ladder = argv[i+1];
+        else if (i <= argc and strcmp(argv[i], "-copy") == 0)
+            streamCopy = atoi(argv[i+1]) ? STREAM_COPY_FORCE : STREAM_COPY_NONE;
+        else if (i <= argc and strcmp(argv[i], "-report") == 0)
+            reportFile = argv[i+1];
+        else if (i <= argc and strcmp(argv[i], "-index") == 0)
+            indexJobs = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-ss") == 0)
+            startTime = parseTime(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-t") == 0)
+            duration = parseTime(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-to") == 0)
+            endTime = parseTime(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-thumb") == 0)
+        {
+            thumbnailContext.interval = atof(argv[i+1]);
+            thumbnails = true;
+        }
+        else if (i <= argc and strcmp(argv[i], "-tn") == 0)
+        {
+            thumbnailContext.count = atoi(argv[i+1]);
+            thumbnails = true;
+        }
+        else if (i <= argc and strcmp(argv[i], "-tw") == 0)
+            thumbnailContext.width = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-tc") == 0)
+            thumbnailContext.columns = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-tk") == 0)
+            thumbnailContext.keyFrameOnly = atoi(argv[i+1]) != 0;
+        else if (i <= argc and strcmp(argv[i], "-et") == 0)
+            encoderContext.threadCount = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-preset") == 0)
+            encoderContext.preset = argv[i+1];
+        else if (i <= argc and strcmp(argv[i], "-tune") == 0)
+            encoderContext.tune = argv[i+1];
+        else if (i <= argc and strcmp(argv[i], "-crf") == 0)
+            encoderContext.crf = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-b") == 0)
+            encoderContext.bitRate = atoi(argv[i+1]) * 1000;
+        else if (i <= argc and strcmp(argv[i], "-g") == 0)
+            encoderContext.gopSize = atoi(argv[i+1]);
+        else if (i <= argc and strcmp(argv[i], "-rc") == 0)
+        {
+            if (strcmp(argv[i+1], "cqp") == 0)
+                encoderContext.rateControl = RATE_CONTROL_CQP;
+            else if (strcmp(argv[i+1], "crf") == 0)
+                encoderContext.rateControl = RATE_CONTROL_CRF;
+            else if (strcmp(argv[i+1], "abr") == 0)
+                encoderContext.rateControl = RATE_CONTROL_ABR;
+            else
+            {
+                cout << "Rate control: " << argv[i+1] << " not supported(cqp/crf/abr)." << endl;
+                return -1;
+            }
+        }
         else
         {
             cout << "Prameter: " << argv[i] << " not supported(type " << argv[0] << " -h for help)." << endl;
@@ -99,6 +302,56 @@ int main(int argc, char**argv)
         }
     }
 
+    // piped output, stdout carries video only, so messages go to stderr. a
+    // closed reader fails the write instead of killing the process
+    if (outputFile == "-")
+    {
+        cout.rdbuf(cerr.rdbuf());
+        signal(SIGPIPE, SIG_IGN);
+    }
+
+    // low latency, frame threads of decoder hold frames too
+    if (encoderContext.lowLatency && !decoderThreadType)
+        decoderContext.threadType = FF_THREAD_SLICE;
+
+    // time stages only if they are reported
+    StageStats::setEnabled(!reportFile.empty());
+
+    // end of range, duration overrides end time
+    if (duration > 0)
+        endTime = startTime + duration;
+
+    if (endTime > 0 && endTime <= startTime)
+    {
+        cout << "End time: " << endTime << " must be after start time: " << startTime << endl;
+        return -1;
+    }
+
+    // daemon mode, jobs of local clients on a pool of workers until stopped
+    if (!daemonSocket.empty())
+    {
+        // accept is interrupted, not restarted, on stop signals
+        struct sigaction stopAction;
+        memset(&stopAction, 0, sizeof(stopAction));
+        stopAction.sa_handler = onStopSignal;
+        sigaction(SIGINT, &stopAction, NULL);
+        sigaction(SIGTERM, &stopAction, NULL);
+        signal(SIGPIPE, SIG_IGN);
+
+        TranscodeServer transcodeServer(batchJobs);
+        if (transcodeServer.start(daemonSocket) < 0)
+            return -1; // return failure
+
+        int runStatus = 0;
+        while (!stopDaemon && (runStatus = transcodeServer.run()) == 0 && !stopDaemon)
+            ;
+
+        // running and queued jobs are finished first
+        transcodeServer.stop();
+
+        return runStatus;
+    }
+
     // check for search option and perform accordinly
     if (searchFiles) 
     {
@@ -118,20 +371,291 @@ int main(int argc, char**argv)
         return -1; // return failure
     }
  
+    // index mode, keyframe index file next to every input
+    if (indexJobs > 0)
+        return KeyFrameIndex::buildAll(allFiles, indexJobs) ? -1 : 0;
+
+    // client mode, every input is a job of daemon, one output per input
+    if (!submitSocket.empty())
+    {
+        if (allFiles.empty())
+        {
+            cout << "Please provide source video file(type " << argv[0] << " -h for help)." << endl;
+            return -1; // return failure
+        }
+
+        // one input into -o, more inputs named from template
+        if (outputTemplate.empty() && allFiles.size() > 1)
+        {
+            size_t pos = outputFile.find_last_of('.');
+            outputTemplate = "%n_out" + (pos != string::npos ? outputFile.substr(pos) : ".avi");
+        }
+
+        vector<TranscodeJob> jobs;
+        for (size_t i = 0; i < allFiles.size(); i++)
+        {
+            TranscodeJob job;
+            job.decoderContext = decoderContext;
+            job.encoderContext = encoderContext;
+            job.encoderContext.codecStr = encodeFormat;
+            job.encoderContext.frameRate = frameRate;
+            job.encoderContext.quality = quality;
+            job.pipelineQueue = pipelineQueue;
+            job.streamCopy = streamCopy;
+            job.startTime = startTime;
+            job.endTime = endTime;
+
+            // daemon runs in its own directory
+            job.inputFile = getAbsolutePath(allFiles[i]);
+            job.outputFile = getAbsolutePath(outputTemplate.empty() ? outputFile :
+                        BatchTranscoder::makeOutputName(outputTemplate, allFiles[i], (int)i));
+            jobs.push_back(job);
+        }
+
+        // jobs must not share an output file
+        if (BatchTranscoder::checkOutputNames(jobs) < 0)
+            return -1; // return failure
+
+        TranscodeClient transcodeClient;
+        if (transcodeClient.connect(submitSocket) < 0)
+            return -1; // return failure
+
+        vector<TranscodeResult> results;
+        int failedJobs = transcodeClient.run(jobs, results);
+
+        cout << "Daemon jobs    :   " << jobs.size() << " (" << failedJobs << " failed)" << endl;
+
+        if (!reportFile.empty() && failedJobs >= 0)
+            Transcoder::writeReport(reportFile, results);
+
+        return failedJobs ? -1 : 0;
+    }
+
+    // batch mode, one output per input on a pool of workers
+    if (batchJobs > 0)
+    {
+        // default template, input name with extension of output video
+        if (outputTemplate.empty())
+        {
+            size_t pos = outputFile.find_last_of('.');
+            outputTemplate = "%n_out" + (pos != string::npos ? outputFile.substr(pos) : ".avi");
+        }
+
+        // options common to all jobs
+        TranscodeJob jobTemplate;
+        jobTemplate.decoderContext = decoderContext;
+        jobTemplate.encoderContext = encoderContext;
+        jobTemplate.encoderContext.codecStr = encodeFormat;
+        jobTemplate.encoderContext.frameRate = frameRate;
+        jobTemplate.encoderContext.quality = quality;
+        jobTemplate.pipelineQueue = pipelineQueue;
+        jobTemplate.streamCopy = streamCopy;
+        jobTemplate.startTime = startTime;
+        jobTemplate.endTime = endTime;
+
+        // run all jobs
+        BatchTranscoder batchTranscoder(batchJobs);
+        batchTranscoder.addJobs(allFiles, outputTemplate, jobTemplate);
+
+        int failedJobs = batchTranscoder.run();
+        batchTranscoder.printSummary();
+
+        if (!reportFile.empty())
+            Transcoder::writeReport(reportFile, batchTranscoder.getResults());
+
+        return failedJobs ? -1 : 0;
+    }
+
+    // thumbnail mode, sampled frames as images or a contact sheet
+    if (thumbnails)
+    {
+        // output image, unless output video was given
+        if (outputFile != "sample.avi")
+            thumbnailContext.outputFile = outputFile;
+
+        thumbnailContext.quality = quality;
+
+        int failedFiles = 0;
+        for (int file = 0; file < (int)allFiles.size(); file++)
+        {
+            // one output per input
+            ThumbnailContext fileContext = thumbnailContext;
+            if (allFiles.size() > 1)
+            {
+                // input name before output filename
+                string nameTemplate = thumbnailContext.outputFile;
+                size_t pos = nameTemplate.find_last_of('/');
+                nameTemplate.insert(pos == string::npos ? 0 : pos + 1, "%n_");
+
+                fileContext.outputFile = BatchTranscoder::makeOutputName(nameTemplate, 
+                                                                allFiles[file], file);
+            }
+
+            Thumbnailer thumbnailer(fileContext);
+            if (thumbnailer.extract(allFiles[file], decoderContext) <= 0)
+                failedFiles++;
+        }
+
+        return failedFiles ? -1 : 0;
+    }
+
+    // ladder mode, one input decoded once into many renditions
+    if (!ladder.empty())
+    {
+        if (allFiles.size() != 1)
+        {
+            cout << "Ladder transcoding needs one input video(type " << argv[0] << " -h for help)." << endl;
+            return -1; // return failure
+        }
+
+        TranscodeJob job;
+        job.inputFile = allFiles[0];
+        job.decoderContext = decoderContext;
+        job.startTime = startTime;
+        job.endTime = endTime;
+
+        // output name of rendition, height before extension of output video
+        string baseName = outputFile;
+        string extension = "";
+        size_t pos = baseName.find_last_of("./");
+        if (pos != string::npos && baseName[pos] == '.')
+        {
+            extension = baseName.substr(pos);
+            baseName = baseName.substr(0, pos);
+        }
+
+        // one rendition per height[:kbps]
+        vector<VideoEncoderContext> renditions;
+        stringstream ladderStream(ladder);
+        string step;
+        while (getline(ladderStream, step, ','))
+        {
+            int height = 0, bitRate = 0;
+            if (sscanf(step.c_str(), "%d:%d", &height, &bitRate) < 1 || height <= 0)
+            {
+                cout << "Ladder step: " << step << " not supported(height[:kbps])." << endl;
+                return -1;
+            }
+
+            VideoEncoderContext rendition = encoderContext;
+            rendition.outputVideoFile = baseName + "_" + to_string(height) + "p" + extension;
+            rendition.codecStr = encodeFormat;
+            rendition.frameRate = frameRate;
+            rendition.quality = quality;
+            rendition.width = -1;
+            rendition.height = height;
+
+            // average bit rate of rendition
+            if (bitRate > 0)
+            {
+                rendition.rateControl = RATE_CONTROL_ABR;
+                rendition.bitRate = bitRate * 1000;
+            }
+
+            renditions.push_back(rendition);
+        }
+
+        LadderTranscoder ladderTranscoder(pipelineQueue > 0 ? pipelineQueue : 8);
+
+        vector<TranscodeResult> results;
+        int status = ladderTranscoder.transcode(job, renditions, results);
+
+        for (size_t i = 0; i < results.size(); i++)
+            cout << "Rendition      :   " << results[i].outputFile << " " << results[i].frames
+                 << " frames in " << results[i].elapsedTime << " sec ("
+                 << (results[i].status == 0 ? "OK" : "FAILED") << ")" << endl;
+
+        if (!reportFile.empty())
+            Transcoder::writeReport(reportFile, results);
+
+        return status < 0 ? -1 : 0;
+    }
+
+    // segment mode, one input split at keyframes and encoded in parallel
+    if (segments > 0)
+    {
+        if (allFiles.size() != 1)
+        {
+            cout << "Segmented transcoding needs one input video(type " << argv[0] << " -h for help)." << endl;
+            return -1; // return failure
+        }
+
+        TranscodeJob job;
+        job.inputFile = allFiles[0];
+        job.outputFile = outputFile;
+        job.decoderContext = decoderContext;
+        job.encoderContext = encoderContext;
+        job.encoderContext.codecStr = encodeFormat;
+        job.encoderContext.frameRate = frameRate;
+        job.encoderContext.quality = quality;
+        job.pipelineQueue = pipelineQueue;
+        job.startTime = startTime;
+        job.endTime = endTime;
+
+        SegmentTranscoder segmentTranscoder(segments);
+
+        TranscodeResult result;
+        segmentTranscoder.transcode(job, result);
+
+        cout << "Segmented      :   " << result.frames << " frames in " << result.elapsedTime 
+             << " sec (" << (result.status == 0 ? "OK" : "FAILED") << ")" << endl;
+
+        if (!reportFile.empty())
+            Transcoder::writeReport(reportFile, vector<TranscodeResult>(1, result));
+
+        return result.status;
+    }
+
+    // remux mode, one input already in output codec, size and frame rate. piped
+    // input can not be probed first, so it is always re-encoded
+    if (streamCopy && allFiles.size() == 1 && allFiles[0] != "-")
+    {
+        TranscodeJob job;
+        job.inputFile = allFiles[0];
+        job.outputFile = outputFile;
+        job.encoderContext = encoderContext;
+        job.encoderContext.outputVideoFile = outputFile;
+        job.encoderContext.codecStr = encodeFormat;
+        job.encoderContext.frameRate = frameRate;
+        job.encoderContext.quality = quality;
+        job.startTime = startTime;
+        job.endTime = endTime;
+
+        // check input without decoding
+        VideoDecoder probeDecoder;
+        bool remuxVideo = probeDecoder.openVideo(job.inputFile) >= 0 &&
+                          Transcoder::canRemux(probeDecoder, job.encoderContext, streamCopy);
+        probeDecoder.closeVideo();
+
+        if (remuxVideo)
+        {
+            TranscodeResult result;
+            Transcoder::remux(job, result);
+
+            cout << "Stream copy    :   " << result.frames << " packets in " << result.elapsedTime 
+                 << " sec (" << (result.status == 0 ? "OK" : "FAILED") << ")" << endl;
+
+            if (!reportFile.empty())
+                Transcoder::writeReport(reportFile, vector<TranscodeResult>(1, result));
+
+            return result.status;
+        }
+    }
+
     // Create object of video decoder
     VideoDecoder videoDecoder;
 
     // create object of video encoder
     VideoEncoder videoEncoder;
-            
-    // video encoder context object 
-    VideoEncoderContext encoderContext;
 
     // encoding status
     int encodeStatus = -1;
 
-    // rgb frame to decode and encode
-    unsigned char *rgbFrame = NULL;
+    // decoded frame, references decoder planes
+    AVFrame *decodedFrame = av_frame_alloc();
+
+    // result of every input, for report
+    vector<TranscodeResult> results;
 
     // loop for all video files
     for (int file = 0; file < (int)allFiles.size(); file++)
@@ -140,17 +664,42 @@ int main(int argc, char**argv)
         inputFile = allFiles[file];
 
         cout << "Current Source Video = " << inputFile << endl;
+
+        // result of this input
+        TranscodeResult fileResult;
+        fileResult.inputFile = inputFile;
+        fileResult.outputFile = outputFile;
+        int64_t fileStartTime = av_gettime_relative();
         
-        // open video for decoding
-        int videoStatus = videoDecoder.openVideo(inputFile);
+        // output options of this video, size and frame rate are resolved from input
+        VideoEncoderContext fileContext = encoderContext;
+        fileContext.outputVideoFile = outputFile;
+        fileContext.codecStr = encodeFormat;
+        fileContext.frameRate = frameRate;
+        fileContext.quality = quality;
+
+        // open video for decoding, at reduced size if output is small enough
+        int videoStatus = Transcoder::openInput(videoDecoder, inputFile, decoderContext, fileContext);
         
         // check opening vidoe was success
         if (videoStatus == -1)
         {
             cout << "Could not find video: " << inputFile << endl;
+            results.push_back(fileResult);
             //return -1;
             continue;
         }
+
+        // transcode range of video only, frame accurate
+        if (startTime > 0 && videoDecoder.seek(startTime) < 0)
+        {
+            cout << "Could not seek video: " << inputFile << " to " << startTime << " sec" << endl;
+            videoDecoder.closeVideo();
+            results.push_back(fileResult);
+            continue;
+        }
+
+        videoDecoder.setEndTime(endTime);
         
         // get video input video info in struct videoinfo
         VideoInfo videoInfo;
@@ -162,27 +711,18 @@ int main(int argc, char**argv)
         cout << "Width          :   " << videoInfo.width << endl;
         cout << "Height         :   " << videoInfo.height << endl;
         cout << "Output Video   :   " << outputFile << endl;
+        cout << "Output Size    :   " << fileContext.width << "x" << fileContext.height << endl;
         cout << "Format         :   " << encodeFormat << endl;
-        cout << "FrameRate      :   " << frameRate << endl;
+        cout << "FrameRate      :   " << fileContext.frameRate << endl;
         cout << "Quality        :   " << quality << endl;
+        cout << "Preset/Tune    :   " << (encoderContext.preset.empty() ? "none" : encoderContext.preset)
+                           << "/" << (encoderContext.tune.empty() ? "none" : encoderContext.tune) << endl;
         cout << "==============================================" << endl;
 
-        // set encoder context for output video
-        encoderContext.outputVideoFile = outputFile;
-        encoderContext.codecStr = encodeFormat;
-        encoderContext.width = videoInfo.width;
-        encoderContext.height = videoInfo.height;
-        encoderContext.frameRate = frameRate;
-        encoderContext.quality = quality;
-
-        // allocate memory to rgbframe, if not allocated
-        if (!rgbFrame) 
-            rgbFrame = new unsigned char[videoInfo.width * videoInfo.height * 3];
-
-        // set encoder context if not set
+        // set encoder context if not set, first video sets output size
         if (!videoEncoder.encoderCtxSet())
         {
-            videoEncoder.setEncoderContext(encoderContext);
+            videoEncoder.setEncoderContext(fileContext);
             encodeStatus = videoEncoder.startVideoEncode();
         }
 
@@ -191,23 +731,71 @@ int main(int argc, char**argv)
         {
             cout << "Could not startEncoding: status = " << encodeStatus << endl;
         }
+        else if (pipelineQueue > 0)
+        {
+            // decode, convert and encode on separate threads
+            TranscodePipeline pipeline(videoDecoder, videoEncoder, pipelineQueue);
+
+            // run pipeline until end of video
+            if (pipeline.run() < 0)
+                cout << "Could not transcode video: " << inputFile << endl;
+            else
+                fileResult.status = 0;
+
+            // printing pipeline statistics
+            PipelineStats stats = pipeline.getStats();
+            fileResult.frames = stats.encodedFrames;
+            fileResult.stats.add(stats.stageStats);
+
+            cout << "Pipeline       :   " << stats.encodedFrames << " frames (" 
+                 << stats.droppedFrames << " dropped) in " 
+                 << stats.elapsedTime << " sec (max queue " << stats.maxDecodeQueue 
+                 << "/" << stats.maxEncodeQueue << ")" << endl;
+        }
         else
         {
-            // get a new frame from the video
-            while (videoDecoder.getNewFrame(rgbFrame) > 0)
+            // selects decoded frames for output frame rate, the encoder was
+            // started with rate of first video, later videos are converted to it
+            FrameRateFilter frameRateFilter;
+            frameRateFilter.init(videoDecoder, videoEncoder.getFrameRate());
+
+            fileResult.status = 0;
+
+            // get a new frame from the video, in decoder pixel format
+            while (videoDecoder.getNewFrame(decodedFrame) > 0)
             {
-                // add newly fetched frame to the output video
-                int size = videoEncoder.addNewFrame(rgbFrame);
+                // no of output frames, dropped frames are not converted
+                int copies = frameRateFilter.filterFrame(
+                                av_frame_get_best_effort_timestamp(decodedFrame));
+
+                // add newly fetched frame to the output video, converted only if needed
+                int size = 0;
+                for (int copy = 0; copy < copies && size >= 0; copy++)
+                    size = videoEncoder.addNewFrame(decodedFrame);
+
+                // release decoded frame
+                av_frame_unref(decodedFrame);
 
                 // check if encoding was succesful
                 if (size < 0)
                 {
                     cout << "Could not encode video: size = " << size << endl;
+                    fileResult.status = -1;
                     break;
                 }
+
+                fileResult.frames += copies;
             }
         }
 
+        // stats of this input, encoder stats restart for next input
+        fileResult.stats.add(videoDecoder.getStats());
+        fileResult.stats.add(videoEncoder.getStats());
+        videoEncoder.resetStats();
+
+        fileResult.elapsedTime = (av_gettime_relative() - fileStartTime) / 1000000.0;
+        results.push_back(fileResult);
+
         // close video decoding
         videoDecoder.closeVideo();
     }
@@ -215,9 +803,20 @@ int main(int argc, char**argv)
     // stop video encoding
     videoEncoder.stopVideoEncode();
 
-    // delete rgb frames
-    if (rgbFrame)
-        delete [] rgbFrame;
+    // write report, delayed frames belong to last input
+    if (!reportFile.empty())
+    {
+        if (!results.empty())
+            results.back().stats.add(videoEncoder.getStats());
+
+        Transcoder::writeReport(reportFile, results);
+    }
+
+    // printing colour conversion timings
+    cout << "Encoder conversion : " << videoEncoder.getAvgConvertTime() << " us/frame" << endl;
+
+    // free decoded frame
+    av_frame_free(&decodedFrame);
 
     return 0;
 }
@@ -240,10 +839,15 @@ int getAllFiles(const char *path, vector<string> &pathVec, bool searchRec)
             {
                 string filePath = completePath + dirent->d_name;
 
-                if(dirent->d_type == DT_DIR && searchRec)
+                if(dirent->d_type == DT_DIR)
                 {
-                    filePath += "/";
-                    getAllFiles(filePath.c_str(), pathVec, true);
+                    // scan sub directory, directories are not videos
+                    if (searchRec)
+                    {
+                        filePath += "/";
+                        getAllFiles(filePath.c_str(), pathVec, true);
+                    }
+                    continue;
                 }
 
                 pathVec.push_back(filePath);
@@ -257,17 +861,86 @@ int getAllFiles(const char *path, vector<string> &pathVec, bool searchRec)
     return fileCount;
 }
 
+// function to parse time as seconds (12.5) or hh:mm:ss (00:01:02.5, 01:02.5)
+double parseTime(const char *timeStr)
+{
+    double seconds = 0.0;
+
+    // every field is 60 times the next one
+    const char *field = timeStr;
+    while (field)
+    {
+        seconds = seconds * 60 + atof(field);
+
+        field = strchr(field, ':');
+        if (field)
+            field++;
+    }
+
+    return seconds;
+}
+
+// function to make path absolute, relative to current directory
+string getAbsolutePath(const string &path)
+{
+    if (path.empty() || path[0] == '/')
+        return path;
+
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof(cwd)))
+        return path;
+
+    return string(cwd) + "/" + path;
+}
+
 // Function to print command line options
 void printHelp()
 {
     cout << "\nVideoTransoder:: Help Menu(-h)" << endl;
-    cout << "-i     : input video file              (default = n/a)" << endl;
+    cout << "-i     : input video file              (- = stdin, default = n/a)" << endl;
     cout << "-ip    : input video path              (default = n/a)" << endl;
     cout << "-irp   : input video path recursive    (default = n/a)" << endl;
-    cout << "-o     : output video                  (default = sample.avi)" << endl;
+    cout << "-o     : output video                  (- = stdout, default = sample.avi)" << endl;
     cout << "-f     : output video format           (default = MPEG-4)" << endl;
-    cout << "-r     : output video frame rate       (default = 15)" << endl;
-    cout << "-q     : output video quality          (default = 2)\n" << endl;
+    cout << "-r     : output video frame rate       (default = input frame rate)" << endl;
+    cout << "-s     : output video size WxH         (-1 keeps aspect ratio, default = input size)" << endl;
+    cout << "-sm    : scale mode                    (stretch/fit, default = stretch)" << endl;
+    cout << "-ss    : start time of input           (seconds or hh:mm:ss, default = 0)" << endl;
+    cout << "-t     : duration from start time      (seconds or hh:mm:ss, default = till end)" << endl;
+    cout << "-to    : end time of input             (seconds or hh:mm:ss, default = end of video)" << endl;
+    cout << "-lowres: decoder lowres level          (0 = auto when output is smaller, default = 0)" << endl;
+    cout << "-q     : output video quality          (default = 2)" << endl;
+    cout << "-dt    : decoder threads               (default = auto)" << endl;
+    cout << "-dtt   : decoder thread type           (frame/slice, default = frame+slice)" << endl;
+    cout << "-ra    : input readahead buffer in MB  (0 = ffmpeg file i/o, default = 0)" << endl;
+    cout << "-wb    : output write buffer in MB     (0 = ffmpeg file i/o, default = 0)" << endl;
+    cout << "-ll    : low latency encoding          (no b-frames/lookahead, slice threads, default = 0)" << endl;
+    cout << "-ir    : H264 periodic intra refresh   (instead of keyframes, default = 0)" << endl;
+    cout << "-fmt   : output container              (mpegts/mp4/matroska.., default = from -o, mpegts for -o -)" << endl;
+    cout << "-sf    : segmented output format       (hls/dash, -o is playlist/manifest, default = none)" << endl;
+    cout << "-sd    : segment duration in seconds   (default = 4)" << endl;
+    cout << "-et    : encoder threads               (default = auto)" << endl;
+    cout << "-preset: H264 preset                   (ultrafast..placebo, default = none)" << endl;
+    cout << "-tune  : H264 tune                     (film/animation/zerolatency.., default = none)" << endl;
+    cout << "-rc    : rate control                  (cqp/crf/abr, default = codec default)" << endl;
+    cout << "-crf   : H264 rate factor              (default = 23)" << endl;
+    cout << "-b     : output bit rate in kbps       (default = 400)" << endl;
+    cout << "-g     : gop length                    (default = 12)" << endl;
+    cout << "-pl    : pipelined transcoding queue    (0 = serial, default = 0)" << endl;
+    cout << "-j     : concurrent batch jobs         (one output per input, default = 0)" << endl;
+    cout << "-ot    : batch output name template    (%n = input name, %i = index, default = %n_out.avi)" << endl;
+    cout << "-report: json report of stage stats    (timers are off without it, default = none)" << endl;
+    cout << "-index : build keyframe index files    (no of concurrent inputs, then exit)" << endl;
+    cout << "-daemon: run as daemon on unix socket  (jobs of -submit clients on -j workers, 0 = auto)" << endl;
+    cout << "-submit: send inputs to daemon socket  (one output per input, named like -j)" << endl;
+    cout << "-ladder: renditions decoded once       (height[:kbps] list, e.g. 1080:5000,720:2800)" << endl;
+    cout << "-seg   : parallel keyframe segments    (one input, 0 = off, default = 0)" << endl;
+    cout << "-copy  : copy packets if input matches (0 = never, 1 = despite encode options, default = auto)" << endl;
+    cout << "-thumb : thumbnail every N seconds     (images to -o, default = thumb_%04d.jpg)" << endl;
+    cout << "-tn    : no of thumbnails over video   (overrides -thumb)" << endl;
+    cout << "-tw    : thumbnail width               (default = 320)" << endl;
+    cout << "-tc    : contact sheet columns         (0 = one image per thumbnail, default = 0)" << endl;
+    cout << "-tk    : keyframe thumbnails           (0 = exact frame, default = 1)\n" << endl;
 }
 
 // Function to print version information